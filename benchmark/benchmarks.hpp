@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace block_thingy::benchmark {
+
+/*
+ * Each benchmark gets the arguments after its name and returns the exit status
+ */
+int chunk_format_bench(const std::vector<std::string>& args);
+int chunk_light_bench(const std::vector<std::string>& args);
+int chunk_load_bench(const std::vector<std::string>& args);
+int chunk_order_bench(const std::vector<std::string>& args);
+int codec_bench(const std::vector<std::string>& args);
+int determinism_bench(const std::vector<std::string>& args);
+int frustum_cull_bench(const std::vector<std::string>& args);
+int journal_bench(const std::vector<std::string>& args);
+int mesher_bench(const std::vector<std::string>& args);
+int occlusion_bench(const std::vector<std::string>& args);
+int pending_light_bench(const std::vector<std::string>& args);
+int prefetch_bench(const std::vector<std::string>& args);
+int terrain_bench(const std::vector<std::string>& args);
+int thread_pool_bench(const std::vector<std::string>& args);
+
+}
@@ -0,0 +1,194 @@
+#include "benchmarks.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <msgpack.hpp>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/msgpack_util.hpp"
+#include "storage/msgpack/Chunk.hpp"
+#include "storage/msgpack/chunk_image.hpp"
+#include "util/filesystem.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::block_in_chunk;
+using position::chunk_in_world;
+
+static bool same(const storage::chunk_image& a, const storage::chunk_image& b)
+{
+	return *a.blocks == *b.blocks
+		&& *a.blocklight == *b.blocklight
+		&& *a.skylight == *b.skylight;
+}
+
+int chunk_format_bench(const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_chunk_format";
+	fs::remove_all(world_dir);
+	bool ok = true;
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		// these are the IDs that world::gen_chunk uses
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+
+		struct scenario
+		{
+			const char* name;
+			std::vector<std::shared_ptr<Chunk>> chunks;
+		};
+		scenario terrain{"terrain", {}};
+		scenario noise{"noise", {}};
+
+		chunk_in_world pos;
+		for(pos.x = -4; pos.x < 4; ++pos.x)
+		for(pos.y = -2; pos.y <= 0; ++pos.y)
+		for(pos.z = -4; pos.z < 4; ++pos.z)
+		{
+			auto chunk = std::make_shared<Chunk>(pos, world);
+			world.gen_chunk(chunk);
+			terrain.chunks.emplace_back(std::move(chunk));
+		}
+
+		// the worst case for runs: every block and light value is random
+		std::mt19937 random(1);
+		std::uniform_int_distribution<uint32_t> block_dist(0, 255);
+		std::uniform_int_distribution<int> light_dist(0, 255);
+		for(pos.x = 0; pos.x < 8; ++pos.x)
+		{
+			auto chunk = std::make_shared<Chunk>(chunk_in_world(pos.x, 100, 0), world);
+			block_in_chunk bpos;
+			for(bpos.x = 0; bpos.x < CHUNK_SIZE; ++bpos.x)
+			for(bpos.y = 0; bpos.y < CHUNK_SIZE; ++bpos.y)
+			for(bpos.z = 0; bpos.z < CHUNK_SIZE; ++bpos.z)
+			{
+				chunk->set_block(bpos, block_t(block_dist(random), 0));
+				const auto c = [&random, &light_dist]()
+				{
+					return static_cast<uint8_t>(light_dist(random));
+				};
+				chunk->set_blocklight(bpos, graphics::color(c(), c(), c()));
+				chunk->set_skylight(bpos, graphics::color(c(), c(), c()));
+			}
+			noise.chunks.emplace_back(std::move(chunk));
+		}
+
+		std::cout << std::left << std::setw(10) << "chunks"
+				  << std::setw(10) << "format"
+				  << std::right
+				  << std::setw(14) << "bytes"
+				  << std::setw(14) << "save ms"
+				  << std::setw(14) << "load ms"
+				  << std::setw(10) << "speedup"
+				  << '\n';
+
+		using clock = std::chrono::steady_clock;
+		for(const scenario& s : {terrain, noise})
+		{
+			std::vector<storage::chunk_image> images;
+			for(const auto& chunk : s.chunks)
+			{
+				images.emplace_back(chunk->snapshot());
+			}
+			// made before timing, so only decoding is timed
+			std::vector<std::unique_ptr<Chunk>> loaded;
+			for(const auto& image : images)
+			{
+				loaded.emplace_back(std::make_unique<Chunk>(image.position, world));
+			}
+
+			double msgpack_load_seconds = 0;
+			for(const bool binary : {false, true})
+			{
+				std::vector<string> saved(images.size());
+				const auto save_start = clock::now();
+				for(std::size_t i = 0; i < images.size(); ++i)
+				{
+					if(binary)
+					{
+						saved[i] = storage::chunk_format::write(images[i]);
+					}
+					else
+					{
+						msgpack::sbuffer buffer;
+						msgpack::pack(buffer, images[i]);
+						saved[i].assign(buffer.data(), buffer.size());
+					}
+				}
+				const double save_seconds = std::chrono::duration<double>(clock::now() - save_start).count();
+
+				const auto load_start = clock::now();
+				for(std::size_t i = 0; i < images.size(); ++i)
+				{
+					if(binary)
+					{
+						storage::chunk_format::read(saved[i], *loaded[i]);
+					}
+					else
+					{
+						storage::unpack_bytes(saved[i], *loaded[i]);
+					}
+				}
+				const double load_seconds = std::chrono::duration<double>(clock::now() - load_start).count();
+				if(!binary)
+				{
+					msgpack_load_seconds = load_seconds;
+				}
+
+				for(std::size_t i = 0; i < images.size(); ++i)
+				{
+					if(!same(images[i], loaded[i]->snapshot()))
+					{
+						std::cerr << s.name << ": chunk " << images[i].position << " did not load as it was saved\n";
+						ok = false;
+					}
+				}
+
+				uint64_t size = 0;
+				for(const string& bytes : saved)
+				{
+					size += bytes.size();
+				}
+				std::cout << std::fixed << std::setprecision(1)
+						  << std::left << std::setw(10) << s.name
+						  << std::setw(10) << (binary ? "binary" : "msgpack")
+						  << std::right
+						  << std::setw(14) << size
+						  << std::setw(14) << save_seconds * 1000
+						  << std::setw(14) << load_seconds * 1000
+						  << std::setw(10) << msgpack_load_seconds / load_seconds
+						  << '\n';
+			}
+		}
+	}
+	fs::remove_all(world_dir);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
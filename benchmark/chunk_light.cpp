@@ -0,0 +1,166 @@
+#include "benchmarks.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "block/component/info.hpp"
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "graphics/color.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/codec.hpp"
+#include "storage/world_file.hpp"
+#include "util/filesystem.hpp"
+#include "world/chunk_light.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::block_in_chunk;
+using position::chunk_in_world;
+
+static uint64_t directory_size(const fs::path& dir)
+{
+	uint64_t size = 0;
+	for(const auto& entry : fs::recursive_directory_iterator(dir))
+	{
+		if(fs::is_regular_file(entry.path()))
+		{
+			size += fs::file_size(entry.path());
+		}
+	}
+	return size;
+}
+
+/*
+ * Disk size and load time of chunks saved with their light compared to saved without it and lit when loaded
+ */
+int chunk_light_bench(const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_chunk_light";
+	fs::remove_all(world_dir);
+	bool ok = true;
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		// these are the IDs that world::gen_chunk uses
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+		const block_t lamp = world.block_manager.create();
+		world.block_manager.set_strid(lamp, "lamp");
+		world.block_manager.info.light(lamp, {graphics::color::max, 8, 4});
+
+		const graphics::color skylight_color(8, 8, 8);
+		const uint32_t stamp = world::light_stamp(world.block_manager.info, skylight_color);
+
+		std::vector<storage::chunk_image> images;
+		chunk_in_world pos;
+		for(pos.x = 0; pos.x < 8; ++pos.x)
+		for(pos.y = -3; pos.y <= 0; ++pos.y)
+		for(pos.z = 0; pos.z < 8; ++pos.z)
+		{
+			auto chunk = std::make_shared<Chunk>(pos, world);
+			world.gen_chunk(chunk);
+			// something for the blocklight to spread from
+			chunk->set_block(block_in_chunk(CHUNK_SIZE / 2, CHUNK_SIZE / 2, CHUNK_SIZE / 2), lamp);
+			world::light_chunk(*chunk, world.block_manager.info, skylight_color);
+			chunk->set_light_stamp(stamp);
+			images.emplace_back(chunk->snapshot());
+		}
+
+		std::cout << images.size() << " chunks of lit terrain\n";
+		std::cout << std::left << std::setw(8) << "light"
+				  << std::right
+				  << std::setw(14) << "stored/chunk"
+				  << std::setw(12) << "disk/chunk"
+				  << std::setw(12) << "us/chunk"
+				  << std::setw(12) << "relit"
+				  << '\n';
+
+		using clock = std::chrono::steady_clock;
+		for(const bool save_light : {true, false})
+		{
+			const fs::path mode_dir = world_dir / (save_light ? "save" : "omit");
+			fs::create_directories(mode_dir);
+			storage::world_file file(mode_dir);
+			file.set_save_light(save_light);
+			uint64_t stored = 0;
+			for(const storage::chunk_image& image : images)
+			{
+				file.save_chunk(image);
+				stored += storage::encode(file.get_chunk_codec(), storage::chunk_format::write(image, save_light)).size();
+			}
+			// region files round each chunk up to whole sectors
+			const uint64_t size = directory_size(mode_dir / "regions");
+
+			// what the load worker does: load, and light the chunk if its light was not saved
+			std::vector<std::unique_ptr<Chunk>> loaded;
+			std::size_t relit = 0;
+			const auto start = clock::now();
+			for(const storage::chunk_image& image : images)
+			{
+				bool has_light;
+				auto chunk = file.load_chunk(world, image.position, has_light);
+				if(chunk != nullptr && (!has_light || chunk->get_light_stamp() != stamp))
+				{
+					world::light_chunk(*chunk, world.block_manager.info, skylight_color);
+					chunk->set_light_stamp(stamp);
+					++relit;
+				}
+				loaded.emplace_back(std::move(chunk));
+			}
+			const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+			const double n = static_cast<double>(images.size());
+			std::cout << std::fixed << std::setprecision(1)
+					  << std::left << std::setw(8) << (save_light ? "save" : "omit")
+					  << std::right
+					  << std::setw(14) << static_cast<double>(stored) / n
+					  << std::setw(12) << static_cast<double>(size) / n
+					  << std::setw(12) << seconds * 1e6 / n
+					  << std::setw(12) << relit
+					  << '\n';
+
+			// lighting a chunk again gives the light it was saved with
+			for(std::size_t i = 0; i < images.size(); ++i)
+			{
+				const storage::chunk_image& a = images[i];
+				if(loaded[i] == nullptr)
+				{
+					std::cerr << "chunk " << a.position << " did not load\n";
+					ok = false;
+					continue;
+				}
+				const storage::chunk_image b = loaded[i]->snapshot();
+				if(*a.blocks != *b.blocks || *a.blocklight != *b.blocklight || *a.skylight != *b.skylight)
+				{
+					std::cerr << "chunk " << a.position << " did not load with the light it was saved with\n";
+					ok = false;
+				}
+			}
+		}
+	}
+	fs::remove_all(world_dir);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
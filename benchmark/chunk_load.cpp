@@ -0,0 +1,160 @@
+#include "benchmarks.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/chunk_load_stats.hpp"
+#include "storage/codec.hpp"
+#include "storage/region_file.hpp"
+#include "storage/world_file.hpp"
+#include "util/filesystem.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::chunk_in_world;
+
+int chunk_load_bench(const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_chunk_load";
+	fs::remove_all(world_dir);
+	bool ok = true;
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		// these are the IDs that world::gen_chunk uses
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+
+		std::vector<storage::chunk_image> images;
+		chunk_in_world pos;
+		for(pos.x = 0; pos.x < 8; ++pos.x)
+		for(pos.y = -3; pos.y <= 0; ++pos.y)
+		for(pos.z = 0; pos.z < 8; ++pos.z)
+		{
+			auto chunk = std::make_shared<Chunk>(pos, world);
+			world.gen_chunk(chunk);
+			images.emplace_back(chunk->snapshot());
+		}
+
+		std::cout << images.size() << " chunks of generated terrain\n";
+		std::cout << std::left << std::setw(10) << "codec"
+				  << std::setw(8) << "path"
+				  << std::right
+				  << std::setw(12) << "us/chunk"
+				  << std::setw(14) << "allocs/chunk"
+				  << std::setw(14) << "copied/chunk"
+				  << '\n';
+
+		using clock = std::chrono::steady_clock;
+		for(const storage::codec codec : {storage::codec::none, storage::codec::deflate, storage::codec::lz})
+		{
+			const fs::path codec_dir = world_dir / "codec";
+			fs::remove_all(codec_dir);
+			fs::create_directories(codec_dir);
+			storage::world_file file(codec_dir);
+			file.set_chunk_codec(codec);
+			for(const storage::chunk_image& image : images)
+			{
+				file.save_chunk(image);
+			}
+
+			auto print = [codec, &images](const char* path, const double seconds, const double allocations, const double copied)
+			{
+				const double n = static_cast<double>(images.size());
+				std::cout << std::fixed << std::setprecision(1)
+						  << std::left << std::setw(10) << codec
+						  << std::setw(8) << path
+						  << std::right
+						  << std::setw(12) << seconds * 1e6 / n
+						  << std::setw(14) << allocations / n
+						  << std::setw(14) << copied / n
+						  << '\n';
+			};
+
+			// the path before mapping: read the extent into a string, decode into another string, then decode the chunk
+			{
+				std::vector<std::unique_ptr<Chunk>> loaded;
+				uint64_t copied = 0;
+				std::vector<std::unique_ptr<storage::region_file>> regions;
+				for(const auto& entry : fs::directory_iterator(codec_dir / "regions"))
+				{
+					regions.emplace_back(std::make_unique<storage::region_file>(entry.path()));
+				}
+				const auto start = clock::now();
+				for(const auto& region : regions)
+				{
+					for(const std::size_t index : region->saved())
+					{
+						const string stored = *region->read(index);
+						const string bytes = storage::decode(stored);
+						// the position does not matter here
+						auto chunk = std::make_unique<Chunk>(chunk_in_world(), world);
+						storage::chunk_format::read(bytes, *chunk);
+						copied += stored.size() + bytes.size();
+						loaded.emplace_back(std::move(chunk));
+					}
+				}
+				const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+				print("read", seconds, static_cast<double>(images.size() * (2 + storage::chunk_format::ARRAY_COUNT)), static_cast<double>(copied));
+			}
+
+			{
+				std::vector<std::unique_ptr<Chunk>> loaded;
+				const storage::chunk_load_stats before = file.get_load_stats();
+				const auto start = clock::now();
+				for(const storage::chunk_image& image : images)
+				{
+					loaded.emplace_back(file.load_chunk(world, image.position));
+				}
+				const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+				const storage::chunk_load_stats after = file.get_load_stats();
+				print("mapped", seconds,
+					static_cast<double>(after.allocations - before.allocations),
+					static_cast<double>(after.bytes_copied - before.bytes_copied));
+
+				for(std::size_t i = 0; i < images.size(); ++i)
+				{
+					const storage::chunk_image& a = images[i];
+					if(loaded[i] == nullptr)
+					{
+						std::cerr << codec << ": chunk " << a.position << " did not load\n";
+						ok = false;
+						continue;
+					}
+					const storage::chunk_image b = loaded[i]->snapshot();
+					if(*a.blocks != *b.blocks || *a.blocklight != *b.blocklight || *a.skylight != *b.skylight)
+					{
+						std::cerr << codec << ": chunk " << a.position << " did not load as it was saved\n";
+						ok = false;
+					}
+				}
+			}
+		}
+	}
+	fs::remove_all(world_dir);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,253 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/vec3.hpp>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "world/view_sphere.hpp"
+
+#include "simulated_loader.hpp"
+
+using std::nullopt;
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::chunk_in_world;
+
+// the same as world.cpp
+constexpr double TICKS_PER_SECOND = 60;
+// for the chunks counted as in view: half the angle of a cone around where the player looks
+constexpr double VIEW_HALF_ANGLE = 45;
+
+enum class request_order
+{
+	// every chunk in the cube around the player, in the order of a hash set (how world::step requested them before)
+	cube,
+	// the view sphere, nearest first
+	nearest,
+	// the view sphere, with the chunks in front of where the player looks first
+	look,
+};
+
+struct order_options
+{
+	chunk_in_world::value_type render_distance;
+	std::size_t workers;
+	double job_ms;
+	double look_weight;
+};
+
+struct order_result
+{
+	std::size_t wanted;
+	// from the first tick until the player's chunk and its neighbors are loaded
+	std::optional<double> near_seconds;
+	// until the chunks within render distance in a cone in front of the player are loaded
+	std::optional<double> in_view_seconds;
+	// until every chunk within render distance is loaded
+	std::optional<double> all_seconds;
+};
+
+/*
+ * A player joining a world with nothing loaded, standing still and looking along x, with the chunks requested each tick
+ * in the given order
+ */
+static order_result join(const order_options& options, const request_order order)
+{
+	const auto job_ticks = static_cast<uint64_t>(std::max(std::round(options.job_ms / 1000 * TICKS_PER_SECOND), 1.0));
+	simulated_loader loader(options.workers, job_ticks);
+
+	const glm::dvec3 view_position(0.5, 0.5, 0.5);
+	const glm::dvec3 look(1, 0, 0);
+	const world::view_sphere sphere(options.render_distance);
+	const auto r = options.render_distance;
+
+	std::vector<chunk_in_world> wanted;
+	if(order == request_order::cube)
+	{
+		position::unordered_set_t<chunk_in_world> cube;
+		chunk_in_world pos;
+		for(pos.x = -r; pos.x <= r; ++pos.x)
+		for(pos.y = -r; pos.y <= r; ++pos.y)
+		for(pos.z = -r; pos.z <= r; ++pos.z)
+		{
+			cube.emplace(pos);
+		}
+		wanted.assign(cube.cbegin(), cube.cend());
+	}
+	else
+	{
+		// the same as world::impl::request_active_chunks
+		const double look_weight = order == request_order::look ? options.look_weight : 0;
+		std::vector<std::tuple<bool, double, chunk_in_world>> keyed;
+		const auto& offsets = sphere.get_offsets();
+		for(std::size_t i = 0; i < offsets.size(); ++i)
+		{
+			const chunk_in_world& pos = offsets[i];
+			const glm::dvec3 center = (glm::dvec3(chunk_in_world::vec_type(pos)) + 0.5) * static_cast<double>(CHUNK_SIZE);
+			keyed.emplace_back(i >= sphere.get_near_count(), world::view_weighted_distance(center - view_position, look, look_weight), pos);
+		}
+		std::stable_sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b)
+		{
+			return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+		});
+		for(const auto& [far, key, pos] : keyed)
+		{
+			wanted.emplace_back(pos);
+		}
+	}
+
+	// counted the same for every order, so the cube's corners are not waited for
+	const auto& offsets = sphere.get_offsets();
+	const std::size_t near_count = sphere.get_near_count();
+	std::vector<chunk_in_world> in_view;
+	const double min_cos = std::cos(glm::radians(VIEW_HALF_ANGLE));
+	for(const chunk_in_world& pos : offsets)
+	{
+		const glm::dvec3 offset = glm::dvec3(chunk_in_world::vec_type(pos)) * static_cast<double>(CHUNK_SIZE);
+		const double length = glm::length(offset);
+		if(length == 0 || glm::dot(offset, look) / length >= min_cos)
+		{
+			in_view.emplace_back(pos);
+		}
+	}
+	const auto all_loaded = [&loader](auto begin, const auto end)
+	{
+		return std::all_of(begin, end, [&loader](const chunk_in_world& pos)
+		{
+			return loader.loaded(pos);
+		});
+	};
+
+	order_result result{};
+	result.wanted = wanted.size();
+	// long enough to load every chunk on one worker, and then some
+	const uint64_t max_ticks = (wanted.size() + 1) * job_ticks * 2;
+	for(uint64_t tick = 0; tick < max_ticks && result.all_seconds == nullopt; ++tick)
+	{
+		for(const chunk_in_world& pos : wanted)
+		{
+			loader.request(pos, false);
+		}
+		loader.step(tick);
+
+		const double seconds = static_cast<double>(tick + 1) / TICKS_PER_SECOND;
+		if(result.near_seconds == nullopt && all_loaded(offsets.cbegin(), offsets.cbegin() + static_cast<std::ptrdiff_t>(near_count)))
+		{
+			result.near_seconds = seconds;
+		}
+		if(result.in_view_seconds == nullopt && all_loaded(in_view.cbegin(), in_view.cend()))
+		{
+			result.in_view_seconds = seconds;
+		}
+		if(all_loaded(offsets.cbegin(), offsets.cend()))
+		{
+			result.all_seconds = seconds;
+		}
+	}
+	return result;
+}
+
+/*
+ * When a player joins, the chunks around them load in the order world::step requests them. This compares the old
+ * order (the cube around the player in hash set order) with the view sphere nearest first and with the chunks in front
+ * of the player first, on simulated workers that take a fixed time for each chunk, and reports how soon the chunks
+ * around the player (the first playable frame), the chunks in front of them, and every chunk within render distance
+ * are loaded.
+ */
+int chunk_order_bench(const std::vector<string>& args)
+{
+	order_options options;
+	options.render_distance = 8;
+	options.workers = 4;
+	options.job_ms = 20;
+	options.look_weight = 0.5; // the default of chunk_order_look_weight
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--render-distance" && i + 1 < args.size())
+		{
+			options.render_distance = std::max<chunk_in_world::value_type>(std::stoll(args[++i]), 1);
+		}
+		else if(args[i] == "--workers" && i + 1 < args.size())
+		{
+			options.workers = static_cast<std::size_t>(std::max<int64_t>(std::stoll(args[++i]), 1));
+		}
+		else if(args[i] == "--job-ms" && i + 1 < args.size())
+		{
+			options.job_ms = std::max(std::stod(args[++i]), 0.0);
+		}
+		else if(args[i] == "--look-weight" && i + 1 < args.size())
+		{
+			options.look_weight = std::clamp(std::stod(args[++i]), 0.0, 1.0);
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	std::cout << "render distance " << options.render_distance << ", " << options.workers << " workers taking "
+			  << options.job_ms << " ms per chunk (" << CHUNK_SIZE << "³ chunks), look weight " << options.look_weight << '\n';
+	std::cout << "order             chunks  near (s)  in view (s)  all (s)\n";
+	const auto print_seconds = [](const std::optional<double>& seconds, const int width)
+	{
+		if(seconds == nullopt)
+		{
+			std::cout << std::setw(width) << "never";
+		}
+		else
+		{
+			std::cout << std::fixed << std::setprecision(2) << std::setw(width) << *seconds;
+		}
+	};
+	uint64_t failures = 0;
+	std::optional<double> cube_near;
+	for(const auto& [name, order] :
+	{
+		std::pair{"cube", request_order::cube},
+		std::pair{"nearest first", request_order::nearest},
+		std::pair{"look first", request_order::look},
+	})
+	{
+		const order_result result = join(options, order);
+		std::cout << std::left << std::setw(15) << name << std::right << std::setw(9) << result.wanted;
+		print_seconds(result.near_seconds, 10);
+		print_seconds(result.in_view_seconds, 13);
+		print_seconds(result.all_seconds, 9);
+		std::cout << '\n';
+		if(result.all_seconds == nullopt)
+		{
+			++failures;
+		}
+		if(order == request_order::cube)
+		{
+			cube_near = result.near_seconds;
+		}
+		else if(cube_near != nullopt && result.near_seconds != nullopt && *result.near_seconds > *cube_near)
+		{
+			std::cerr << name << " loads the chunks around the player later than the cube\n";
+			++failures;
+		}
+	}
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,175 @@
+#include "benchmarks.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/codec.hpp"
+#include "storage/region_file.hpp"
+#include "util/filesystem.hpp"
+#include "util/misc.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::chunk_in_world;
+
+/*
+ * The uncompressed chunks of a saved world (in region files and old chunk files)
+ */
+static std::vector<string> read_world(const fs::path& world_dir)
+{
+	std::vector<string> chunks;
+	const fs::path region_dir = world_dir / "regions";
+	if(fs::is_directory(region_dir))
+	{
+		for(const auto& entry : fs::directory_iterator(region_dir))
+		{
+			if(entry.path().extension() != ".region")
+			{
+				continue;
+			}
+			const storage::region_file region(entry.path());
+			for(const std::size_t index : region.saved())
+			{
+				chunks.emplace_back(storage::decode(*region.read(index)));
+			}
+		}
+	}
+	const fs::path chunk_dir = world_dir / "chunks";
+	if(fs::is_directory(chunk_dir))
+	{
+		for(const auto& entry : fs::directory_iterator(chunk_dir))
+		{
+			if(entry.path().extension() == ".gz")
+			{
+				chunks.emplace_back(storage::decode(util::read_file(entry.path())));
+			}
+		}
+	}
+	return chunks;
+}
+
+/*
+ * Generated terrain, for when there is no world to read
+ */
+static std::vector<string> generate_chunks()
+{
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_codec";
+	fs::remove_all(world_dir);
+	std::vector<string> chunks;
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		// these are the IDs that world::gen_chunk uses
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+
+		chunk_in_world pos;
+		for(pos.x = -4; pos.x < 4; ++pos.x)
+		for(pos.y = -2; pos.y <= 0; ++pos.y)
+		for(pos.z = -4; pos.z < 4; ++pos.z)
+		{
+			std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(pos, world);
+			world.gen_chunk(chunk);
+			chunks.emplace_back(storage::chunk_format::write(chunk->snapshot()));
+		}
+	}
+	fs::remove_all(world_dir);
+	return chunks;
+}
+
+int codec_bench(const std::vector<string>& args)
+{
+	fs::path world_dir;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--world" && i + 1 < args.size())
+		{
+			world_dir = args[++i];
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	const std::vector<string> chunks = world_dir.empty() ? generate_chunks() : read_world(world_dir);
+	if(chunks.empty())
+	{
+		std::cerr << "no chunks in " << world_dir.u8string() << '\n';
+		return EXIT_FAILURE;
+	}
+	uint64_t raw_size = 0;
+	for(const string& chunk : chunks)
+	{
+		raw_size += chunk.size();
+	}
+	std::cout << chunks.size() << " chunks from " << (world_dir.empty() ? "generated terrain" : world_dir.u8string())
+			  << ", " << raw_size << " bytes uncompressed\n";
+	std::cout << std::left << std::setw(10) << "codec"
+			  << std::right
+			  << std::setw(14) << "bytes"
+			  << std::setw(10) << "ratio"
+			  << std::setw(14) << "save MB/s"
+			  << std::setw(14) << "load MB/s"
+			  << '\n';
+
+	using clock = std::chrono::steady_clock;
+	bool ok = true;
+	for(const storage::codec codec : {storage::codec::none, storage::codec::deflate, storage::codec::lz})
+	{
+		std::vector<string> stored(chunks.size());
+		const auto save_start = clock::now();
+		for(std::size_t i = 0; i < chunks.size(); ++i)
+		{
+			stored[i] = storage::encode(codec, chunks[i]);
+		}
+		const double save_seconds = std::chrono::duration<double>(clock::now() - save_start).count();
+
+		uint64_t stored_size = 0;
+		for(const string& s : stored)
+		{
+			stored_size += s.size();
+		}
+
+		const auto load_start = clock::now();
+		for(std::size_t i = 0; i < chunks.size(); ++i)
+		{
+			if(storage::decode(stored[i]) != chunks[i])
+			{
+				std::cerr << codec << ": chunk " << i << " did not decode to the original bytes\n";
+				ok = false;
+			}
+		}
+		const double load_seconds = std::chrono::duration<double>(clock::now() - load_start).count();
+
+		const double mb = raw_size / 1e6;
+		std::cout << std::fixed << std::setprecision(1)
+				  << std::left << std::setw(10) << codec
+				  << std::right
+				  << std::setw(14) << stored_size
+				  << std::setw(10) << static_cast<double>(raw_size) / stored_size
+				  << std::setw(14) << mb / save_seconds
+				  << std::setw(14) << mb / load_seconds
+				  << '\n';
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
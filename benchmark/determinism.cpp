@@ -0,0 +1,206 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/codec.hpp"
+#include "util/crc32.hpp"
+#include "util/filesystem.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::chunk_in_world;
+
+struct determinism_run
+{
+	std::size_t thread_count;
+	double seconds;
+	// by the chunk's index in the positions given to generate
+	std::vector<uint32_t> hashes;
+	uint64_t not_pristine;
+	// what saving the chunks would have written, without their light (world::gen_chunk does not light them)
+	uint64_t saved_bytes;
+};
+
+/*
+ * Generate the chunks with thread_count threads, in an order shuffled by the thread count, in a new world (so that
+ * nothing is cached from another run)
+ */
+static determinism_run generate(const std::vector<chunk_in_world>& positions, const std::size_t thread_count, const double seed)
+{
+	const fs::path world_dir = fs::temp_directory_path() / ("bt_bench_determinism_" + std::to_string(thread_count));
+	fs::remove_all(world_dir);
+
+	determinism_run run;
+	run.thread_count = thread_count;
+	run.hashes.resize(positions.size());
+	run.not_pristine = 0;
+	run.saved_bytes = 0;
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		world.set_seed(seed);
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+
+		std::vector<std::size_t> order(positions.size());
+		for(std::size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), std::mt19937(static_cast<std::mt19937::result_type>(thread_count)));
+
+		std::atomic<std::size_t> next(0);
+		std::atomic<uint64_t> not_pristine(0);
+		std::atomic<uint64_t> saved_bytes(0);
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for(std::size_t t = 0; t < thread_count; ++t)
+		{
+			threads.emplace_back([&]()
+			{
+				for(std::size_t n = next++; n < order.size(); n = next++)
+				{
+					const std::size_t i = order[n];
+					auto chunk = std::make_shared<Chunk>(positions[i], world);
+					world.gen_chunk(chunk);
+					const storage::chunk_image image = chunk->snapshot();
+					const auto* bytes = reinterpret_cast<const char*>(image.blocks->data());
+					run.hashes[i] = util::crc32(string(bytes, image.blocks->size() * sizeof(block_t)));
+					if(!chunk->is_pristine())
+					{
+						++not_pristine;
+					}
+					const string stored = storage::encode(world.get_chunk_codec(), storage::chunk_format::write(image, false));
+					saved_bytes += stored.size();
+				}
+			});
+		}
+		for(std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		run.not_pristine = not_pristine;
+		run.saved_bytes = saved_bytes;
+	}
+	fs::remove_all(world_dir);
+	return run;
+}
+
+/*
+ * Generated chunks are not saved until they change, so generating a chunk again must give the same blocks no matter
+ * how many threads generate, or in which order. This generates the same chunks with different thread counts and
+ * checks that each chunk's blocks hash the same every time.
+ */
+int determinism_bench(const std::vector<string>& args)
+{
+	int64_t columns_wide = 6;
+	int64_t stack_height = 4;
+	std::size_t max_threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 2);
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--columns" && i + 1 < args.size())
+		{
+			columns_wide = std::max<int64_t>(std::stoll(args[++i]), 1);
+		}
+		else if(args[i] == "--stack" && i + 1 < args.size())
+		{
+			stack_height = std::max<int64_t>(std::stoll(args[++i]), 1);
+		}
+		else if(args[i] == "--threads" && i + 1 < args.size())
+		{
+			max_threads = static_cast<std::size_t>(std::max<int64_t>(std::stoll(args[++i]), 1));
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+	const double seed = 0.5;
+
+	std::vector<chunk_in_world> positions;
+	for(int64_t x = -columns_wide / 2; x < columns_wide - columns_wide / 2; ++x)
+	for(int64_t z = -columns_wide / 2; z < columns_wide - columns_wide / 2; ++z)
+	for(int64_t y = 1 - stack_height; y <= 0; ++y)
+	{
+		positions.emplace_back(x, y, z);
+	}
+
+	std::vector<std::size_t> thread_counts{1};
+	for(std::size_t n = 2; n < max_threads; n *= 2)
+	{
+		thread_counts.emplace_back(n);
+	}
+	if(max_threads > 1)
+	{
+		thread_counts.emplace_back(max_threads);
+	}
+
+	std::cout << positions.size() << " chunks (" << columns_wide << "x" << columns_wide << " columns, "
+			  << stack_height << " high)\n"
+			  << "threads   seconds  hash of every chunk  differing chunks\n";
+	std::vector<determinism_run> runs;
+	uint64_t failures = 0;
+	for(const std::size_t thread_count : thread_counts)
+	{
+		runs.emplace_back(generate(positions, thread_count, seed));
+		const determinism_run& run = runs.back();
+
+		uint64_t differing = 0;
+		for(std::size_t i = 0; i < positions.size(); ++i)
+		{
+			if(run.hashes[i] != runs.front().hashes[i])
+			{
+				if(differing == 0)
+				{
+					std::cerr << "chunk " << positions[i] << " differs with " << thread_count << " threads\n";
+				}
+				++differing;
+			}
+		}
+		uint32_t combined = 0;
+		for(const uint32_t hash : run.hashes)
+		{
+			combined = util::crc32(string(reinterpret_cast<const char*>(&hash), sizeof(hash)), combined);
+		}
+		std::cout << std::setw(7) << thread_count
+				  << std::fixed << std::setprecision(3) << std::setw(10) << run.seconds
+				  << "  " << std::hex << std::setw(8) << std::setfill('0') << combined << std::dec << std::setfill(' ')
+				  << std::setw(29) << differing << '\n';
+		if(run.not_pristine != 0)
+		{
+			std::cerr << run.not_pristine << " generated chunks are not marked pristine with " << thread_count << " threads\n";
+		}
+		failures += differing + run.not_pristine;
+	}
+
+	const determinism_run& first = runs.front();
+	std::cout << "not saved, since they can be generated again: " << first.saved_bytes << " bytes ("
+			  << std::setprecision(1) << static_cast<double>(first.saved_bytes) / static_cast<double>(positions.size()) / 1024.0
+			  << " KiB per chunk, without their light)\n";
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,298 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/trigonometric.hpp>
+#include <glm/vec3.hpp>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "graphics/chunk_cull_list.hpp"
+#include "graphics/default_view_frustum.hpp"
+#include "graphics/frustum.hpp"
+#include "physics/AABB.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "world/view_sphere.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::chunk_in_world;
+
+// the defaults of the settings
+constexpr double NEAR_PLANE = 0.1;
+constexpr double FAR_PLANE = 1500;
+constexpr double FOV = 75;
+constexpr double RATIO = 16.0 / 9.0;
+
+struct camera_view
+{
+	chunk_in_world chunk;
+	// in the camera's chunk, like Gfx::graphical_position
+	glm::dvec3 position;
+	// in radians
+	glm::dvec3 rotation;
+	bool infinite;
+};
+
+/*
+ * The loaded chunks with a mesh, looked up the way draw_world did before chunk_cull_list: under a mutex, like
+ * world::get_chunk
+ */
+class locked_chunks
+{
+public:
+	void add(const chunk_in_world& pos)
+	{
+		std::lock_guard<std::mutex> g(mutex);
+		chunks.emplace(pos);
+	}
+
+	bool has(const chunk_in_world& pos) const
+	{
+		std::lock_guard<std::mutex> g(mutex);
+		return chunks.count(pos) != 0;
+	}
+
+private:
+	position::unordered_set_t<chunk_in_world> chunks;
+	mutable std::mutex mutex;
+};
+
+static graphics::default_view_frustum make_frustum(const camera_view& view)
+{
+	const double fov = glm::radians(FOV);
+	if(view.infinite)
+	{
+		return graphics::default_view_frustum(view.position, view.rotation, NEAR_PLANE, fov, RATIO);
+	}
+	return graphics::default_view_frustum(view.position, view.rotation, NEAR_PLANE, FAR_PLANE, fov, RATIO);
+}
+
+/*
+ * The old draw_world: each position within render distance, tested against a frustum on the heap and then looked up
+ */
+static void cull_cube
+(
+	const camera_view& view,
+	const locked_chunks& chunks,
+	const chunk_in_world::value_type render_distance,
+	std::vector<chunk_in_world>& drawn
+)
+{
+	const std::unique_ptr<graphics::frustum> frustum = std::make_unique<graphics::default_view_frustum>(make_frustum(view));
+	const chunk_in_world min = view.chunk - render_distance;
+	const chunk_in_world max = view.chunk + render_distance;
+	chunk_in_world pos;
+	for(pos.x = min.x; pos.x <= max.x; ++pos.x)
+	for(pos.y = min.y; pos.y <= max.y; ++pos.y)
+	for(pos.z = min.z; pos.z <= max.z; ++pos.z)
+	{
+		if(!world::view_sphere::contains(pos - view.chunk, render_distance))
+		{
+			continue;
+		}
+		if(!frustum->inside(physics::AABB(chunk_in_world(pos - view.chunk))))
+		{
+			continue;
+		}
+		if(chunks.has(pos))
+		{
+			drawn.emplace_back(pos);
+		}
+	}
+}
+
+/*
+ * The new draw_world
+ */
+static void cull_list
+(
+	const camera_view& view,
+	const graphics::chunk_cull_list& list,
+	const chunk_in_world::value_type render_distance,
+	std::vector<std::size_t>& inside,
+	std::vector<chunk_in_world>& drawn
+)
+{
+	const graphics::default_view_frustum frustum = make_frustum(view);
+	inside.clear();
+	list.cull(frustum.get_planes(), view.chunk, inside);
+	for(const std::size_t i : inside)
+	{
+		const chunk_in_world& pos = list.get_position(i);
+		if(world::view_sphere::contains(pos - view.chunk, render_distance))
+		{
+			drawn.emplace_back(pos);
+		}
+	}
+}
+
+/*
+ * draw_world used to go thru every position within render distance each frame, testing it against the frustum and
+ * looking it up in the world under a mutex. It now tests only the loaded chunks with a mesh, kept in
+ * graphics::chunk_cull_list, 4 at a time with AVX. This compares the time of both for random cameras, and checks that
+ * each chunk is culled the same as by default_view_frustum::inside and that both draw the same chunks.
+ */
+int frustum_cull_bench(const std::vector<string>& args)
+{
+	chunk_in_world::value_type render_distance = 16;
+	double meshed_fraction = 0.3;
+	std::size_t frames = 200;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--render-distance" && i + 1 < args.size())
+		{
+			render_distance = std::max<chunk_in_world::value_type>(std::stoll(args[++i]), 0);
+		}
+		else if(args[i] == "--meshed" && i + 1 < args.size())
+		{
+			meshed_fraction = std::clamp(std::stod(args[++i]), 0.0, 1.0);
+		}
+		else if(args[i] == "--frames" && i + 1 < args.size())
+		{
+			frames = static_cast<std::size_t>(std::max<int64_t>(std::stoll(args[++i]), 1));
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> chance(0, 1);
+
+	// the chunks around a camera that stays within a few chunks of the origin, with some of them empty or not loaded
+	const chunk_in_world::value_type wander = 2;
+	const world::view_sphere sphere(render_distance + wander);
+	locked_chunks chunks;
+	graphics::chunk_cull_list list;
+	for(const chunk_in_world& pos : sphere.get_offsets())
+	{
+		if(chance(random) < meshed_fraction)
+		{
+			chunks.add(pos);
+			list.set(pos, nullptr);
+		}
+	}
+
+	std::uniform_int_distribution<chunk_in_world::value_type> chunk_offset(-wander, wander);
+	std::uniform_real_distribution<double> in_chunk(0, static_cast<double>(CHUNK_SIZE));
+	std::uniform_real_distribution<double> pitch(-glm::half_pi<double>(), glm::half_pi<double>());
+	std::uniform_real_distribution<double> yaw(0, glm::two_pi<double>());
+	std::vector<camera_view> views;
+	for(std::size_t i = 0; i < frames; ++i)
+	{
+		views.push_back
+		({
+			{chunk_offset(random), chunk_offset(random), chunk_offset(random)},
+			{in_chunk(random), in_chunk(random), in_chunk(random)},
+			{pitch(random), yaw(random), 0},
+			i % 2 == 1,
+		});
+	}
+
+	uint64_t cube_drawn = 0;
+	std::vector<chunk_in_world> drawn;
+	auto start = std::chrono::steady_clock::now();
+	for(const camera_view& view : views)
+	{
+		drawn.clear();
+		cull_cube(view, chunks, render_distance, drawn);
+		cube_drawn += drawn.size();
+	}
+	const double cube_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t list_drawn = 0;
+	std::vector<std::size_t> inside;
+	start = std::chrono::steady_clock::now();
+	for(const camera_view& view : views)
+	{
+		drawn.clear();
+		cull_list(view, list, render_distance, inside, drawn);
+		list_drawn += drawn.size();
+	}
+	const double list_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// each chunk against default_view_frustum::inside, and the chunks each way draws
+	uint64_t wrong_culls = 0;
+	uint64_t wrong_frames = 0;
+	std::vector<chunk_in_world> cube_chunks;
+	for(const camera_view& view : views)
+	{
+		const graphics::default_view_frustum frustum = make_frustum(view);
+		drawn.clear();
+		cull_list(view, list, render_distance, inside, drawn);
+		std::vector<bool> is_inside(list.size(), false);
+		for(const std::size_t i : inside)
+		{
+			is_inside[i] = true;
+		}
+		for(std::size_t i = 0; i < list.size(); ++i)
+		{
+			const chunk_in_world gpos(list.get_position(i) - view.chunk);
+			if(frustum.inside(physics::AABB(gpos)) != is_inside[i])
+			{
+				if(wrong_culls == 0)
+				{
+					std::cerr << "chunk " << list.get_position(i) << " is culled differently than by default_view_frustum\n";
+				}
+				++wrong_culls;
+			}
+		}
+
+		cube_chunks.clear();
+		cull_cube(view, chunks, render_distance, cube_chunks);
+		const auto less = [](const chunk_in_world& a, const chunk_in_world& b)
+		{
+			return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+		};
+		std::sort(drawn.begin(), drawn.end(), less);
+		std::sort(cube_chunks.begin(), cube_chunks.end(), less);
+		if(drawn != cube_chunks)
+		{
+			++wrong_frames;
+		}
+	}
+
+	std::cout << "render distance " << render_distance << ", " << list.size() << " chunks with a mesh, "
+			  << frames << " frames\n"
+			  << "                  µs per frame  chunks drawn per frame\n";
+	const auto print = [frames](const char* name, const double seconds, const uint64_t drawn_total)
+	{
+		std::cout << std::left << std::setw(15) << name << std::right
+				  << std::fixed << std::setprecision(1) << std::setw(15) << seconds * 1e6 / static_cast<double>(frames)
+				  << std::setw(24) << static_cast<double>(drawn_total) / static_cast<double>(frames) << '\n';
+	};
+	print("every position", cube_seconds, cube_drawn);
+	print("cull list", list_seconds, list_drawn);
+	std::cout << "speedup: " << std::setprecision(2) << cube_seconds / list_seconds << "x"
+#ifdef __AVX__
+			  << " (AVX)"
+#else
+			  << " (without AVX)"
+#endif
+			  << '\n';
+	if(wrong_frames != 0)
+	{
+		std::cerr << wrong_frames << " frames draw different chunks\n";
+	}
+
+	return wrong_culls + wrong_frames == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
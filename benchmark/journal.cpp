@@ -0,0 +1,160 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/codec.hpp"
+#include "storage/edit_journal.hpp"
+#include "util/filesystem.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::block_in_chunk;
+using position::block_in_world;
+using position::chunk_in_world;
+
+/*
+ * Bytes written while building in a few chunks: saving each changed chunk every tick (what was done before the
+ * journal) compared to journaling the changes and saving each chunk once when compacting
+ */
+int journal_bench(const std::vector<string>& args)
+{
+	std::size_t edit_count = 2000;
+	std::size_t edits_per_tick = 2;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--edits" && i + 1 < args.size())
+		{
+			edit_count = std::stoul(args[++i]);
+		}
+		else if(args[i] == "--per-tick" && i + 1 < args.size())
+		{
+			edits_per_tick = std::max<std::size_t>(std::stoul(args[++i]), 1);
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_journal";
+	fs::remove_all(world_dir);
+	bool ok = true;
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+
+		// a builder working in 2x1x2 chunks
+		std::vector<std::shared_ptr<Chunk>> chunks;
+		std::vector<std::shared_ptr<Chunk>> originals;
+		for(const chunk_in_world& pos : {chunk_in_world(0, 0, 0), chunk_in_world(1, 0, 0), chunk_in_world(0, 0, 1), chunk_in_world(1, 0, 1)})
+		{
+			for(auto* v : {&chunks, &originals})
+			{
+				auto chunk = std::make_shared<Chunk>(pos, world);
+				world.gen_chunk(chunk);
+				v->emplace_back(std::move(chunk));
+			}
+		}
+
+		const fs::path journal_path = world_dir / "bench_journal";
+		std::mt19937 random(1);
+		std::uniform_int_distribution<int64_t> coord(0, 2 * CHUNK_SIZE - 1);
+		std::uniform_int_distribution<uint32_t> block(1, 2);
+
+		uint64_t full_save_bytes = 0;
+		uint64_t journal_bytes = 0;
+		const auto start = std::chrono::steady_clock::now();
+		{
+			storage::edit_journal journal(journal_path, std::chrono::milliseconds(100));
+			std::vector<bool> changed(chunks.size(), false);
+			auto save_changed = [&]()
+			{
+				for(std::size_t c = 0; c < chunks.size(); ++c)
+				{
+					if(changed[c])
+					{
+						const string stored = storage::encode(storage::codec::lz, storage::chunk_format::write(chunks[c]->snapshot()));
+						full_save_bytes += stored.size();
+						changed[c] = false;
+					}
+				}
+			};
+			for(std::size_t i = 0; i < edit_count; ++i)
+			{
+				const block_in_world pos(coord(random), coord(random) % CHUNK_SIZE, coord(random));
+				const block_t b(block(random), 0);
+				const chunk_in_world chunk_pos(pos);
+				const std::size_t c = static_cast<std::size_t>(chunk_pos.x + 2 * chunk_pos.z);
+				chunks[c]->set_block(block_in_chunk(pos), b);
+				changed[c] = true;
+				journal.append(pos, b);
+				if((i + 1) % edits_per_tick == 0)
+				{
+					save_changed();
+				}
+			}
+			save_changed();
+			journal.commit();
+			journal_bytes = journal.bytes_written();
+			// destroyed without compacting, like a crash
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// one image of each chunk when compacting
+		uint64_t compaction_bytes = 0;
+		for(const auto& chunk : chunks)
+		{
+			compaction_bytes += storage::encode(storage::codec::lz, storage::chunk_format::write(chunk->snapshot())).size();
+		}
+
+		// recovery: the changes on top of the images from before them
+		{
+			storage::edit_journal journal(journal_path, std::chrono::milliseconds(100));
+			for(std::size_t c = 0; c < chunks.size(); ++c)
+			{
+				journal.replay(*originals[c]);
+				if(*originals[c]->snapshot().blocks != *chunks[c]->snapshot().blocks)
+				{
+					std::cerr << "chunk " << chunks[c]->get_position() << " was not recovered from the journal\n";
+					ok = false;
+				}
+			}
+		}
+
+		const uint64_t journaled = journal_bytes + compaction_bytes;
+		std::cout << edit_count << " block changes, " << edits_per_tick << " per tick, in " << chunks.size() << " chunks ("
+				  << std::fixed << std::setprecision(1) << seconds * 1000 << " ms)\n"
+				  << "saving changed chunks each tick: " << full_save_bytes << " bytes\n"
+				  << "journal + one compaction:        " << journaled << " bytes (" << journal_bytes << " + " << compaction_bytes << ")\n"
+				  << "write amplification cut by " << static_cast<double>(full_save_bytes) / static_cast<double>(journaled) << "x\n"
+				  << "recovered from the journal: " << ok << '\n';
+	}
+	fs::remove_all(world_dir);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmarks.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+struct entry
+{
+	const char* name;
+	int (*run)(const std::vector<string>&);
+	const char* description;
+};
+
+static const entry benchmarks[]
+{
+	{"chunk_format", &chunk_format_bench, "save and load time and size of the binary chunk format compared to msgpack, and check that chunks load as they were saved"},
+	{"chunk_light", &chunk_light_bench, "disk size and load time of chunks saved with their light compared to saved without it and lit when loaded, and check that the light is the same"},
+	{"chunk_load", &chunk_load_bench, "time, allocations and bytes copied per chunk when loading from region files, mapped compared to read into strings"},
+	{"chunk_order", &chunk_order_bench, "time until the chunks around a joining player, those in front of them, and every chunk within render distance load on simulated workers, requested in the old cube order, nearest first, and in front first [--render-distance n] [--workers n] [--job-ms ms] [--look-weight 0 to 1]"},
+	{"codec", &codec_bench, "save and load throughput and size of each chunk codec, on a saved world or generated terrain [--world path]"},
+	{"determinism", &determinism_bench, "generate the same chunks with 1 to n threads in shuffled orders and check that every chunk hashes the same, and the bytes that not saving them avoids [--columns n] [--stack n] [--threads n]"},
+	{"frustum_cull", &frustum_cull_bench, "frame time of culling the chunks with a mesh in batches compared to testing every position within render distance, and check that both cull the same as default_view_frustum [--render-distance n] [--meshed 0 to 1] [--frames n]"},
+	{"journal", &journal_bench, "bytes written while building: saving each changed chunk every tick compared to the edit journal, and check that the journal recovers the changes [--edits n] [--per-tick n]"},
+	{"mesher", &mesher_bench, "mesh synthetic chunks with every mesher and check the output against golden hashes [--update] [--golden path]"},
+	{"occlusion", &occlusion_bench, "chunks hidden from a camera in a tunnel, on the ground and in open air by searching thru the faces each chunk connects, and the time of the search, and check face_connectivity and which chunks are visible [--render-distance n] [--repeat n]"},
+	{"pending_light", &pending_light_bench, "size of the light changes waiting for unloaded chunks as saved before and by chunk now, and check that they read back deduplicated [--changes n] [--chunks n]"},
+	{"prefetch", &prefetch_bench, "holes in the world around a fast simulated player without and with prefetching ahead of them, and the prefetch hit rate [--speed blocks/s] [--turn s] [--render-distance n] [--workers n] [--job-ms ms] [--seconds s]"},
+	{"terrain", &terrain_bench, "heightmaps made with batch_simplex compared to glm::simplex (and check that they match), and generation throughput compared to filling one block at a time (and check that the chunks match) [--columns n] [--stack n]"},
+	{"thread_pool", &thread_pool_bench, "job throughput of util::ThreadThingy compared to its old sleep loop"},
+};
+
+static void print_usage(const char* argv0)
+{
+	std::cerr << "usage: " << argv0 << " <benchmark> [args...]\n";
+	for(const entry& e : benchmarks)
+	{
+		std::cerr << "  " << e.name << ": " << e.description << '\n';
+	}
+}
+
+}
+
+using namespace block_thingy::benchmark;
+
+int main(const int argc, char** argv)
+{
+	std::cout << std::boolalpha;
+	std::cerr << std::boolalpha;
+
+	if(argc < 2)
+	{
+		print_usage(argv[0]);
+		return 2;
+	}
+
+	const string name = argv[1];
+	const std::vector<string> args(argv + 2, argv + argc);
+	for(const entry& e : benchmarks)
+	{
+		if(name == e.name)
+		{
+			return e.run(args);
+		}
+	}
+
+	std::cerr << "unknown benchmark: " << name << '\n';
+	print_usage(argv[0]);
+	return 2;
+}
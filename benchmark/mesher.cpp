@@ -0,0 +1,409 @@
+#include "benchmarks.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "block/manager.hpp"
+#include "block/enums/visibility_type.hpp"
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/base.hpp"
+#include "chunk/Mesher/Greedy.hpp"
+#include "chunk/Mesher/LOD.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "chunk/Mesher/Simple2.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/chunk_in_world.hpp"
+#include "util/crc32.hpp"
+#include "util/filesystem.hpp"
+#include "world/world.hpp"
+
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+
+namespace block_thingy::benchmark {
+
+using block::enums::visibility_type;
+using position::block_in_chunk;
+using position::chunk_in_world;
+
+namespace {
+
+struct scenario
+{
+	string name;
+	shared_ptr<Chunk> chunk;
+};
+
+struct mesher_entry
+{
+	string name;
+	unique_ptr<mesher::base> mesher;
+};
+
+struct blocks_t
+{
+	block_t air;
+	block_t stone;
+	block_t glass_a;
+	block_t glass_b;
+};
+
+}
+
+static block_t make_block
+(
+	block::manager& block_manager,
+	const string& strid,
+	const visibility_type visibility
+)
+{
+	const block_t block = block_manager.create();
+	block_manager.set_strid(block, strid);
+	block_manager.info.visibility_type(block, visibility);
+	// the default shader is fine, but distinct shaders split the meshes like real blocks do
+	block_manager.info.shader_path(block, "shaders/block/" + strid);
+	return block;
+}
+
+static blocks_t make_blocks(block::manager& block_manager)
+{
+	// these are the IDs that world::gen_chunk uses
+	make_block(block_manager, "test_white", visibility_type::opaque);
+	make_block(block_manager, "test_black", visibility_type::opaque);
+	return
+	{
+		block_manager.AIR,
+		make_block(block_manager, "stone"  , visibility_type::opaque),
+		make_block(block_manager, "glass_a", visibility_type::translucent),
+		make_block(block_manager, "glass_b", visibility_type::translucent),
+	};
+}
+
+static void fill(Chunk& chunk, const std::function<block_t(const block_in_chunk&)>& f)
+{
+	block_in_chunk pos;
+	for(pos.x = 0; pos.x < CHUNK_SIZE; ++pos.x)
+	for(pos.y = 0; pos.y < CHUNK_SIZE; ++pos.y)
+	for(pos.z = 0; pos.z < CHUNK_SIZE; ++pos.z)
+	{
+		chunk.set_block(pos, f(pos));
+	}
+}
+
+static std::vector<scenario> make_scenarios(world::world& world, const blocks_t& blocks)
+{
+	std::vector<scenario> scenarios;
+	// far apart, so that the meshers never see a neighbor
+	auto add = [&world, &scenarios](const string& name) -> Chunk&
+	{
+		const chunk_in_world pos(static_cast<chunk_in_world::value_type>(scenarios.size() * 4), 1000, 0);
+		scenarios.push_back({name, std::make_shared<Chunk>(pos, world)});
+		return *scenarios.back().chunk;
+	};
+
+	add("air");
+
+	fill(add("solid"), [&blocks](const block_in_chunk&)
+	{
+		return blocks.stone;
+	});
+
+	fill(add("checkerboard"), [&blocks](const block_in_chunk& pos)
+	{
+		return ((pos.x + pos.y + pos.z) % 2 == 0) ? blocks.stone : blocks.air;
+	});
+
+	{
+		// gen_chunk only makes terrain below y = 0, and this chunk has the surface in it
+		shared_ptr<Chunk> chunk = std::make_shared<Chunk>(chunk_in_world(0, -1, 0), world);
+		world.gen_chunk(chunk);
+		scenarios.push_back({"terrain", chunk});
+	}
+
+	// the raw output of std::mt19937 is the same everywhere (the distributions are not)
+	std::mt19937 random(1234);
+	fill(add("translucent_mix"), [&blocks, &random](const block_in_chunk&)
+	{
+		const block_t choices[] {blocks.air, blocks.stone, blocks.glass_a, blocks.glass_b};
+		return choices[random() % 4];
+	});
+
+	fill(add("translucent_solid"), [&blocks, &random](const block_in_chunk&)
+	{
+		return (random() % 8 == 0) ? blocks.glass_b : blocks.glass_a;
+	});
+
+	return scenarios;
+}
+
+static std::vector<mesher_entry> make_meshers()
+{
+	std::vector<mesher_entry> meshers;
+	meshers.push_back({"simple", std::make_unique<mesher::simple>()});
+	meshers.push_back({"simple2", std::make_unique<mesher::simple2>()});
+	meshers.push_back({"greedy", std::make_unique<mesher::greedy>()});
+	for(uint8_t level = 1; level < mesher::LOD_LEVEL_COUNT; ++level)
+	{
+		meshers.push_back({"lod" + std::to_string(level), std::make_unique<mesher::lod>(level)});
+	}
+	return meshers;
+}
+
+static mesher::meshmap_t make_section_meshes(mesher::base& mesher, const Chunk& chunk)
+{
+	mesher::meshmap_t meshes;
+	for(uint8_t section = 0; section < mesher::SECTION_COUNT; ++section)
+	{
+		for(const auto& p : mesher.make_section_mesh(chunk, section))
+		{
+			mesher::mesh_t& mesh = meshes[p.first];
+			mesh.insert(mesh.end(), p.second.cbegin(), p.second.cend());
+		}
+	}
+	return meshes;
+}
+
+static std::size_t triangle_count(const mesher::meshmap_t& meshes)
+{
+	std::size_t count = 0;
+	for(const auto& p : meshes)
+	{
+		count += p.second.size();
+	}
+	return count;
+}
+
+/*
+ * Every byte of the output, so that any change to it changes the hash
+ */
+static string serialize(const mesher::meshmap_t& meshes)
+{
+	string bytes;
+	for(const auto& p : meshes)
+	{
+		bytes += p.first.shader_path.u8string();
+		bytes += '\0';
+		bytes += static_cast<char>(p.first.is_translucent);
+		bytes += static_cast<char>(p.first.tex_unit);
+		bytes.append(reinterpret_cast<const char*>(p.second.data()), p.second.size() * sizeof(mesher::mesh_triangle_t));
+	}
+	return bytes;
+}
+
+/*
+ * Twice the area of the faces of each mesh
+ * Meshers that merge faces differently still cover the same area
+ */
+static std::map<mesher::meshmap_key_t, uint64_t> face_area(const mesher::meshmap_t& meshes)
+{
+	std::map<mesher::meshmap_key_t, uint64_t> area;
+	for(const auto& p : meshes)
+	{
+		uint64_t sum = 0;
+		for(const mesher::mesh_triangle_t& triangle : p.second)
+		{
+			const glm::ivec3 v0(triangle[0].pos);
+			const glm::ivec3 a = glm::ivec3(triangle[1].pos) - v0;
+			const glm::ivec3 b = glm::ivec3(triangle[2].pos) - v0;
+			// the faces are axis-aligned, so only one component of the cross product is non-zero
+			const glm::ivec3 cross
+			(
+				a.y * b.z - a.z * b.y,
+				a.z * b.x - a.x * b.z,
+				a.x * b.y - a.y * b.x
+			);
+			sum += static_cast<uint64_t>(std::abs(cross.x) + std::abs(cross.y) + std::abs(cross.z));
+		}
+		if(sum != 0)
+		{
+			area.emplace(p.first, sum);
+		}
+	}
+	return area;
+}
+
+static string hex(const uint32_t value)
+{
+	std::ostringstream ss;
+	ss << std::hex << std::setw(8) << std::setfill('0') << value;
+	return ss.str();
+}
+
+static std::map<string, string> read_golden(const fs::path& path)
+{
+	std::map<string, string> golden;
+	std::ifstream stream(path);
+	string line;
+	while(std::getline(stream, line))
+	{
+		if(line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		std::istringstream ss(line);
+		string mesher_name, scenario_name, hash;
+		if(ss >> mesher_name >> scenario_name >> hash)
+		{
+			golden.emplace(mesher_name + ' ' + scenario_name, hash);
+		}
+	}
+	return golden;
+}
+
+int mesher_bench(const std::vector<string>& args)
+{
+	bool update = false;
+	fs::path golden_path = fs::path(BT_BENCHMARK_DIR) / ("mesher_golden_" BT_CHUNK_SIZE_STR ".txt");
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--update")
+		{
+			update = true;
+		}
+		else if(args[i] == "--golden" && i + 1 < args.size())
+		{
+			golden_path = args[++i];
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_mesher";
+	fs::remove_all(world_dir);
+	bool ok = true;
+	std::ostringstream new_golden;
+	new_golden << "# mesher output hashes for chunk size " BT_CHUNK_SIZE_STR "\n";
+	new_golden << "# regenerate with: bt_bench mesher --update\n";
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		const blocks_t blocks = make_blocks(world.block_manager);
+		const std::vector<scenario> scenarios = make_scenarios(world, blocks);
+		const std::vector<mesher_entry> meshers = make_meshers();
+		const bool have_golden = !update && fs::exists(golden_path);
+		if(!update && !have_golden)
+		{
+			// otherwise a missing file would pass every check
+			std::cout << "FAIL: no golden hashes in " << golden_path.u8string() << " (run with --update to write them)\n";
+			ok = false;
+		}
+		const std::map<string, string> golden = have_golden ? read_golden(golden_path) : std::map<string, string>();
+
+		std::cout << std::left
+				  << std::setw(10) << "mesher"
+				  << std::setw(20) << "scenario"
+				  << std::right
+				  << std::setw(12) << "chunks/s"
+				  << std::setw(14) << "triangles"
+				  << std::setw(14) << "bytes"
+				  << std::setw(12) << "crc32"
+				  << '\n';
+
+		for(const scenario& s : scenarios)
+		{
+			const Chunk& chunk = *s.chunk;
+			const mesher::meshmap_t reference = meshers[0].mesher->make_mesh(chunk);
+			const string reference_bytes = serialize(reference);
+			const auto reference_area = face_area(reference);
+
+			for(const mesher_entry& m : meshers)
+			{
+				using clock = std::chrono::steady_clock;
+				mesher::meshmap_t meshes;
+				uint64_t iterations = 0;
+				const auto start = clock::now();
+				auto elapsed = clock::duration::zero();
+				while(iterations < 3 || elapsed < std::chrono::milliseconds(250))
+				{
+					meshes = m.mesher->make_mesh(chunk);
+					++iterations;
+					elapsed = clock::now() - start;
+				}
+				const double seconds = std::chrono::duration<double>(elapsed).count();
+
+				const string bytes = serialize(meshes);
+				const string hash = hex(util::crc32(bytes));
+				const std::size_t triangles = triangle_count(meshes);
+
+				std::cout << std::left
+						  << std::setw(10) << m.name
+						  << std::setw(20) << s.name
+						  << std::right
+						  << std::setw(12) << std::fixed << std::setprecision(1) << (iterations / seconds)
+						  << std::setw(14) << triangles
+						  << std::setw(14) << triangles * sizeof(mesher::mesh_triangle_t)
+						  << std::setw(12) << hash
+						  << '\n';
+
+				const string golden_key = m.name + ' ' + s.name;
+				new_golden << golden_key << ' ' << hash << ' ' << triangles << '\n';
+				if(have_golden)
+				{
+					const auto i = golden.find(golden_key);
+					if(i == golden.cend())
+					{
+						std::cout << "  FAIL: no golden hash (run with --update if this mesher or scenario is new)\n";
+						ok = false;
+					}
+					else if(i->second != hash)
+					{
+						std::cout << "  FAIL: output changed (golden hash is " << i->second << ")\n";
+						ok = false;
+					}
+				}
+
+				// LOD meshes are meant to differ from the full-resolution ones
+				if(m.name == "simple2" && bytes != reference_bytes)
+				{
+					std::cout << "  FAIL: output differs from simple\n";
+					ok = false;
+				}
+				if(m.name == "greedy" && face_area(meshes) != reference_area)
+				{
+					std::cout << "  FAIL: face area differs from simple\n";
+					ok = false;
+				}
+				if(m.mesher->has_sections())
+				{
+					const mesher::meshmap_t section_meshes = make_section_meshes(*m.mesher, chunk);
+					// greedy can not merge faces across sections, so only the area is the same
+					const bool same = (m.name == "greedy")
+						? face_area(section_meshes) == face_area(meshes)
+						: serialize(section_meshes) == bytes;
+					if(!same)
+					{
+						std::cout << "  FAIL: section meshes differ from the whole mesh\n";
+						ok = false;
+					}
+				}
+			}
+		}
+	}
+	fs::remove_all(world_dir);
+
+	if(update)
+	{
+		std::ofstream(golden_path) << new_golden.str();
+		std::cout << "wrote " << golden_path.u8string() << '\n';
+	}
+
+	std::cout << (ok ? "all checks passed" : "some checks failed") << '\n';
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,255 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "block/enums/Face.hpp"
+#include "chunk/face_connectivity.hpp"
+#include "fwd/chunk/Chunk.hpp"
+#include "graphics/chunk_occlusion.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "world/view_sphere.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using block::enums::Face;
+using position::chunk_in_world;
+
+/*
+ * Blocks that are opaque in the box from min to max (inclusive), in block coordinates inside a chunk
+ */
+static void fill
+(
+	face_connectivity::opaque_t& opaque,
+	const chunk_in_world& min,
+	const chunk_in_world& max,
+	const bool value
+)
+{
+	for(int64_t x = min.x; x <= max.x; ++x)
+	for(int64_t y = min.y; y <= max.y; ++y)
+	for(int64_t z = min.z; z <= max.z; ++z)
+	{
+		opaque[static_cast<std::size_t>(x * CHUNK_SIZE * CHUNK_SIZE + y * CHUNK_SIZE + z)] = value;
+	}
+}
+
+static face_connectivity::opaque_t solid()
+{
+	face_connectivity::opaque_t opaque;
+	opaque.set();
+	return opaque;
+}
+
+/*
+ * Solid, with a tunnel thru the middle along x
+ */
+static face_connectivity::opaque_t tunnel_x()
+{
+	face_connectivity::opaque_t opaque = solid();
+	const int64_t mid = CHUNK_SIZE / 2;
+	fill(opaque, {0, mid - 1, mid - 1}, {CHUNK_SIZE - 1, mid, mid}, false);
+	return opaque;
+}
+
+/*
+ * Solid below the middle, air above
+ */
+static face_connectivity::opaque_t ground()
+{
+	face_connectivity::opaque_t opaque;
+	fill(opaque, {0, 0, 0}, {CHUNK_SIZE - 1, CHUNK_SIZE / 2 - 1, CHUNK_SIZE - 1}, true);
+	return opaque;
+}
+
+static uint64_t check_connectivity()
+{
+	uint64_t wrong = 0;
+	const auto check = [&wrong](const char* name, const bool ok)
+	{
+		if(!ok)
+		{
+			std::cerr << "face_connectivity: " << name << " is wrong\n";
+			++wrong;
+		}
+	};
+	const int64_t mid = CHUNK_SIZE / 2;
+
+	check("air", face_connectivity(face_connectivity::opaque_t()).all_connected());
+	check("default", face_connectivity().all_connected());
+
+	const face_connectivity stone(solid());
+	check("stone", !stone.connected(Face::left, Face::right) && !stone.connected(Face::top, Face::top));
+
+	const face_connectivity tunnel(tunnel_x());
+	check("tunnel", tunnel.connected(Face::left, Face::right) && tunnel.connected(Face::right, Face::right)
+		&& !tunnel.connected(Face::left, Face::top) && !tunnel.connected(Face::top, Face::bottom)
+		&& !tunnel.connected(Face::front, Face::back));
+
+	// from the left face to the middle, then up to the top face
+	face_connectivity::opaque_t bend = solid();
+	fill(bend, {0, mid, mid}, {mid, mid, mid}, false);
+	fill(bend, {mid, mid, mid}, {mid, CHUNK_SIZE - 1, mid}, false);
+	const face_connectivity l(bend);
+	check("bend", l.connected(Face::left, Face::top) && !l.connected(Face::left, Face::right)
+		&& !l.connected(Face::top, Face::bottom));
+
+	// a cave that touches no face
+	face_connectivity::opaque_t cave = solid();
+	fill(cave, {2, 2, 2}, {CHUNK_SIZE - 3, CHUNK_SIZE - 3, CHUNK_SIZE - 3}, false);
+	check("cave", face_connectivity(cave) == stone);
+
+	const face_connectivity g(ground());
+	check("ground", g.connected(Face::top, Face::left) && g.connected(Face::front, Face::right)
+		&& !g.connected(Face::bottom, Face::top) && !g.connected(Face::bottom, Face::bottom));
+
+	face_connectivity set;
+	set.set_connected(Face::front, Face::back, false);
+	check("set_connected", !set.connected(Face::back, Face::front) && set.connected(Face::back, Face::back)
+		&& !set.all_connected());
+
+	return wrong;
+}
+
+struct test_world
+{
+	const char* name;
+	// the chunks that are not all connected; the others are seen thru
+	position::unordered_map_t<chunk_in_world, face_connectivity> chunks;
+	// the camera is in {0, 0, 0}
+	bool (*is_visible)(const test_world&, const chunk_in_world& offset);
+};
+
+/*
+ * Runs the search repeat times and checks that is_visible agrees with the world's expectation for every chunk within
+ * render distance
+ */
+static uint64_t run
+(
+	const test_world& test,
+	const chunk_in_world::value_type render_distance,
+	const std::size_t repeat
+)
+{
+	const graphics::chunk_occlusion::connectivity_getter get = [&test](const chunk_in_world& pos) -> const face_connectivity*
+	{
+		const auto i = test.chunks.find(pos);
+		return i != test.chunks.cend() ? &i->second : nullptr;
+	};
+	graphics::chunk_occlusion occlusion;
+	const auto start = std::chrono::steady_clock::now();
+	for(std::size_t i = 0; i < repeat; ++i)
+	{
+		occlusion.update({0, 0, 0}, render_distance, get);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const world::view_sphere sphere(render_distance);
+	uint64_t wrong = 0;
+	for(const chunk_in_world& offset : sphere.get_offsets())
+	{
+		if(occlusion.is_visible(offset) != test.is_visible(test, offset))
+		{
+			if(wrong == 0)
+			{
+				std::cerr << test.name << ": chunk " << offset << " should " << (occlusion.is_visible(offset) ? "not " : "")
+						  << "be visible\n";
+			}
+			++wrong;
+		}
+	}
+
+	const std::size_t total = sphere.get_offsets().size();
+	const std::size_t visible = occlusion.get_visible_count();
+	std::cout << std::left << std::setw(10) << test.name << std::right
+			  << std::setw(10) << total
+			  << std::setw(10) << visible
+			  << std::setw(9) << std::fixed << std::setprecision(1)
+			  << 100.0 * static_cast<double>(total - visible) / static_cast<double>(total) << '%'
+			  << std::setw(14) << seconds * 1e6 / static_cast<double>(repeat) << '\n';
+	return wrong;
+}
+
+/*
+ * Chunks in a wall or underground are hidden, but a chunk without a mesh is not drawn anyway, so draw_world only saves
+ * the chunks that would be drawn. This checks face_connectivity on a few chunks with known answers, then searches from
+ * a camera in a tunnel thru solid rock (where only the tunnel can be seen), on the ground (where the chunks under the
+ * topmost layer of ground are hidden) and in open air (where nothing is), and reports how many chunks are culled and
+ * how long the search takes.
+ */
+int occlusion_bench(const std::vector<string>& args)
+{
+	chunk_in_world::value_type render_distance = 16;
+	std::size_t repeat = 20;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--render-distance" && i + 1 < args.size())
+		{
+			render_distance = std::max<chunk_in_world::value_type>(std::stoll(args[++i]), 1);
+		}
+		else if(args[i] == "--repeat" && i + 1 < args.size())
+		{
+			repeat = static_cast<std::size_t>(std::max<int64_t>(std::stoll(args[++i]), 1));
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	uint64_t wrong = check_connectivity();
+
+	const world::view_sphere sphere(render_distance);
+	const face_connectivity stone(solid());
+	const face_connectivity tunnel(tunnel_x());
+	const face_connectivity ground_top(ground());
+
+	test_world cave{"tunnel", {}, [](const test_world&, const chunk_in_world& offset)
+	{
+		// the tunnel, and the rock around the camera's chunk (the tunnel's walls in the other chunks are part of them)
+		const int64_t off_axis = std::abs(offset.y) + std::abs(offset.z);
+		return off_axis == 0 || (offset.x == 0 && off_axis == 1);
+	}};
+	test_world hill{"ground", {}, [](const test_world&, const chunk_in_world& offset)
+	{
+		return offset.y >= -1;
+	}};
+	test_world air{"air", {}, [](const test_world&, const chunk_in_world&)
+	{
+		return true;
+	}};
+	for(const chunk_in_world& offset : sphere.get_offsets())
+	{
+		cave.chunks.emplace(offset, offset.y == 0 && offset.z == 0 ? tunnel : stone);
+		if(offset.y == -1)
+		{
+			hill.chunks.emplace(offset, ground_top);
+		}
+		else if(offset.y < -1)
+		{
+			hill.chunks.emplace(offset, stone);
+		}
+	}
+
+	std::cout << "render distance " << render_distance << ", " << repeat << " searches each\n"
+			  << "camera        chunks   visible   culled  µs per search\n";
+	for(const test_world* test : {&cave, &hill, &air})
+	{
+		wrong += run(*test, render_distance, repeat);
+	}
+
+	return wrong == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
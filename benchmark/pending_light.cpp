@@ -0,0 +1,202 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <msgpack.hpp>
+
+#include "graphics/color.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "storage/msgpack/color.hpp"
+#include "storage/msgpack/position.hpp"
+#include "world/pending_light.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::block_in_chunk;
+using position::block_in_world;
+using position::chunk_in_world;
+
+namespace {
+
+using block_key = std::tuple<int, int, int>;
+
+block_key key_of(const block_in_chunk& pos)
+{
+	return {pos.x, pos.y, pos.z};
+}
+
+}
+
+/*
+ * Light changes queued for unloaded chunks, as the world file kept them before (every queued change, in msgpack) and
+ * as it keeps them now (pending_light for each chunk), and check that pending_light keeps each change once
+ */
+int pending_light_bench(const std::vector<string>& args)
+{
+	std::size_t change_count = 200000;
+	std::size_t chunk_count = 64;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--changes" && i + 1 < args.size())
+		{
+			change_count = std::stoul(args[++i]);
+		}
+		else if(args[i] == "--chunks" && i + 1 < args.size())
+		{
+			chunk_count = std::max<std::size_t>(std::stoul(args[++i]), 1);
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+	constexpr std::size_t LAYER_COUNT = world::pending_light::LAYER_COUNT;
+
+	// light flowing into unloaded chunks comes in at their sides, so most changes are at a few blocks
+	std::mt19937 random(1);
+	std::uniform_int_distribution<std::size_t> chunk(0, chunk_count - 1);
+	std::uniform_int_distribution<int> side_coord(0, CHUNK_SIZE - 1);
+	std::uniform_int_distribution<int> side(0, 5);
+	std::uniform_int_distribution<std::size_t> layer(0, LAYER_COUNT - 1);
+	std::uniform_int_distribution<int> channel(0, graphics::color::max);
+	std::bernoulli_distribution is_sub(0.3);
+
+	std::deque<std::tuple<block_in_world, graphics::color>> legacy_subs[LAYER_COUNT];
+	std::deque<block_in_world> legacy_adds[LAYER_COUNT];
+	position::unordered_map_t<chunk_in_world, world::pending_light> pending;
+	// the expected result: for each chunk and layer, each added block and the most of each channel of each sub
+	std::map<std::tuple<std::size_t, std::size_t, block_key>, graphics::color> expected_subs;
+	std::set<std::tuple<std::size_t, std::size_t, block_key>> expected_adds;
+
+	double add_seconds = 0;
+	for(std::size_t i = 0; i < change_count; ++i)
+	{
+		const std::size_t c = chunk(random);
+		const chunk_in_world chunk_pos(static_cast<int64_t>(c % 8), 0, static_cast<int64_t>(c / 8));
+		const int s = side(random);
+		block_in_chunk pos;
+		pos[s / 2] = static_cast<block_in_chunk::value_type>((s % 2 == 0) ? 0 : CHUNK_SIZE - 1);
+		pos[(s / 2 + 1) % 3] = static_cast<block_in_chunk::value_type>(side_coord(random));
+		pos[(s / 2 + 2) % 3] = static_cast<block_in_chunk::value_type>(side_coord(random) % 4);
+		const std::size_t l = layer(random);
+
+		if(is_sub(random))
+		{
+			const graphics::color color
+			(
+				static_cast<uint8_t>(channel(random)),
+				static_cast<uint8_t>(channel(random)),
+				static_cast<uint8_t>(channel(random))
+			);
+			legacy_subs[l].emplace_back(block_in_world(chunk_pos, pos), color);
+			const auto start = std::chrono::steady_clock::now();
+			pending[chunk_pos].sub(l, pos, color);
+			add_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			const auto [e, inserted] = expected_subs.emplace(std::make_tuple(c, l, key_of(pos)), color);
+			for(std::ptrdiff_t j = 0; j < 3 && !inserted; ++j)
+			{
+				e->second[j] = std::max(e->second[j], color[j]);
+			}
+		}
+		else
+		{
+			legacy_adds[l].emplace_back(chunk_pos, pos);
+			const auto start = std::chrono::steady_clock::now();
+			pending[chunk_pos].add(l, pos);
+			add_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			expected_adds.emplace(c, l, key_of(pos));
+		}
+	}
+
+	// before, the world file had every queued change, and every one was queued again on each tick
+	std::stringstream legacy;
+	{
+		msgpack::packer<std::stringstream> o(legacy);
+		o.pack(legacy_subs);
+		o.pack(legacy_adds);
+	}
+	const std::size_t legacy_bytes = legacy.str().size();
+
+	const auto write_start = std::chrono::steady_clock::now();
+	std::vector<std::pair<chunk_in_world, string>> written;
+	std::size_t compact_bytes = 0;
+	std::size_t kept = 0;
+	for(auto& [chunk_pos, light] : pending)
+	{
+		written.emplace_back(chunk_pos, light.write());
+		compact_bytes += written.back().second.size();
+		kept += light.size();
+	}
+	const double write_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
+
+	bool ok = true;
+	std::size_t read_subs = 0;
+	std::size_t read_adds = 0;
+	const auto read_start = std::chrono::steady_clock::now();
+	for(const auto& [chunk_pos, bytes] : written)
+	{
+		world::pending_light light = world::pending_light::read(bytes);
+		const auto c = static_cast<std::size_t>(chunk_pos.x + 8 * chunk_pos.z);
+		light.for_each(
+			[&](const std::size_t l, const block_in_chunk& pos)
+			{
+				++read_adds;
+				if(expected_adds.count(std::make_tuple(c, l, key_of(pos))) == 0)
+				{
+					ok = false;
+				}
+			},
+			[&](const std::size_t l, const block_in_chunk& pos, const graphics::color& color)
+			{
+				++read_subs;
+				const auto e = expected_subs.find(std::make_tuple(c, l, key_of(pos)));
+				if(e == expected_subs.cend() || e->second != color)
+				{
+					ok = false;
+				}
+			}
+		);
+	}
+	const double read_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - read_start).count();
+	if(read_adds != expected_adds.size() || read_subs != expected_subs.size())
+	{
+		ok = false;
+	}
+	if(!ok)
+	{
+		std::cerr << "the pending light read back is not the changes that were made\n";
+	}
+
+	std::cout << change_count << " light changes in " << pending.size() << " unloaded chunks\n"
+			  << std::fixed << std::setprecision(1)
+			  << "queued (before): " << change_count << " changes requeued each tick, " << legacy_bytes << " bytes saved\n"
+			  << "pending_light:   " << kept << " changes kept, " << compact_bytes << " bytes saved ("
+			  << static_cast<double>(legacy_bytes) / static_cast<double>(std::max<std::size_t>(compact_bytes, 1)) << "x smaller)\n"
+			  << std::setprecision(3)
+			  << "add " << add_seconds * 1e9 / static_cast<double>(std::max<std::size_t>(change_count, 1)) << " ns/change, "
+			  << "write " << write_seconds * 1000 << " ms, read + replay " << read_seconds * 1000 << " ms\n"
+			  << "read back correctly: " << ok << '\n';
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,237 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/vec3.hpp>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "world/chunk_prefetcher.hpp"
+#include "world/view_sphere.hpp"
+
+#include "simulated_loader.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::chunk_in_world;
+using world::chunk_prefetcher;
+
+// the same as world.cpp
+constexpr double TICKS_PER_SECOND = 60;
+constexpr std::size_t MAX_PREFETCH_REQUESTS_PER_TICK = 32;
+
+struct flight_options
+{
+	double speed; // blocks per second
+	double turn_seconds;
+	chunk_in_world::value_type render_distance;
+	std::size_t workers;
+	double job_ms;
+	double seconds;
+};
+
+struct flight_result
+{
+	// summed over each tick: the active chunks that were not loaded
+	uint64_t missing;
+	uint64_t ticks_with_holes;
+	uint64_t loaded;
+	world::prefetch_stats prefetch;
+};
+
+/*
+ * A player flying in a straight line, looking where they go, and turning to a random direction every turn_seconds
+ * (the same directions with and without prefetching), with the chunks wanted each tick the way world::step wants them
+ */
+static flight_result fly(const flight_options& options, const bool prefetch)
+{
+	const auto job_ticks = static_cast<uint64_t>(std::max(std::round(options.job_ms / 1000 * TICKS_PER_SECOND), 1.0));
+	simulated_loader loader(options.workers, job_ticks);
+	chunk_prefetcher prefetcher;
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> angle(0, glm::two_pi<double>());
+	std::uniform_real_distribution<double> climb(-0.3, 0.3);
+	glm::dvec3 player_position(0, 0, 0);
+	glm::dvec3 direction(1, 0, 0);
+
+	const auto turn_ticks = static_cast<uint64_t>(std::max(options.turn_seconds * TICKS_PER_SECOND, 1.0));
+	const auto total_ticks = static_cast<uint64_t>(options.seconds * TICKS_PER_SECOND);
+	// the chunks around the start are not counted as holes, since they can not be loaded ahead of time
+	const auto warmup_ticks = static_cast<uint64_t>(TICKS_PER_SECOND);
+	const world::view_sphere sphere(options.render_distance);
+
+	flight_result result{};
+	position::unordered_set_t<chunk_in_world> active;
+	position::unordered_set_t<chunk_in_world> prefetch_chunks;
+	std::vector<chunk_in_world> prefetch_order;
+	for(uint64_t tick = 0; tick < total_ticks; ++tick)
+	{
+		if(tick % turn_ticks == 0)
+		{
+			const double a = angle(random);
+			direction = glm::normalize(glm::dvec3(std::cos(a), climb(random), std::sin(a)));
+		}
+		// the player does not move until the chunks around the start are loaded
+		if(tick >= warmup_ticks)
+		{
+			player_position += direction * (options.speed / TICKS_PER_SECOND);
+		}
+
+		active.clear();
+		prefetch_chunks.clear();
+		prefetch_order.clear();
+		const chunk_in_world center{position::block_in_world(player_position)};
+		for(const chunk_in_world& offset : sphere.get_offsets())
+		{
+			active.emplace(center + offset);
+		}
+		if(prefetch && tick >= warmup_ticks)
+		{
+			prefetcher.plan(player_position, direction * options.speed, direction, sphere, prefetch_order);
+		}
+		for(const chunk_in_world& p : prefetch_order)
+		{
+			if(active.count(p) == 0)
+			{
+				prefetch_chunks.emplace(p);
+			}
+		}
+		prefetcher.update(active, prefetch_chunks, [&loader](const chunk_in_world& p)
+		{
+			return loader.loaded(p);
+		});
+
+		loader.unload_unwanted([&active, &prefetch_chunks](const chunk_in_world& p)
+		{
+			return active.count(p) != 0 || prefetch_chunks.count(p) != 0;
+		});
+		for(const chunk_in_world& p : active)
+		{
+			loader.request(p, false);
+		}
+		std::size_t requests = 0;
+		for(const chunk_in_world& p : prefetch_order)
+		{
+			if(requests == MAX_PREFETCH_REQUESTS_PER_TICK)
+			{
+				break;
+			}
+			if(prefetch_chunks.count(p) != 0 && loader.request(p, true))
+			{
+				prefetcher.requested(p);
+				++requests;
+			}
+		}
+
+		loader.step(tick);
+
+		if(tick < warmup_ticks)
+		{
+			continue;
+		}
+		uint64_t missing = 0;
+		for(const chunk_in_world& p : active)
+		{
+			if(!loader.loaded(p))
+			{
+				++missing;
+			}
+		}
+		result.missing += missing;
+		result.ticks_with_holes += missing != 0;
+	}
+	result.loaded = loader.loaded_total();
+	result.prefetch = prefetcher.get_stats();
+	return result;
+}
+
+/*
+ * A fast player outruns loading and sees holes in the world. This flies a simulated player thru a world whose chunks
+ * take a fixed time to load, without and with chunk_prefetcher, and compares the chunks within render distance that
+ * were not loaded yet. It does not load real chunks, so the results depend only on the options.
+ */
+int prefetch_bench(const std::vector<string>& args)
+{
+	flight_options options;
+	options.speed = 60; // noclip at the fastest
+	options.turn_seconds = 5;
+	options.render_distance = 2;
+	options.workers = 4;
+	options.job_ms = 40;
+	options.seconds = 60;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--speed" && i + 1 < args.size())
+		{
+			options.speed = std::max(std::stod(args[++i]), 0.0);
+		}
+		else if(args[i] == "--turn" && i + 1 < args.size())
+		{
+			options.turn_seconds = std::max(std::stod(args[++i]), 0.0);
+		}
+		else if(args[i] == "--render-distance" && i + 1 < args.size())
+		{
+			options.render_distance = std::max<chunk_in_world::value_type>(std::stoll(args[++i]), 0);
+		}
+		else if(args[i] == "--workers" && i + 1 < args.size())
+		{
+			options.workers = static_cast<std::size_t>(std::max<int64_t>(std::stoll(args[++i]), 1));
+		}
+		else if(args[i] == "--job-ms" && i + 1 < args.size())
+		{
+			options.job_ms = std::max(std::stod(args[++i]), 0.0);
+		}
+		else if(args[i] == "--seconds" && i + 1 < args.size())
+		{
+			options.seconds = std::max(std::stod(args[++i]), 2.0);
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+
+	std::cout << "flying at " << options.speed << " blocks/s for " << options.seconds << " s, turning every "
+			  << options.turn_seconds << " s, render distance " << options.render_distance << ", "
+			  << options.workers << " workers taking " << options.job_ms << " ms per chunk (" << CHUNK_SIZE << "³ chunks)\n";
+	std::cout << "              missing chunk-ticks  ticks with holes  chunks loaded\n";
+	const flight_result without = fly(options, false);
+	const flight_result with = fly(options, true);
+	for(const auto& [name, result] : {std::pair{"no prefetch", &without}, std::pair{"prefetch", &with}})
+	{
+		std::cout << std::setw(11) << name
+				  << std::setw(22) << result->missing
+				  << std::setw(18) << result->ticks_with_holes
+				  << std::setw(15) << result->loaded << '\n';
+	}
+
+	const world::prefetch_stats& stats = with.prefetch;
+	std::cout << "prefetched: " << stats.requested << ", hits: " << stats.hits << " (" << stats.late
+			  << " not loaded in time), wasted: " << stats.wasted;
+	if(stats.hits + stats.wasted != 0)
+	{
+		std::cout << ", hit rate: " << std::fixed << std::setprecision(1)
+				  << static_cast<double>(stats.hits) * 100 / static_cast<double>(stats.hits + stats.wasted) << '%';
+	}
+	std::cout << std::fixed << std::setprecision(2) << ", lookahead: " << stats.lookahead_seconds << " s\n";
+
+	return EXIT_SUCCESS;
+}
+
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <stdint.h>
+#include <vector>
+
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+
+namespace block_thingy::benchmark {
+
+/*
+ * Chunks load on a fixed number of workers that each take job_ms for a chunk, taking normal priority chunks before low
+ * priority ones (like util::thread_pool). A chunk queued with low priority and then wanted with normal priority is
+ * moved up, like util::ThreadThingy does.
+ */
+class simulated_loader
+{
+public:
+	simulated_loader(const std::size_t workers, const uint64_t job_ticks)
+	:
+		workers(workers),
+		job_ticks(job_ticks),
+		loaded_count(0)
+	{
+	}
+
+	bool loaded(const position::chunk_in_world& pos) const
+	{
+		return chunks.count(pos) != 0;
+	}
+
+	/*
+	 * @return false if it is loaded or queued already
+	 */
+	bool request(const position::chunk_in_world& pos, const bool low)
+	{
+		if(loaded(pos))
+		{
+			return false;
+		}
+		const auto [i, emplaced] = jobs.emplace(pos, job{low, false, 0});
+		if(emplaced)
+		{
+			(low ? low_queue : queue).emplace_back(pos);
+		}
+		else if(i->second.low && !i->second.started && !low)
+		{
+			i->second.low = false;
+			queue.emplace_back(pos);
+		}
+		return emplaced;
+	}
+
+	template<typename Wanted>
+	void unload_unwanted(Wanted&& wanted)
+	{
+		for(auto i = chunks.begin(); i != chunks.end();)
+		{
+			i = wanted(*i) ? std::next(i) : chunks.erase(i);
+		}
+		// cancelled; the queues skip chunks that are not in jobs
+		for(auto i = jobs.begin(); i != jobs.end();)
+		{
+			i = wanted(i->first) ? std::next(i) : jobs.erase(i);
+		}
+	}
+
+	void step(const uint64_t tick)
+	{
+		for(auto i = running.begin(); i != running.end();)
+		{
+			const auto j = jobs.find(*i);
+			if(j == jobs.cend())
+			{
+				// cancelled while it ran
+				i = running.erase(i);
+				continue;
+			}
+			if(j->second.done_tick > tick)
+			{
+				++i;
+				continue;
+			}
+			chunks.emplace(*i);
+			jobs.erase(j);
+			++loaded_count;
+			i = running.erase(i);
+		}
+		while(running.size() < workers)
+		{
+			std::deque<position::chunk_in_world>& q = !queue.empty() ? queue : low_queue;
+			if(q.empty())
+			{
+				break;
+			}
+			const position::chunk_in_world pos = q.front();
+			q.pop_front();
+			const auto j = jobs.find(pos);
+			if(j == jobs.cend() || j->second.started)
+			{
+				continue;
+			}
+			j->second.started = true;
+			j->second.done_tick = tick + job_ticks;
+			running.emplace_back(pos);
+		}
+	}
+
+	uint64_t loaded_total() const
+	{
+		return loaded_count;
+	}
+
+private:
+	struct job
+	{
+		bool low;
+		bool started;
+		uint64_t done_tick;
+	};
+
+	std::size_t workers;
+	uint64_t job_ticks;
+	position::unordered_set_t<position::chunk_in_world> chunks;
+	position::unordered_map_t<position::chunk_in_world, job> jobs;
+	std::deque<position::chunk_in_world> queue;
+	std::deque<position::chunk_in_world> low_queue;
+	std::vector<position::chunk_in_world> running;
+	uint64_t loaded_count;
+};
+
+}
@@ -0,0 +1,250 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/Mesher/Simple.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "util/filesystem.hpp"
+#include "world/generator.hpp"
+#include "world/heightmap.hpp"
+#include "world/world.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+using position::block_in_world;
+using position::chunk_in_world;
+
+/*
+ * Heightmaps made with batch_simplex compared to glm::simplex one column at a time (what the generator did before),
+ * and the generator's throughput on stacks of chunks (which share their column's heightmap) compared to filling
+ * one block at a time
+ */
+int terrain_bench(const std::vector<string>& args)
+{
+	int64_t columns_wide = 8;
+	int64_t stack_height = 4;
+	for(std::size_t i = 0; i < args.size(); ++i)
+	{
+		if(args[i] == "--columns" && i + 1 < args.size())
+		{
+			columns_wide = std::max<int64_t>(std::stoll(args[++i]), 1);
+		}
+		else if(args[i] == "--stack" && i + 1 < args.size())
+		{
+			stack_height = std::max<int64_t>(std::stoll(args[++i]), 1);
+		}
+		else
+		{
+			std::cerr << "unknown argument: " << args[i] << '\n';
+			return 2;
+		}
+	}
+	const double seed = 0.5;
+	constexpr auto size = static_cast<std::size_t>(CHUNK_SIZE);
+
+	std::vector<chunk_in_world> columns;
+	for(int64_t x = -columns_wide / 2; x < columns_wide - columns_wide / 2; ++x)
+	for(int64_t z = -columns_wide / 2; z < columns_wide - columns_wide / 2; ++z)
+	{
+		columns.emplace_back(x, 0, z);
+	}
+
+	// glm::simplex for each column of blocks
+	std::vector<world::heightmap::height_t> expected;
+	expected.reserve(columns.size() * size * size);
+	const auto scalar_start = std::chrono::steady_clock::now();
+	for(const chunk_in_world& column : columns)
+	{
+		const block_in_world min(column, {0, 0, 0});
+		for(std::size_t x = 0; x < size; ++x)
+		for(std::size_t z = 0; z < size; ++z)
+		{
+			expected.emplace_back(world::heightmap::surface_at
+			(
+				seed,
+				min.x + static_cast<block_in_world::value_type>(x),
+				min.z + static_cast<block_in_world::value_type>(z)
+			));
+		}
+	}
+	const double scalar_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scalar_start).count();
+
+	// batch_simplex for SIMPLEX_LANES columns at once
+	std::vector<world::heightmap> maps;
+	maps.reserve(columns.size());
+	const auto batch_start = std::chrono::steady_clock::now();
+	for(const chunk_in_world& column : columns)
+	{
+		maps.emplace_back(world::heightmap::make(seed, column));
+	}
+	const double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+
+	// the heights are rounded, so last-bit differences in the noise only matter right at .5
+	uint64_t differing = 0;
+	for(std::size_t c = 0; c < columns.size(); ++c)
+	{
+		for(std::size_t i = 0; i < size * size; ++i)
+		{
+			if(maps[c].heights[i] != expected[c * size * size + i])
+			{
+				++differing;
+			}
+		}
+	}
+
+	// chunks that the heightmap's min and max classify without looking at each column
+	uint64_t above = 0;
+	uint64_t below = 0;
+	uint64_t crossing = 0;
+	const int64_t top = 0;
+	const int64_t bottom = top - stack_height + 1;
+	for(const world::heightmap& map : maps)
+	{
+		for(int64_t y = bottom; y <= top; ++y)
+		{
+			const block_in_world min(chunk_in_world(0, y, 0), {0, 0, 0});
+			const block_in_world max(chunk_in_world(0, y, 0), {CHUNK_SIZE - 1, CHUNK_SIZE - 1, CHUNK_SIZE - 1});
+			if(min.y > map.max)
+			{
+				++above;
+			}
+			else if(max.y <= map.min)
+			{
+				++below;
+			}
+			else
+			{
+				++crossing;
+			}
+		}
+	}
+
+	// the generator, with its heightmap cache, twice: making the heightmaps, and then with them cached
+	const fs::path world_dir = fs::temp_directory_path() / "bt_bench_terrain";
+	fs::remove_all(world_dir);
+	double gen_seconds = 0;
+	double cached_gen_seconds = 0;
+	double per_block_seconds = 0;
+	uint64_t filled = 0;
+	uint64_t mismatched_chunks = 0;
+	world::generator_stats stage_stats {};
+	{
+		world::world world(world_dir, std::make_unique<mesher::simple>());
+		world.set_seed(seed);
+		for(const char* strid : {"test_white", "test_black"})
+		{
+			world.block_manager.set_strid(world.block_manager.create(), strid);
+		}
+		std::vector<std::shared_ptr<Chunk>> chunks;
+		for(double* seconds : {&gen_seconds, &cached_gen_seconds})
+		{
+			chunks.clear();
+			const auto gen_start = std::chrono::steady_clock::now();
+			for(const chunk_in_world& column : columns)
+			{
+				for(int64_t y = bottom; y <= top; ++y)
+				{
+					auto chunk = std::make_shared<Chunk>(chunk_in_world(column.x, y, column.z), world);
+					world.gen_chunk(chunk);
+					chunks.emplace_back(std::move(chunk));
+				}
+			}
+			*seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - gen_start).count();
+		}
+		stage_stats = world.get_generator_stats();
+
+		/*
+		 * What the generator did before it looked up the block IDs once for each chunk and wrote runs of blocks:
+		 * a string and a block_manager lookup, and a set_block, for each block
+		 */
+		std::size_t chunk_i = 0;
+		for(std::size_t c = 0; c < columns.size(); ++c)
+		{
+			for(int64_t y = bottom; y <= top; ++y)
+			{
+				auto chunk = std::make_shared<Chunk>(chunk_in_world(columns[c].x, y, columns[c].z), world);
+				const block_in_world min(chunk->get_position(), {0, 0, 0});
+				const auto start = std::chrono::steady_clock::now();
+				for(std::size_t x = 0; x < size; ++x)
+				for(std::size_t z = 0; z < size; ++z)
+				{
+					const auto max_y = std::min<block_in_world::value_type>(min.y + CHUNK_SIZE - 1, maps[c].at(x, z));
+					for(auto by = min.y; by <= max_y; ++by)
+					{
+						const string t = by > -world::heightmap::DEPTH / 2 ? "test_white" : "test_black";
+						const auto block = world.block_manager.get_block(t);
+						if(block != std::nullopt)
+						{
+							chunk->set_block({static_cast<uint8_t>(x), static_cast<uint8_t>(by - min.y), static_cast<uint8_t>(z)}, *block);
+							++filled;
+						}
+					}
+				}
+				per_block_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if(*chunk->snapshot().blocks != *chunks[chunk_i]->snapshot().blocks)
+				{
+					++mismatched_chunks;
+				}
+				++chunk_i;
+			}
+		}
+	}
+	fs::remove_all(world_dir);
+	if(mismatched_chunks != 0)
+	{
+		std::cerr << mismatched_chunks << " generated chunks differ from the per-block generator\n";
+	}
+
+	const auto column_count = static_cast<double>(columns.size());
+	const auto chunk_count = static_cast<double>(columns.size() * static_cast<std::size_t>(stack_height));
+	auto throughput = [chunk_count, filled](const double seconds)
+	{
+		std::ostringstream ss;
+		ss << std::fixed << std::setprecision(1)
+		   << seconds * 1e6 / chunk_count << " us per chunk, "
+		   << chunk_count / seconds << " chunks/s, "
+		   << static_cast<double>(filled) / seconds / 1e6 << " M blocks/s";
+		return ss.str();
+	};
+	std::cout << columns.size() << " chunk columns, " << stack_height << " chunks high, " << filled << " blocks filled\n"
+			  << std::fixed << std::setprecision(1)
+			  << "heightmap with glm::simplex:   " << scalar_seconds * 1e6 / column_count << " us per chunk column\n"
+			  << "heightmap with batch_simplex:  " << batch_seconds * 1e6 / column_count << " us per chunk column ("
+			  << std::setprecision(2) << scalar_seconds / batch_seconds << "x)\n"
+			  << "heights that differ from glm:  " << differing << " of " << expected.size() << '\n'
+			  << "chunks above the surface: " << above << ", below: " << below << ", crossing it: " << crossing << '\n'
+			  << "generating:                     " << throughput(gen_seconds) << '\n'
+			  << "generating, heightmaps cached:  " << throughput(cached_gen_seconds) << '\n'
+			  << "filling one block at a time:    " << throughput(per_block_seconds) << " (without the heightmaps)\n"
+			  << "generator stages (both passes):\n";
+	for(std::size_t i = 0; i < world::GENERATOR_STAGE_COUNT; ++i)
+	{
+		std::ostringstream name;
+		name << static_cast<world::generator_stage>(i) << ':';
+		std::cout << "  " << std::left << std::setw(12) << name.str() << std::right
+				  << stage_stats.seconds[i] * 1e6 / static_cast<double>(stage_stats.chunks) << " us per chunk\n";
+	}
+
+	if(mismatched_chunks != 0)
+	{
+		return EXIT_FAILURE;
+	}
+	// a few columns exactly at a rounding boundary are expected; many means batch_simplex does not match glm
+	return differing * 1000 <= expected.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,180 @@
+#include "benchmarks.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <concurrentqueue/concurrentqueue.hpp>
+
+#include "util/ThreadThingy.hpp"
+#include "util/thread_pool.hpp"
+
+using std::string;
+
+namespace block_thingy::benchmark {
+
+namespace {
+
+/*
+ * ThreadThingy as it was before it used util::thread_pool, for comparison
+ * Each worker sleeps for 10 ms after every attempt to dequeue
+ */
+template<typename T>
+class sleep_loop_thread_thingy
+{
+public:
+	sleep_loop_thread_thingy
+	(
+		std::function<void(T&)> f,
+		std::size_t thread_count
+	)
+	:
+		running(true)
+	{
+		auto g = [this, f]()
+		{
+			while(running)
+			{
+				T thing;
+				if(things.try_dequeue(thing))
+				{
+					f(thing);
+				}
+				using namespace std::chrono_literals;
+				std::this_thread::sleep_for(10ms);
+			}
+		};
+		for(std::size_t i = 0; i < thread_count; ++i)
+		{
+			threads.emplace_back(g);
+		}
+	}
+
+	~sleep_loop_thread_thingy()
+	{
+		running = false;
+		for(auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	void enqueue(const T& thing)
+	{
+		bool emplaced;
+		{
+			std::lock_guard<std::mutex> g(queued_mutex);
+			emplaced = queued.emplace(thing).second;
+		}
+		if(emplaced)
+		{
+			things.enqueue(thing);
+		}
+	}
+
+	void dequeue(const T& thing)
+	{
+		std::lock_guard<std::mutex> g(queued_mutex);
+		queued.erase(thing);
+	}
+
+private:
+	moodycamel::ConcurrentQueue<T> things;
+	std::unordered_set<T> queued;
+	std::mutex queued_mutex;
+	std::atomic<bool> running;
+	std::vector<std::thread> threads;
+};
+
+}
+
+// roughly the cost of a small job, without depending on the scheduler
+static void spin_for(const std::chrono::microseconds duration)
+{
+	const auto end = std::chrono::steady_clock::now() + duration;
+	while(std::chrono::steady_clock::now() < end)
+	{
+	}
+}
+
+template<typename Thingy, typename... Args>
+static double run(const uint64_t job_count, const std::chrono::microseconds job_duration, Args&&... args)
+{
+	std::atomic<uint64_t> done(0);
+	Thingy* thingy_ptr = nullptr;
+	Thingy thingy([&done, &thingy_ptr, job_duration](uint64_t& i)
+	{
+		spin_for(job_duration);
+		thingy_ptr->dequeue(i);
+		++done;
+	}, std::forward<Args>(args)...);
+	thingy_ptr = &thingy;
+
+	const auto start = std::chrono::steady_clock::now();
+	for(uint64_t i = 0; i < job_count; ++i)
+	{
+		thingy.enqueue(i);
+	}
+	while(done < job_count)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return job_count / seconds;
+}
+
+int thread_pool_bench(const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+
+	util::thread_pool pool;
+	std::cout << "thread pool size: " << pool.thread_count() << '\n';
+	std::cout << std::left << std::setw(34) << "implementation"
+			  << std::setw(10) << "job"
+			  << std::right << std::setw(14) << "jobs/s"
+			  << '\n';
+
+	struct job_type
+	{
+		const char* name;
+		std::chrono::microseconds duration;
+		// the old implementation manages about 100 jobs/s per thread, so it gets fewer jobs
+		uint64_t sleep_loop_count;
+		uint64_t pool_count;
+	};
+	const job_type job_types[]
+	{
+		{"empty", std::chrono::microseconds(0), 400, 200000},
+		{"200 us", std::chrono::microseconds(200), 400, 20000},
+	};
+	for(const job_type& job : job_types)
+	{
+		// the world used 2 threads for each of its ThreadThingys
+		const double old_rate = run<sleep_loop_thread_thingy<uint64_t>>(job.sleep_loop_count, job.duration, 2);
+		const double new_rate = run<util::ThreadThingy<uint64_t>>(job.pool_count, job.duration, pool);
+		std::cout << std::fixed << std::setprecision(1)
+				  << std::left << std::setw(34) << "sleep loop (2 threads)"
+				  << std::setw(10) << job.name
+				  << std::right << std::setw(14) << old_rate << '\n'
+				  << std::left << std::setw(34) << "thread_pool (shared)"
+				  << std::setw(10) << job.name
+				  << std::right << std::setw(14) << new_rate << '\n';
+	}
+
+	return EXIT_SUCCESS;
+}
+
+}
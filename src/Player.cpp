@@ -394,6 +394,30 @@ void Player::open_gui(unique_ptr<graphics::gui::Base> gui)
 	g.open_gui(std::move(gui));
 }
 
+glm::dvec3 Player::world_velocity() const
+{
+	// the same as the movement in move
+	const double sinY = std::sin(glm::radians(rotation().y));
+	const double cosY = std::cos(glm::radians(rotation().y));
+	const glm::dvec3 velocity = this->velocity();
+	return
+	{
+		velocity.x * cosY - velocity.z * sinY,
+		velocity.y,
+		velocity.z * cosY + velocity.x * sinY,
+	};
+}
+
+glm::dvec3 Player::look_direction() const
+{
+	// the view matrix is Gfx::make_rotation_matrix(rotation), and the camera looks along -z
+	const double sinX = std::sin(glm::radians(rotation().x));
+	const double cosX = std::cos(glm::radians(rotation().x));
+	const double sinY = std::sin(glm::radians(rotation().y));
+	const double cosY = std::cos(glm::radians(rotation().y));
+	return {cosX * sinY, -sinX, -cosX * cosY};
+}
+
 position::chunk_in_world Player::position_chunk() const
 {
 	return position::chunk_in_world(position::block_in_world(position()));
@@ -62,6 +62,14 @@ public:
 	util::property<glm::dvec3> position;
 	util::property<glm::dvec3> rotation;
 	util::property<glm::dvec3> velocity;
+	/*
+	 * velocity is relative to the direction the player faces; this is it in the world, in blocks per tick
+	 */
+	glm::dvec3 world_velocity() const;
+	/*
+	 * The unit vector the camera looks along
+	 */
+	glm::dvec3 look_direction() const;
 	position::chunk_in_world position_chunk() const;
 	glm::dvec3 view_position() const;
 	position::chunk_in_world view_position_chunk() const;
@@ -259,6 +259,49 @@ void info::visibility_type(const block_t block, const enums::visibility_type val
 	set_value(visibility_type_, block, value, enums::visibility_type::opaque);
 }
 
+uint64_t info::light_hash() const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037u;
+	auto add = [&hash](const uint64_t v)
+	{
+		for(unsigned i = 0; i < 64; i += 8)
+		{
+			hash ^= (v >> i) & 0xFF;
+			hash *= 1099511628211u;
+		}
+	};
+	auto add_block = [&add](const block_t block)
+	{
+		add((static_cast<uint64_t>(block.index) << 8) | block.generation);
+	};
+	auto add_color = [&add](const graphics::color& c)
+	{
+		add(static_cast<uint64_t>(c.r) | (static_cast<uint64_t>(c.g) << 8) | (static_cast<uint64_t>(c.b) << 16));
+	};
+
+	// the maps are sorted, so the order does not depend on how they were filled
+	add(light_.size());
+	for(const auto& [block, color] : light_)
+	{
+		add_block(block);
+		add_color(color);
+	}
+	add(light_filter_.size());
+	for(const auto& [block, color] : light_filter_)
+	{
+		add_block(block);
+		add_color(color);
+	}
+	add(visibility_type_.size());
+	for(const auto& [block, type] : visibility_type_)
+	{
+		add_block(block);
+		add(static_cast<uint64_t>(type));
+	}
+	return hash;
+}
+
 static std::size_t get_face_i
 (
 	const enums::Face face,
@@ -84,6 +84,12 @@ public:
 		return visibility_type(block) == enums::visibility_type::invisible;
 	}
 
+	/*
+	 * A hash of everything that light spreading reads (light, light_filter, and visibility_type of every block)
+	 * Saved light is only valid while this is the same
+	 */
+	uint64_t light_hash() const;
+
 	fs::path shader_path(block_t, enums::Face) const;
 	void shader_path(block_t, enums::Face, const fs::path&);
 
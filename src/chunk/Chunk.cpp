@@ -1,8 +1,13 @@
 #include "Chunk.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <cstddef>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
 #include <stdint.h>
 #include <utility>
@@ -13,7 +18,10 @@
 
 #include "game.hpp"
 #include "settings.hpp"
+#include "block/component/info.hpp"
+#include "chunk/face_connectivity.hpp"
 #include "chunk/Mesher/base.hpp"
+#include "chunk/Mesher/LOD.hpp"
 #include "event/EventManager.hpp"
 #include "event/EventType.hpp"
 #include "event/type/Event_change_setting.hpp"
@@ -25,6 +33,7 @@
 #include "position/block_in_chunk.hpp"
 #include "position/block_in_world.hpp"
 #include "position/chunk_in_world.hpp"
+#include "storage/chunk_image.hpp"
 #include "util/logger.hpp"
 #include "world/world.hpp"
 
@@ -49,11 +58,15 @@ struct Chunk::impl
 	:
 		owner(owner),
 		position(position),
-		light_changed(false),
-		changed(false)
+		light_changed(false)
 	{
 		light_tex_buf.fill(0);
 
+		// there is no game when meshing headless (see benchmark/)
+		if(game::instance == nullptr)
+		{
+			return;
+		}
 		light_smoothing_eid = game::instance->event_manager.add_handler(EventType::change_setting, [this](const Event& event)
 		{
 			const auto& e = static_cast<const Event_change_setting&>(event);
@@ -74,6 +87,10 @@ struct Chunk::impl
 
 	~impl()
 	{
+		if(game::instance == nullptr)
+		{
+			return;
+		}
 		try
 		{
 			game::instance->event_manager.unadd_handler(light_smoothing_eid);
@@ -116,13 +133,39 @@ struct Chunk::impl
 	bool light_changed;
 	event_handler_id_t light_smoothing_eid;
 
-	bool changed;
-	mesher::meshmap_t meshes;
-	std::vector<graphics::opengl::vertex_array> mesh_vaos;
-	std::vector<graphics::opengl::vertex_buffer> mesh_vbos;
+	// see get_light_stamp, is_light_costly, and is_pristine
+	uint32_t light_stamp = 0;
+	bool light_costly = false;
+	bool pristine = false;
+
+	struct mesh_level
+	{
+		bool changed = false;
+		// false until meshed, and again when the blocks change (LOD levels are rebuilt on request)
+		bool valid = false;
+		mesher::meshmap_t meshes;
+		std::vector<graphics::opengl::vertex_array> vaos;
+		std::vector<graphics::opengl::vertex_buffer> vbos;
+
+		void update_vaos();
+	};
+	std::array<mesh_level, mesher::LOD_LEVEL_COUNT> mesh_levels;
+	// incremented by every full update; LOD meshes made from older blocks are not marked valid
+	uint64_t mesh_generation = 0;
+	// of the blocks meshed last
+	face_connectivity connectivity;
 	mutable std::mutex mesh_mutex;
 
-	void update_vaos();
+	// after a partial update, level 0 is these joined together
+	std::array<mesher::meshmap_t, mesher::SECTION_COUNT> section_meshes;
+	// false after a full update, which meshes the chunk whole instead of by section
+	bool sections_meshed = false;
+	bool meshed = false;
+	std::atomic<mesher::section_mask_t> dirty_sections{0};
+	// set by a block edit that changed opacity; a full update always finds the connectivity again
+	std::atomic<bool> connectivity_dirty{false};
+	// held for all of update_sections, so that two updates do not mix their sections
+	std::mutex section_mutex;
 
 private:
 	std::array<uint8_t, CHUNK_SIZE_2 * CHUNK_SIZE_2 * CHUNK_SIZE_2 * 3> light_tex_buf;
@@ -165,6 +208,55 @@ block_t Chunk::get_block(const block_in_chunk& pos) const
 void Chunk::set_block(const block_in_chunk& pos, block_t block)
 {
 	blocks.set(pos, block);
+	pImpl->pristine = false;
+}
+
+void Chunk::set_blocks(std::shared_ptr<chunk_blocks_t::array_t> blocks)
+{
+	this->blocks.replace(std::move(blocks));
+}
+
+storage::chunk_image Chunk::snapshot() const
+{
+	return
+	{
+		pImpl->position,
+		blocks.snapshot(),
+		blocklight.snapshot(),
+		skylight.snapshot(),
+		pImpl->light_stamp,
+		pImpl->light_costly,
+	};
+}
+
+uint32_t Chunk::get_light_stamp() const
+{
+	return pImpl->light_stamp;
+}
+
+void Chunk::set_light_stamp(const uint32_t stamp)
+{
+	pImpl->light_stamp = stamp;
+}
+
+bool Chunk::is_light_costly() const
+{
+	return pImpl->light_costly;
+}
+
+void Chunk::set_light_costly(const bool costly)
+{
+	pImpl->light_costly = costly;
+}
+
+bool Chunk::is_pristine() const
+{
+	return pImpl->pristine;
+}
+
+void Chunk::set_pristine(const bool pristine)
+{
+	pImpl->pristine = pristine;
 }
 
 graphics::color Chunk::get_light(const block_in_chunk& pos) const
@@ -228,32 +320,199 @@ void Chunk::impl::set_texbuflight(const glm::ivec3& pos, const graphics::color&
 
 void Chunk::update()
 {
-	mesher::meshmap_t meshes = pImpl->owner.mesher->make_mesh(*this);
+	update_sections(mesher::ALL_SECTIONS);
+}
+
+void Chunk::update_sections(uint64_t sections)
+{
+	std::lock_guard<std::mutex> sg(pImpl->section_mutex);
+
+	sections |= pImpl->dirty_sections.exchange(0);
+	mesher::base& mesher = *pImpl->owner.mesher;
+	sections &= mesher::ALL_SECTIONS;
+	if(!pImpl->meshed || !mesher.has_sections())
+	{
+		sections = mesher::ALL_SECTIONS;
+	}
+	if(sections == 0)
+	{
+		return;
+	}
+
+	mesher::meshmap_t meshes;
+	const bool full = sections == mesher::ALL_SECTIONS;
+	if(full)
+	{
+		// the greedy mesher's rectangles can not cross from one section to the next, so a mesh joined from sections has
+		// more faces than a whole one
+		meshes = mesher.make_mesh(*this);
+		if(pImpl->sections_meshed)
+		{
+			for(mesher::meshmap_t& section_mesh : pImpl->section_meshes)
+			{
+				section_mesh.clear();
+			}
+			pImpl->sections_meshed = false;
+		}
+	}
+	else
+	{
+		// the first partial update after a full one has no sections to keep
+		if(!pImpl->sections_meshed)
+		{
+			sections = mesher::ALL_SECTIONS;
+		}
+		for(uint8_t section = 0; section < mesher::SECTION_COUNT; ++section)
+		{
+			if((sections & (mesher::section_mask_t(1) << section)) != 0)
+			{
+				pImpl->section_meshes[section] = mesher.make_section_mesh(*this, section);
+			}
+		}
+		pImpl->sections_meshed = true;
+
+		for(const mesher::meshmap_t& section_mesh : pImpl->section_meshes)
+		{
+			for(const auto& p : section_mesh)
+			{
+				mesher::mesh_t& mesh = meshes[p.first];
+				mesh.insert(mesh.end(), p.second.cbegin(), p.second.cend());
+			}
+		}
+	}
+	pImpl->meshed = true;
+
+	// the flood fill costs more than remeshing a few sections, so a block edit redoes it only if it changed opacity
+	std::optional<face_connectivity> connectivity;
+	if(full || pImpl->connectivity_dirty.exchange(false))
+	{
+		// a chunk that is all one block is usually all air or all stone, so the flood fill is skipped for it
+		const auto blocks = this->blocks.snapshot();
+		const block::component::info& info = pImpl->owner.block_manager.info;
+		face_connectivity::opaque_t opaque;
+		block_t last_block = (*blocks)[0];
+		bool last_opaque = info.is_opaque(last_block);
+		bool uniform = true;
+		for(std::size_t i = 0; i < blocks->size(); ++i)
+		{
+			const block_t block = (*blocks)[i];
+			if(block != last_block)
+			{
+				last_block = block;
+				last_opaque = info.is_opaque(block);
+				uniform = false;
+			}
+			opaque[i] = last_opaque;
+		}
+		connectivity.emplace();
+		if(!uniform || last_opaque)
+		{
+			connectivity = face_connectivity(opaque);
+		}
+	}
+
+	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
+	if(connectivity != std::nullopt)
+	{
+		pImpl->connectivity = *connectivity;
+	}
+	impl::mesh_level& level0 = pImpl->mesh_levels[0];
+	level0.meshes = std::move(meshes);
+	level0.changed = true;
+	level0.valid = true;
+	++pImpl->mesh_generation;
+	for(std::size_t level = 1; level < pImpl->mesh_levels.size(); ++level)
+	{
+		pImpl->mesh_levels[level].valid = false;
+	}
+}
+
+void Chunk::mark_sections_dirty(const uint64_t sections)
+{
+	pImpl->dirty_sections |= sections;
+}
+
+void Chunk::mark_connectivity_dirty()
+{
+	pImpl->connectivity_dirty = true;
+}
+
+bool Chunk::has_dirty_sections() const
+{
+	return pImpl->dirty_sections != 0;
+}
+
+void Chunk::update_lod(const uint8_t level)
+{
+	assert(level > 0 && level < mesher::LOD_LEVEL_COUNT);
+	uint64_t generation;
+	{
+		std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
+		generation = pImpl->mesh_generation;
+	}
+	mesher::meshmap_t meshes = mesher::lod(level).make_mesh(*this);
+
+	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
+	impl::mesh_level& mesh_level = pImpl->mesh_levels[level];
+	mesh_level.meshes = std::move(meshes);
+	mesh_level.changed = true;
+	mesh_level.valid = (generation == pImpl->mesh_generation);
+}
+
+bool Chunk::has_lod(const uint8_t level) const
+{
+	assert(level < mesher::LOD_LEVEL_COUNT);
+	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
+	return pImpl->mesh_levels[level].valid;
+}
+
+bool Chunk::is_upload_pending() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
+	const impl::mesh_level& level0 = pImpl->mesh_levels[0];
+	// render does nothing for an empty mesh
+	return level0.changed && !level0.meshes.empty();
+}
+
+bool Chunk::has_mesh() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
+	return !pImpl->mesh_levels[0].meshes.empty();
+}
 
+face_connectivity Chunk::get_face_connectivity() const
+{
 	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
-	pImpl->meshes = std::move(meshes);
-	pImpl->changed = true;
+	return pImpl->connectivity;
 }
 
-void Chunk::render(const bool translucent_pass)
+void Chunk::render(const bool translucent_pass, uint8_t level)
 {
 	std::lock_guard<std::mutex> g(pImpl->mesh_mutex);
 
-	if(pImpl->meshes.empty())
+	assert(level < mesher::LOD_LEVEL_COUNT);
+	// until the requested level is meshed, use the full mesh
+	if(!pImpl->mesh_levels[level].valid && pImpl->mesh_levels[level].meshes.empty())
+	{
+		level = 0;
+	}
+	impl::mesh_level& mesh_level = pImpl->mesh_levels[level];
+
+	if(mesh_level.meshes.empty())
 	{
 		return;
 	}
 
-	if(pImpl->changed)
+	if(mesh_level.changed)
 	{
 		if(pImpl->light_tex == nullptr)
 		{
 			pImpl->init_light_tex();
 		}
 
-		pImpl->update_vaos();
+		mesh_level.update_vaos();
 
-		pImpl->changed = false;
+		mesh_level.changed = false;
 	}
 
 	if(pImpl->light_changed && pImpl->light_tex != nullptr)
@@ -268,7 +527,7 @@ void Chunk::render(const bool translucent_pass)
 	// TODO?: use double when available
 	const glm::vec3 position_offset(static_cast<block_in_world::vec_type>(block_in_world(render_position, {0, 0, 0})));
 	std::size_t i = 0;
-	for(const auto& p : pImpl->meshes)
+	for(const auto& p : mesh_level.meshes)
 	{
 		if(p.first.is_translucent != translucent_pass)
 		{
@@ -281,7 +540,7 @@ void Chunk::render(const bool translucent_pass)
 		shader->uniform("tex", p.first.tex_unit);
 
 		shader->use();
-		pImpl->mesh_vaos[i].draw(GL_TRIANGLES, 0, p.second.size() * 3);
+		mesh_level.vaos[i].draw(GL_TRIANGLES, 0, p.second.size() * 3);
 
 		++i;
 	}
@@ -289,20 +548,52 @@ void Chunk::render(const bool translucent_pass)
 
 void Chunk::regenerate_texbuflight()
 {
-	block_in_chunk pos;
+	// read from snapshots, so the arrays are locked once instead of twice per block
+	const auto blocklight = this->blocklight.snapshot();
+	const auto skylight = this->skylight.snapshot();
+	std::size_t i = 0;
+	glm::ivec3 pos;
 	for(pos.x = 0; pos.x < CHUNK_SIZE; ++pos.x)
 	for(pos.y = 0; pos.y < CHUNK_SIZE; ++pos.y)
 	for(pos.z = 0; pos.z < CHUNK_SIZE; ++pos.z)
 	{
-		set_texbuflight({pos.x, pos.y, pos.z}, get_light(pos));
+		const graphics::color& light1 = (*blocklight)[i];
+		const graphics::color& light2 = (*skylight)[i];
+		pImpl->set_texbuflight(pos, graphics::color
+		{
+			std::max(light1.r, light2.r),
+			std::max(light1.g, light2.g),
+			std::max(light1.b, light2.b),
+		});
+		++i;
 	}
 }
 
-void Chunk::impl::update_vaos()
+void Chunk::clear_light()
+{
+	blocklight.fill({0, 0, 0});
+	skylight.fill({0, 0, 0});
+	regenerate_texbuflight();
+}
+
+void Chunk::set_data
+(
+	std::shared_ptr<chunk_blocks_t::array_t> blocks,
+	std::shared_ptr<chunk_data<graphics::color>::array_t> blocklight,
+	std::shared_ptr<chunk_data<graphics::color>::array_t> skylight
+)
+{
+	this->blocks.replace(std::move(blocks));
+	this->blocklight.replace(std::move(blocklight));
+	this->skylight.replace(std::move(skylight));
+	regenerate_texbuflight();
+}
+
+void Chunk::impl::mesh_level::update_vaos()
 {
-	if(mesh_vaos.size() < meshes.size())
+	if(vaos.size() < meshes.size())
 	{
-		const std::size_t to_add = meshes.size() - mesh_vaos.size();
+		const std::size_t to_add = meshes.size() - vaos.size();
 		for(std::size_t i = 0; i < to_add; ++i)
 		{
 			graphics::opengl::vertex_buffer vbo
@@ -313,8 +604,8 @@ void Chunk::impl::update_vaos()
 			});
 			graphics::opengl::vertex_array vao(vbo);
 
-			mesh_vbos.emplace_back(std::move(vbo));
-			mesh_vaos.emplace_back(std::move(vao));
+			vbos.emplace_back(std::move(vbo));
+			vaos.emplace_back(std::move(vao));
 		}
 	}
 	// TODO: delete unused
@@ -324,7 +615,7 @@ void Chunk::impl::update_vaos()
 	{
 		const auto usage_hint = graphics::opengl::vertex_buffer::usage_hint::dynamic_draw;
 		const mesher::mesh_t& mesh = p.second;
-		mesh_vbos[i].data(mesh.size() * sizeof(mesher::mesh_t::value_type), mesh.data(), usage_hint);
+		vbos[i].data(mesh.size() * sizeof(mesher::mesh_t::value_type), mesh.data(), usage_hint);
 		++i;
 	}
 }
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <stdint.h>
 
 #include "block/block.hpp"
 #include "chunk/ChunkData.hpp"
 #include "graphics/color.hpp"
+#include "fwd/chunk/face_connectivity.hpp"
 #include "fwd/position/block_in_chunk.hpp"
 #include "fwd/position/chunk_in_world.hpp"
 #include "shim/propagate_const.hpp"
+#include "fwd/storage/chunk_image.hpp"
 #include "fwd/world/world.hpp"
 
 namespace block_thingy {
@@ -30,6 +34,10 @@ public:
 
 	block_t get_block(const position::block_in_chunk&) const;
 	void set_block(const position::block_in_chunk&, block_t);
+	/*
+	 * For generators; takes the array without copying it (the light is left as it is)
+	 */
+	void set_blocks(std::shared_ptr<chunk_blocks_t::array_t>);
 
 	graphics::color get_light(const position::block_in_chunk&) const;
 
@@ -42,11 +50,82 @@ public:
 	void set_texbuflight(const glm::ivec3& pos, const graphics::color&);
 
 	void update();
-	void render(bool transluscent_pass);
+	/*
+	 * Remesh the given sections (see mesher::section_mask_t) and the sections marked dirty
+	 * The first update, and any update of every section, meshes the chunk whole; the others keep the other sections' faces
+	 */
+	void update_sections(uint64_t sections);
+	void mark_sections_dirty(uint64_t sections);
+	/*
+	 * The next update finds the face connectivity again even if it is partial (for a block edit that changed opacity)
+	 */
+	void mark_connectivity_dirty();
+	bool has_dirty_sections() const;
+	void render(bool transluscent_pass, uint8_t lod_level = 0);
+
+	/*
+	 * LOD meshes are cached until the next call to update()
+	 */
+	void update_lod(uint8_t lod_level);
+	bool has_lod(uint8_t lod_level) const;
+
+	/*
+	 * @return true if the full mesh changed and has not been drawn since
+	 */
+	bool is_upload_pending() const;
+
+	/*
+	 * @return false if the full mesh is empty (there is nothing to draw)
+	 */
+	bool has_mesh() const;
+
+	/*
+	 * Which faces can be seen from which others thru the blocks meshed last (all of them before the first update)
+	 */
+	face_connectivity get_face_connectivity() const;
 
 	// for loading
 	void regenerate_texbuflight();
 
+	/*
+	 * Set all of the blocklight and skylight to 0, to light the chunk again from its blocks
+	 */
+	void clear_light();
+
+	/*
+	 * For loading; takes the arrays without copying them and regenerates the light texture
+	 */
+	void set_data
+	(
+		std::shared_ptr<chunk_blocks_t::array_t> blocks,
+		std::shared_ptr<chunk_data<graphics::color>::array_t> blocklight,
+		std::shared_ptr<chunk_data<graphics::color>::array_t> skylight
+	);
+
+	/*
+	 * Copy the saved data, for saving on another thread
+	 */
+	storage::chunk_image snapshot() const;
+
+	/*
+	 * The world::light_stamp the light was made with (0 if it is not known, like for chunks saved before stamps)
+	 */
+	uint32_t get_light_stamp() const;
+	void set_light_stamp(uint32_t);
+
+	/*
+	 * true if lighting the chunk took too long to do on every load, so its light is saved even when the world omits light
+	 */
+	bool is_light_costly() const;
+	void set_light_costly(bool);
+
+	/*
+	 * true if the blocks are what the world's generator made, so the chunk can be generated again instead of saved
+	 * set_block makes it false
+	 */
+	bool is_pristine() const;
+	void set_pristine(bool);
+
 	// for msgpack
 	template<typename T> void save(T&) const;
 	template<typename T> void load(const T&);
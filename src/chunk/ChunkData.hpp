@@ -12,15 +12,25 @@
 
 namespace block_thingy {
 
+/*
+ * The blocks are copied on write, so a snapshot can be read by another thread (for saving)
+ * while the chunk keeps changing
+ */
 template<typename T>
 class chunk_data
 {
 public:
+	using array_t = std::array<T, CHUNK_BLOCK_COUNT>;
+
 	chunk_data()
+	:
+		blocks(std::make_shared<array_t>())
 	{
 	}
 
 	chunk_data(T block)
+	:
+		blocks(std::make_shared<array_t>())
 	{
 		fill(std::move(block));
 	}
@@ -40,42 +50,67 @@ public:
 	chunk_data(const chunk_data&) = delete;
 	chunk_data& operator=(const chunk_data&) = delete;
 
-	const T& get(const position::block_in_chunk& pos) const
-	{
-		std::lock_guard<std::mutex> g(blocks_mutex);
-		return blocks[block_array_index(pos.x, pos.y, pos.z)];
-	}
-
-	T& get(const position::block_in_chunk& pos)
+	// by value, since a write after a snapshot replaces the array
+	T get(const position::block_in_chunk& pos) const
 	{
 		std::lock_guard<std::mutex> g(blocks_mutex);
-		return blocks[block_array_index(pos.x, pos.y, pos.z)];
+		return (*blocks)[block_array_index(pos.x, pos.y, pos.z)];
 	}
 
 	void set(const position::block_in_chunk& pos, T block)
 	{
 		const std::size_t i = block_array_index(pos.x, pos.y, pos.z);
 		std::lock_guard<std::mutex> g(blocks_mutex);
-		blocks[i] = std::move(block);
+		detach();
+		(*blocks)[i] = std::move(block);
 	}
 
 	void fill(T block)
 	{
 		std::lock_guard<std::mutex> g(blocks_mutex);
-		std::generate(blocks.begin(), blocks.end(), [&block]()
+		detach();
+		std::generate(blocks->begin(), blocks->end(), [&block]()
 		{
 			return block;
 		});
 	}
 
+	/*
+	 * Cheap; the copy is made by the next write, and only if the snapshot is still alive
+	 */
+	std::shared_ptr<const array_t> snapshot() const
+	{
+		std::lock_guard<std::mutex> g(blocks_mutex);
+		return blocks;
+	}
+
+	/*
+	 * For loading; the array is used as it is instead of being copied
+	 */
+	void replace(std::shared_ptr<array_t> array)
+	{
+		std::lock_guard<std::mutex> g(blocks_mutex);
+		blocks = std::move(array);
+	}
+
 	// for msgpack
 	template<typename O> void save(O&) const;
 	template<typename O> void load(const O&);
 
 private:
-	std::array<T, CHUNK_BLOCK_COUNT> blocks;
+	std::shared_ptr<array_t> blocks;
 	mutable std::mutex blocks_mutex;
 
+	// call with blocks_mutex locked
+	void detach()
+	{
+		// new references are made only by snapshot, which locks blocks_mutex, so this can not go from 1 to 2 here
+		if(blocks.use_count() > 1)
+		{
+			blocks = std::make_shared<array_t>(*blocks);
+		}
+	}
+
 	static std::size_t block_array_index
 	(
 		const position::block_in_chunk::value_type x,
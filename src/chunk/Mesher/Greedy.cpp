@@ -1,5 +1,6 @@
 #include "Greedy.hpp"
 
+#include <algorithm>
 #include <array>
 #include <stdint.h>
 #include <tuple>
@@ -24,21 +25,50 @@ struct Rectangle
 	uint8_t rotation;
 };
 
-static void add_surface(const Chunk&, meshmap_t&, surface_t&, Face);
+/*
+ * Only blocks with x in [x_min, x_end) are meshed
+ * Rectangles never cross x_min or x_end, so the sections of a chunk meshed separately cover the same faces as the whole
+ * chunk, but with more rectangles (the top, bottom, front, and back ones are cut at each section's edge)
+ */
+struct slice_range
+{
+	uint8_t x_min;
+	uint8_t x_end;
+};
+
+static meshmap_t make_slices_mesh(const Chunk&, slice_range);
+static void add_surface(const Chunk&, meshmap_t&, surface_t&, Face, slice_range);
 static Rectangle yield_rectangle(surface_t&);
-static void generate_surface(const Chunk&, surface_t&, u8vec3&, const u8vec3&, Face);
+static void generate_surface(const Chunk&, surface_t&, u8vec3&, const u8vec3&, Face, slice_range);
 
 meshmap_t greedy::make_mesh(const Chunk& chunk)
+{
+	return make_slices_mesh(chunk, {0, CHUNK_SIZE});
+}
+
+meshmap_t greedy::make_section_mesh(const Chunk& chunk, const uint8_t section)
+{
+	const auto x_min = static_cast<uint8_t>(section * SECTION_SIZE);
+	const auto x_end = static_cast<uint8_t>(std::min((section + 1) * SECTION_SIZE, CHUNK_SIZE));
+	return make_slices_mesh(chunk, {x_min, x_end});
+}
+
+bool greedy::has_sections() const
+{
+	return true;
+}
+
+meshmap_t make_slices_mesh(const Chunk& chunk, const slice_range range)
 {
 	meshmap_t meshes;
 
 	surface_t surface;
-	add_surface(chunk, meshes, surface, Face::right );
-	add_surface(chunk, meshes, surface, Face::left  );
-	add_surface(chunk, meshes, surface, Face::top   );
-	add_surface(chunk, meshes, surface, Face::bottom);
-	add_surface(chunk, meshes, surface, Face::front );
-	add_surface(chunk, meshes, surface, Face::back  );
+	add_surface(chunk, meshes, surface, Face::right , range);
+	add_surface(chunk, meshes, surface, Face::left  , range);
+	add_surface(chunk, meshes, surface, Face::top   , range);
+	add_surface(chunk, meshes, surface, Face::bottom, range);
+	add_surface(chunk, meshes, surface, Face::front , range);
+	add_surface(chunk, meshes, surface, Face::back  , range);
 
 	return meshes;
 }
@@ -48,15 +78,20 @@ void add_surface
 	const Chunk& chunk,
 	meshmap_t& meshes,
 	surface_t& surface,
-	const Face face
+	const Face face,
+	const slice_range range
 )
 {
 	const u8vec3 i = base::get_i(face);
 
+	// when the surface is perpendicular to x, skip the slices outside of the range
+	const uint8_t y_min = (i.y == 0) ? range.x_min : 0;
+	const uint8_t y_end = (i.y == 0) ? range.x_end : static_cast<uint8_t>(CHUNK_SIZE);
+
 	u8vec3 pos;
-	for(pos[1] = 0; pos[1] < CHUNK_SIZE; ++pos[1])
+	for(pos[1] = y_min; pos[1] < y_end; ++pos[1])
 	{
-		generate_surface(chunk, surface, pos, i, face);
+		generate_surface(chunk, surface, pos, i, face, range);
 
 		while(true)
 		{
@@ -82,7 +117,8 @@ void generate_surface
 	surface_t& surface,
 	u8vec3& pos,
 	const u8vec3& i,
-	const Face face
+	const Face face,
+	const slice_range range
 )
 {
 	const auto& info = chunk.get_owner().block_manager.info;
@@ -99,7 +135,8 @@ void generate_surface
 			o[i.y] = offset;
 
 			const block_t block = base::block_at(chunk, x, y, z);
-			if(base::block_visible_from(info, chunk, block, x + o[0], y + o[1], z + o[2]))
+			if(x >= range.x_min && x < range.x_end
+			&& base::block_visible_from(info, chunk, block, x + o[0], y + o[1], z + o[2]))
 			{
 				const auto tex = info.texture_info(block, face);
 				surface[pos[2]][pos[0]] =
@@ -179,7 +216,7 @@ Rectangle yield_rectangle(surface_t& surface)
 				}
 				for(block_in_chunk::value_type i = start_x; i < start_x + w2; ++i)
 				{
-					std::get<0>(row2[start_x]).shader_path.clear();
+					std::get<0>(row2[i]).shader_path.clear();
 				}
 
 				++z;
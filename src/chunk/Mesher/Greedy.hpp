@@ -7,6 +7,8 @@ class greedy : public base
 {
 public:
 	meshmap_t make_mesh(const Chunk&) override;
+	meshmap_t make_section_mesh(const Chunk&, uint8_t section) override;
+	bool has_sections() const override;
 };
 
 }
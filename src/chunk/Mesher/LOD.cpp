@@ -0,0 +1,192 @@
+#include "LOD.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "block/enums/Face.hpp"
+#include "chunk/Chunk.hpp"
+#include "position/block_in_chunk.hpp"
+
+namespace block_thingy::mesher {
+
+using block::enums::Face;
+using position::block_in_chunk;
+
+lod::lod(const uint8_t level)
+:
+	level(level)
+{
+	assert(level > 0 && level < LOD_LEVEL_COUNT);
+}
+
+uint8_t lod::level_for_distance(const uint64_t distance, const uint64_t lod_distance)
+{
+	if(lod_distance == 0)
+	{
+		return 0;
+	}
+	uint8_t level = 0;
+	for(uint64_t threshold = lod_distance; distance > threshold && level + 1 < LOD_LEVEL_COUNT; threshold *= 2)
+	{
+		++level;
+	}
+	return level;
+}
+
+meshmap_t lod::make_mesh(const Chunk& chunk)
+{
+	const auto& info = chunk.get_owner().block_manager.info;
+
+	const int_fast32_t scale = int_fast32_t(1) << level;
+	const int_fast32_t cells = (CHUNK_SIZE + scale - 1) / scale;
+	auto cell_extent = [scale](const int_fast32_t cell) -> int_fast32_t
+	{
+		return std::min(scale, CHUNK_SIZE - cell * scale);
+	};
+
+	/*
+	 * Interior cells are filled when most of their blocks are visible (majority rule).
+	 * Cells on the chunk border are filled when any of their blocks are visible (dominant surface).
+	 * Border cells then never cover less than the blocks beside the border do, at any level. A face on the border is
+	 * hidden only where the neighboring chunk's blocks are (like the full-resolution meshers), so whatever level the
+	 * neighbor is drawn at fills the space behind a hidden face, and no skirts are needed to close cracks between levels.
+	 */
+	std::vector<block_t> cell_blocks(static_cast<std::size_t>(cells * cells * cells));
+	auto cell_index = [cells](const int_fast32_t x, const int_fast32_t y, const int_fast32_t z) -> std::size_t
+	{
+		return static_cast<std::size_t>(cells * cells * x + cells * y + z);
+	};
+
+	std::map<block_t, int_fast32_t> counts;
+	for(int_fast32_t cx = 0; cx < cells; ++cx)
+	for(int_fast32_t cy = 0; cy < cells; ++cy)
+	for(int_fast32_t cz = 0; cz < cells; ++cz)
+	{
+		counts.clear();
+		int_fast32_t visible = 0;
+		const int_fast32_t ex = cell_extent(cx);
+		const int_fast32_t ey = cell_extent(cy);
+		const int_fast32_t ez = cell_extent(cz);
+		for(int_fast32_t x = cx * scale; x < cx * scale + ex; ++x)
+		for(int_fast32_t y = cy * scale; y < cy * scale + ey; ++y)
+		for(int_fast32_t z = cz * scale; z < cz * scale + ez; ++z)
+		{
+			#define s(a) static_cast<block_in_chunk::value_type>(a)
+			const block_t block = chunk.get_block({s(x), s(y), s(z)});
+			#undef s
+			if(info.is_invisible(block))
+			{
+				continue;
+			}
+			++visible;
+			++counts[block];
+		}
+		if(visible == 0)
+		{
+			continue;
+		}
+
+		const bool is_border =
+			   cx == 0 || cx == cells - 1
+			|| cy == 0 || cy == cells - 1
+			|| cz == 0 || cz == cells - 1;
+		if(!is_border && visible * 2 < ex * ey * ez)
+		{
+			continue;
+		}
+
+		// std::map is ordered, so ties are broken the same way every time
+		const auto dominant = std::max_element(counts.cbegin(), counts.cend(), [](const auto& a, const auto& b)
+		{
+			return a.second < b.second;
+		});
+		cell_blocks[cell_index(cx, cy, cz)] = dominant->first;
+	}
+
+	meshmap_t meshes;
+	for(int_fast32_t cx = 0; cx < cells; ++cx)
+	for(int_fast32_t cy = 0; cy < cells; ++cy)
+	for(int_fast32_t cz = 0; cz < cells; ++cz)
+	{
+		const block_t block = cell_blocks[cell_index(cx, cy, cz)];
+		if(block == block_t())
+		{
+			continue;
+		}
+
+		const glm::tvec3<int_fast32_t> extent(cell_extent(cx), cell_extent(cy), cell_extent(cz));
+		for(uint8_t face_i = 0; face_i < 6; ++face_i)
+		{
+			const Face face = static_cast<Face>(face_i);
+			const Side side = to_side(face);
+			const auto i = get_i(face);
+			glm::tvec3<int_fast32_t> npos(cx, cy, cz);
+			npos[i.y] += static_cast<int8_t>(side);
+
+			bool is_visible = false;
+			if(npos[i.y] < 0 || npos[i.y] >= cells)
+			{
+				// visible if any of the neighboring chunk's blocks that it covers are (none are if it is not loaded)
+				glm::tvec3<int_fast32_t> n;
+				n[i.y] = (side == Side::top) ? CHUNK_SIZE : -1;
+				const int_fast32_t x_min = npos[i.x] * scale;
+				const int_fast32_t z_min = npos[i.z] * scale;
+				for(n[i.x] = x_min; n[i.x] < x_min + extent[i.x] && !is_visible; ++n[i.x])
+				for(n[i.z] = z_min; n[i.z] < z_min + extent[i.z] && !is_visible; ++n[i.z])
+				{
+					#define s(a) static_cast<int_fast16_t>(a)
+					is_visible = block_visible_from(info, chunk, block, s(n.x), s(n.y), s(n.z));
+					#undef s
+				}
+			}
+			else
+			{
+				const block_t sibling = cell_blocks[cell_index(npos.x, npos.y, npos.z)];
+				is_visible =
+					   sibling == block_t()
+					|| (!info.is_opaque(sibling) && block != sibling);
+			}
+			if(!is_visible)
+			{
+				continue;
+			}
+
+			u8vec3 xyz
+			(
+				static_cast<uint8_t>(cx * scale),
+				static_cast<uint8_t>(cy * scale),
+				static_cast<uint8_t>(cz * scale)
+			);
+			if(side == Side::top)
+			{
+				// add_face moves top faces up by 1
+				xyz[i.y] = static_cast<uint8_t>(xyz[i.y] + extent[i.y] - 1);
+			}
+
+			const auto tex = info.texture_info(block, face);
+			const meshmap_key_t key =
+			{
+				info.shader_path(block, face),
+				info.is_translucent(block),
+				tex.unit,
+			};
+			base::add_face
+			(
+				meshes[key],
+				xyz,
+				face,
+				static_cast<uint8_t>(extent[i.x]),
+				static_cast<uint8_t>(extent[i.z]),
+				tex.index,
+				info.rotation(block, face)
+			);
+		}
+	}
+
+	return meshes;
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "base.hpp"
+
+namespace block_thingy::mesher {
+
+/*
+ * level 0 is the full-resolution mesh made by the world's mesher
+ * level n downsamples the chunk by 2^n along each axis
+ */
+constexpr uint8_t LOD_LEVEL_COUNT = 4;
+
+class lod : public base
+{
+public:
+	lod(uint8_t level);
+
+	meshmap_t make_mesh(const Chunk&) override;
+
+	/*
+	 * The LOD level to use for a chunk `distance` chunks away from the camera
+	 * `lod_distance` is the distance at which level 1 starts; each level after that starts at double the distance of the previous level
+	 */
+	static uint8_t level_for_distance(uint64_t distance, uint64_t lod_distance);
+
+private:
+	uint8_t level;
+};
+
+}
@@ -1,5 +1,7 @@
 #include "Simple.hpp"
 
+#include <algorithm>
+
 #include "chunk/Chunk.hpp"
 #include "position/block_in_chunk.hpp"
 
@@ -8,12 +10,36 @@ namespace block_thingy::mesher {
 using block::enums::Face;
 using position::block_in_chunk;
 
+static meshmap_t make_slices_mesh(const Chunk&, block_in_chunk::value_type x_min, block_in_chunk::value_type x_end);
+
 meshmap_t simple::make_mesh(const Chunk& chunk)
+{
+	return make_slices_mesh(chunk, 0, CHUNK_SIZE);
+}
+
+meshmap_t simple::make_section_mesh(const Chunk& chunk, const uint8_t section)
+{
+	const auto x_min = static_cast<block_in_chunk::value_type>(section * SECTION_SIZE);
+	const auto x_end = static_cast<block_in_chunk::value_type>(std::min((section + 1) * SECTION_SIZE, CHUNK_SIZE));
+	return make_slices_mesh(chunk, x_min, x_end);
+}
+
+bool simple::has_sections() const
+{
+	return true;
+}
+
+meshmap_t make_slices_mesh
+(
+	const Chunk& chunk,
+	const block_in_chunk::value_type x_min,
+	const block_in_chunk::value_type x_end
+)
 {
 	const auto& info = chunk.get_owner().block_manager.info;
 	meshmap_t meshes;
 
-	for(block_in_chunk::value_type x = 0; x < CHUNK_SIZE; ++x)
+	for(block_in_chunk::value_type x = x_min; x < x_end; ++x)
 	for(block_in_chunk::value_type y = 0; y < CHUNK_SIZE; ++y)
 	for(block_in_chunk::value_type z = 0; z < CHUNK_SIZE; ++z)
 	{
@@ -26,11 +52,11 @@ meshmap_t simple::make_mesh(const Chunk& chunk)
 		for(uint8_t face_i = 0; face_i < 6; ++face_i)
 		{
 			const Face face = static_cast<Face>(face_i);
-			const Side side = to_side(face);
-			const auto i = get_i(face);
+			const Side side = base::to_side(face);
+			const auto i = base::get_i(face);
 			glm::tvec3<int8_t> pos(x, y, z);
 			pos[i.y] += static_cast<int8_t>(side);
-			if(block_visible_from(info, chunk, block, pos.x, pos.y, pos.z))
+			if(base::block_visible_from(info, chunk, block, pos.x, pos.y, pos.z))
 			{
 				const auto tex = info.texture_info(block, face);
 				const meshmap_key_t key =
@@ -1,5 +1,6 @@
 #include "Simple2.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 
@@ -11,24 +12,51 @@ namespace block_thingy::mesher {
 using block::enums::Face;
 using position::block_in_chunk;
 
+static meshmap_t make_slices_mesh(const Chunk&, block_in_chunk::value_type x_min, block_in_chunk::value_type x_end);
+
 meshmap_t simple2::make_mesh(const Chunk& chunk)
+{
+	return make_slices_mesh(chunk, 0, CHUNK_SIZE);
+}
+
+meshmap_t simple2::make_section_mesh(const Chunk& chunk, const uint8_t section)
+{
+	const auto x_min = static_cast<block_in_chunk::value_type>(section * SECTION_SIZE);
+	const auto x_end = static_cast<block_in_chunk::value_type>(std::min((section + 1) * SECTION_SIZE, CHUNK_SIZE));
+	return make_slices_mesh(chunk, x_min, x_end);
+}
+
+bool simple2::has_sections() const
+{
+	return true;
+}
+
+meshmap_t make_slices_mesh
+(
+	const Chunk& chunk,
+	const block_in_chunk::value_type x_min,
+	const block_in_chunk::value_type x_end
+)
 {
 	const auto& info = chunk.get_owner().block_manager.info;
 	meshmap_t meshes;
 
 	std::array<block_t, CHUNK_BLOCK_COUNT> cache;
 
-	std::size_t block_i = 0;
+	// only the slices being meshed and the slices next to them are read
+	const block_in_chunk::value_type cache_min = static_cast<block_in_chunk::value_type>(std::max(x_min - 1, 0));
+	const block_in_chunk::value_type cache_end = static_cast<block_in_chunk::value_type>(std::min(x_end + 1, static_cast<int>(CHUNK_SIZE)));
+	std::size_t block_i = static_cast<std::size_t>(CHUNK_SIZE * CHUNK_SIZE * cache_min);
 	block_in_chunk c_pos(0, 0, 0);
-	for(c_pos.x = 0; c_pos.x < CHUNK_SIZE; ++c_pos.x)
+	for(c_pos.x = cache_min; c_pos.x < cache_end; ++c_pos.x)
 	for(c_pos.y = 0; c_pos.y < CHUNK_SIZE; ++c_pos.y)
 	for(c_pos.z = 0; c_pos.z < CHUNK_SIZE; ++c_pos.z, ++block_i)
 	{
 		cache[block_i] = chunk.get_block(c_pos);
 	}
 
-	block_i = 0;
-	for(block_in_chunk::value_type x = 0; x < CHUNK_SIZE; ++x)
+	block_i = static_cast<std::size_t>(CHUNK_SIZE * CHUNK_SIZE * x_min);
+	for(block_in_chunk::value_type x = x_min; x < x_end; ++x)
 	for(block_in_chunk::value_type y = 0; y < CHUNK_SIZE; ++y)
 	for(block_in_chunk::value_type z = 0; z < CHUNK_SIZE; ++z, ++block_i)
 	{
@@ -41,8 +69,8 @@ meshmap_t simple2::make_mesh(const Chunk& chunk)
 		for(uint8_t face_i = 0; face_i < 6; ++face_i)
 		{
 			const Face face = static_cast<Face>(face_i);
-			const Side side = to_side(face);
-			const auto i = get_i(face);
+			const Side side = base::to_side(face);
+			const auto i = base::get_i(face);
 			glm::tvec3<int8_t> pos(x, y, z);
 			pos[i.y] += static_cast<int8_t>(side);
 
@@ -62,7 +90,7 @@ meshmap_t simple2::make_mesh(const Chunk& chunk)
 			}
 			else
 			{
-				is_visible = block_visible_from(info, chunk, block, pos.x, pos.y, pos.z);
+				is_visible = base::block_visible_from(info, chunk, block, pos.x, pos.y, pos.z);
 			}
 			if(is_visible)
 			{
@@ -1,5 +1,6 @@
 #include "base.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 #include "block/component/info.hpp"
@@ -32,6 +33,18 @@ mesh_vertex_t::mesh_vertex_t
 {
 }
 
+section_mask_t sections_for_slices(int_fast32_t x_min, int_fast32_t x_max)
+{
+	x_min = std::max(x_min, int_fast32_t(0));
+	x_max = std::min(x_max, CHUNK_SIZE - 1);
+	section_mask_t mask = 0;
+	for(int_fast32_t section = x_min / SECTION_SIZE; section <= x_max / SECTION_SIZE && x_min <= x_max; ++section)
+	{
+		mask |= section_mask_t(1) << section;
+	}
+	return mask;
+}
+
 base::base()
 {
 }
@@ -40,6 +53,20 @@ base::~base()
 {
 }
 
+meshmap_t base::make_section_mesh(const Chunk& chunk, const uint8_t section)
+{
+	if(section != 0)
+	{
+		return {};
+	}
+	return make_mesh(chunk);
+}
+
+bool base::has_sections() const
+{
+	return false;
+}
+
 static void add_square
 (
 	mesh_t& mesh,
@@ -63,6 +63,21 @@ using mesh_triangle_t = glm::tvec3<mesh_vertex_t>;
 using mesh_t = std::vector<mesh_triangle_t>;
 using meshmap_t = std::map<meshmap_key_t, mesh_t>;
 
+/*
+ * Chunk meshes are split along x into sections of SECTION_SIZE slices.
+ * Changing a block changes the faces of at most 3 slices, so only the sections containing them are remeshed.
+ */
+constexpr int_fast32_t SECTION_SIZE = 4;
+constexpr int_fast32_t SECTION_COUNT = (CHUNK_SIZE + SECTION_SIZE - 1) / SECTION_SIZE;
+using section_mask_t = uint64_t;
+static_assert(SECTION_COUNT <= 64, "section_mask_t is too small for this chunk size");
+constexpr section_mask_t ALL_SECTIONS = (SECTION_COUNT == 64) ? ~section_mask_t(0) : (section_mask_t(1) << SECTION_COUNT) - 1;
+
+/*
+ * @return The sections that contain the slices from x_min to x_max (inclusive), clamped to the chunk
+ */
+section_mask_t sections_for_slices(int_fast32_t x_min, int_fast32_t x_max);
+
 enum class Plane
 {
 	XY,
@@ -89,6 +104,17 @@ public:
 
 	virtual meshmap_t make_mesh(const Chunk&) = 0;
 
+	/*
+	 * Make the mesh for the blocks in one section
+	 * The default makes the whole mesh for section 0 and nothing for the others
+	 */
+	virtual meshmap_t make_section_mesh(const Chunk&, uint8_t section);
+
+	/*
+	 * If false, every section must be remade when any of them changes
+	 */
+	virtual bool has_sections() const;
+
 	static void add_face
 	(
 		mesh_t& mesh,
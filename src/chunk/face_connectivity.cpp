@@ -0,0 +1,135 @@
+#include "face_connectivity.hpp"
+
+#include <cstddef>
+#include <vector>
+
+#include "block/enums/Face.hpp"
+
+namespace block_thingy {
+
+using block::enums::Face;
+
+constexpr uint8_t FACE_COUNT = 6;
+// every pair, and each face with itself
+constexpr uint64_t ALL_CONNECTED = (uint64_t(1) << (FACE_COUNT * FACE_COUNT)) - 1;
+
+static uint64_t pair_bits(const uint8_t a, const uint8_t b)
+{
+	return (uint64_t(1) << (a * FACE_COUNT + b))
+		 | (uint64_t(1) << (b * FACE_COUNT + a));
+}
+
+static void visit
+(
+	const std::size_t i,
+	const face_connectivity::opaque_t& opaque,
+	face_connectivity::opaque_t& filled,
+	std::vector<uint32_t>& stack
+)
+{
+	if(!opaque[i] && !filled[i])
+	{
+		filled[i] = true;
+		stack.emplace_back(static_cast<uint32_t>(i));
+	}
+}
+
+face_connectivity::face_connectivity()
+:
+	bits(ALL_CONNECTED)
+{
+}
+
+face_connectivity::face_connectivity(const opaque_t& opaque)
+:
+	bits(0)
+{
+	constexpr auto size = static_cast<std::size_t>(CHUNK_SIZE);
+	opaque_t filled;
+	std::vector<uint32_t> stack;
+	for(std::size_t start = 0; start < opaque.size(); ++start)
+	{
+		if(opaque[start] || filled[start])
+		{
+			continue;
+		}
+
+		// the faces this region touches, a bit for each Face
+		uint8_t faces = 0;
+		visit(start, opaque, filled, stack);
+		while(!stack.empty())
+		{
+			const std::size_t i = stack.back();
+			stack.pop_back();
+			const std::size_t pos[3] = {i / (size * size), i / size % size, i % size};
+			for(uint8_t axis = 0; axis < 3; ++axis)
+			{
+				const std::size_t stride = axis == 0 ? size * size : axis == 1 ? size : 1;
+				// the Face on the positive side of each axis is axis * 2, and the one on the negative side is after it
+				if(pos[axis] == size - 1)
+				{
+					faces |= 1 << (axis * 2);
+				}
+				else
+				{
+					visit(i + stride, opaque, filled, stack);
+				}
+				if(pos[axis] == 0)
+				{
+					faces |= 1 << (axis * 2 + 1);
+				}
+				else
+				{
+					visit(i - stride, opaque, filled, stack);
+				}
+			}
+		}
+
+		for(uint8_t a = 0; a < FACE_COUNT; ++a)
+		for(uint8_t b = a; b < FACE_COUNT; ++b)
+		{
+			if((faces & (1 << a)) != 0 && (faces & (1 << b)) != 0)
+			{
+				bits |= pair_bits(a, b);
+			}
+		}
+		if(bits == ALL_CONNECTED)
+		{
+			// the rest can not connect anything more
+			break;
+		}
+	}
+}
+
+bool face_connectivity::connected(const Face a, const Face b) const
+{
+	return (bits & pair_bits(static_cast<uint8_t>(a), static_cast<uint8_t>(b))) != 0;
+}
+
+uint8_t face_connectivity::connected_faces(const Face face) const
+{
+	return static_cast<uint8_t>((bits >> (static_cast<uint8_t>(face) * FACE_COUNT)) & ((1 << FACE_COUNT) - 1));
+}
+
+void face_connectivity::set_connected(const Face a, const Face b, const bool connected)
+{
+	const uint64_t pair = pair_bits(static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+	bits = connected ? (bits | pair) : (bits & ~pair);
+}
+
+bool face_connectivity::all_connected() const
+{
+	return bits == ALL_CONNECTED;
+}
+
+bool face_connectivity::operator==(const face_connectivity& that) const
+{
+	return bits == that.bits;
+}
+
+bool face_connectivity::operator!=(const face_connectivity& that) const
+{
+	return bits != that.bits;
+}
+
+}
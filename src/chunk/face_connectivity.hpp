@@ -0,0 +1,53 @@
+#pragma once
+
+#include <bitset>
+#include <stdint.h>
+
+#include "fwd/block/enums/Face.hpp"
+#include "fwd/chunk/Chunk.hpp"
+
+namespace block_thingy {
+
+/*
+ * Which faces of a chunk can be seen from which others thru it: two faces are connected if a path of blocks that are
+ * not opaque goes from one to the other
+ * Made when the chunk is meshed, for occlusion culling (see graphics::chunk_occlusion)
+ */
+class face_connectivity
+{
+public:
+	// indexed like chunk_data: x * CHUNK_SIZE² + y * CHUNK_SIZE + z
+	using opaque_t = std::bitset<CHUNK_BLOCK_COUNT>;
+
+	/*
+	 * Every face connected to every other, like a chunk without opaque blocks
+	 */
+	face_connectivity();
+
+	/*
+	 * Flood fill the blocks that are not opaque and connect the faces that each filled region touches
+	 */
+	explicit face_connectivity(const opaque_t&);
+
+	bool connected(block::enums::Face, block::enums::Face) const;
+
+	/*
+	 * A bit for each Face connected to the given one (bit 0 is Face::right)
+	 */
+	uint8_t connected_faces(block::enums::Face) const;
+	void set_connected(block::enums::Face, block::enums::Face, bool);
+
+	/*
+	 * true if every face is connected to every other, so the chunk does not hide anything
+	 */
+	bool all_connected() const;
+
+	bool operator==(const face_connectivity&) const;
+	bool operator!=(const face_connectivity&) const;
+
+private:
+	// bit a * 6 + b and b * 6 + a are set if faces a and b are connected
+	uint64_t bits;
+};
+
+}
@@ -0,0 +1,4 @@
+namespace block_thingy
+{
+	class face_connectivity;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace block_thingy::storage
+{
+	struct chunk_image;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace block_thingy::storage
+{
+	class world_file;
+}
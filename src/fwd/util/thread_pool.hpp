@@ -0,0 +1,6 @@
+#pragma once
+
+namespace block_thingy::util
+{
+	class thread_pool;
+}
@@ -0,0 +1,5 @@
+namespace block_thingy::world
+{
+	class chunk_prefetcher;
+	struct prefetch_stats;
+}
@@ -0,0 +1,6 @@
+namespace block_thingy::world
+{
+	class gen_buffer;
+	class generator;
+	struct generator_stats;
+}
@@ -34,6 +34,7 @@
 #include "event/EventType.hpp"
 #include "event/type/Event_change_setting.hpp"
 #include "event/type/Event_window_size_change.hpp"
+#include "graphics/chunk_cull_list.hpp"
 #include "graphics/image.hpp"
 #include "graphics/render_world.hpp"
 #include "graphics/GUI/Base.hpp"
@@ -51,11 +52,16 @@
 #include "physics/raycast_util.hpp"
 #include "plugin/PluginManager.hpp"
 #include "position/block_in_world.hpp"
+#include "storage/chunk_load_stats.hpp"
+#include "storage/codec.hpp"
 #include "util/demangled_name.hpp"
 #include "util/filesystem.hpp"
 #include "util/grisu2.hpp"
 #include "util/logger.hpp"
 #include "util/misc.hpp"
+#include "world/chunk_prefetcher.hpp"
+#include "world/generator.hpp"
+#include "world/terrain_generator.hpp"
 
 using std::nullopt;
 using std::shared_ptr;
@@ -101,7 +107,9 @@ struct game::impl
 	double delta_time;
 	fps_manager fps;
 	uint64_t global_ticks;
-	std::tuple<uint64_t, uint64_t> draw_stats;
+	graphics::draw_stats draw_stats;
+	// the world's chunks that draw_world culls
+	graphics::chunk_cull_list cull_list;
 
 	void find_hovered_block();
 
@@ -141,6 +149,19 @@ static unique_ptr<mesher::base> make_mesher(const string& name)
 	return make_mesher("simple2");
 }
 
+/*
+ * The built-in generator, or one from a plugin
+ * @return nullptr if there is no generator with the name
+ */
+static shared_ptr<world::generator> make_generator(const string& name)
+{
+	if(name == world::terrain_generator::NAME)
+	{
+		return std::make_shared<world::terrain_generator>();
+	}
+	return PluginManager::instance->make_generator(name);
+}
+
 game::game()
 :
 	set_instance(this),
@@ -227,7 +248,7 @@ void game::draw()
 		r->uniform("world_time", world_time);
 	});
 
-	pImpl->draw_stats = {0, 0};
+	pImpl->draw_stats = {};
 
 	if(pImpl->temp_gui != nullptr)
 	{
@@ -329,20 +350,16 @@ void game::draw_world
 
 	gfx.set_camera_view(cam_position, cam_rotation, projection_matrix);
 	position::block_in_world render_origin(cam_position);
-	const std::tuple<uint64_t, uint64_t> draw_stats = graphics::draw_world
+	pImpl->draw_stats += graphics::draw_world
 	(
 		*world,
+		pImpl->cull_list,
 		resource_manager,
 		camera,
 		gfx.vp_matrix,
 		render_origin,
 		static_cast<uint64_t>(settings::get<int64_t>("render_distance"))
 	);
-	pImpl->draw_stats =
-	{
-		std::get<0>(pImpl->draw_stats) + std::get<0>(draw_stats),
-		std::get<1>(pImpl->draw_stats) + std::get<1>(draw_stats),
-	};
 
 	assert(player != nullptr);
 	if(player->hovered_block != nullopt
@@ -421,12 +438,27 @@ void game::quit()
 	pImpl->temp_gui->switch_from();
 	gui->switch_to();
 	player = nullptr;
+	pImpl->cull_list.clear();
 	world = nullptr;
 }
 
 void game::new_world(fs::path path, const string& name, const double seed)
 {
 	load_world(std::move(path));
+	if(world == nullptr)
+	{
+		return;
+	}
+	const string generator_name = settings::get<string>("world_generator");
+	if(auto gen = make_generator(generator_name);
+		gen != nullptr)
+	{
+		world->set_generator(std::move(gen));
+	}
+	else
+	{
+		LOG(ERROR) << "no plugin has generator " << generator_name << "; using " << world->get_generator_name() << '\n';
+	}
 	resource_manager.load_blocks(world->block_manager);
 	world->set_name(name);
 	world->set_seed(seed);
@@ -446,6 +478,18 @@ void game::load_world(fs::path path)
 	}
 	LOG(INFO) << "loading world " << path.u8string() << '\n';
 	world = std::make_shared<world::world>(path, make_mesher(settings::get<string>("mesher")));
+	if(!world->has_generator())
+	{
+		// generating with another one would make chunks that do not match the saved ones
+		auto gen = make_generator(world->get_generator_name());
+		if(gen == nullptr)
+		{
+			LOG(ERROR) << "can not load world " << path.u8string() << " because no plugin has its generator " << world->get_generator_name() << '\n';
+			world = nullptr;
+			return;
+		}
+		world->set_generator(std::move(gen));
+	}
 	player = world->add_player("test_player");
 	PluginManager::instance->plugin_load_world(*world);
 	open_gui(make_gui("play"));
@@ -482,7 +526,7 @@ double game::get_global_time() const
 	return pImpl->global_ticks / 60.0;
 }
 
-std::tuple<uint64_t, uint64_t> game::get_draw_stats() const
+graphics::draw_stats game::get_draw_stats() const
 {
 	return pImpl->draw_stats;
 }
@@ -593,6 +637,86 @@ void game::impl::add_commands()
 		ASSERT_IN_GAME("save");
 		g.world->save_all();
 	});
+	COMMAND("migrate_chunks")
+	{
+		ASSERT_IN_GAME("migrate_chunks");
+		g.world->migrate_chunk_files();
+	});
+	COMMAND("chunk_codec")
+	{
+		ASSERT_IN_GAME("chunk_codec");
+
+		if(args.empty())
+		{
+			LOG(INFO) << "chunk codec: " << g.world->get_chunk_codec() << '\n';
+			return;
+		}
+		const auto codec = args.size() == 1 ? storage::codec_from_name(args[0]) : nullopt;
+		if(codec == nullopt)
+		{
+			LOG(ERROR) << "Usage: chunk_codec [none|deflate|lz]\n";
+			return;
+		}
+		g.world->set_chunk_codec(*codec);
+		LOG(INFO) << "chunks will be saved with " << *codec << '\n';
+	});
+	COMMAND("chunk_light")
+	{
+		ASSERT_IN_GAME("chunk_light");
+
+		if(args.empty())
+		{
+			LOG(INFO) << "chunk light: " << (g.world->get_save_light() ? "save" : "omit") << '\n';
+			return;
+		}
+		if(args.size() != 1 || (args[0] != "save" && args[0] != "omit"))
+		{
+			LOG(ERROR) << "Usage: chunk_light [save|omit]\n";
+			return;
+		}
+		g.world->set_save_light(args[0] == "save");
+		LOG(INFO) << "chunks will be saved " << (args[0] == "save" ? "with" : "without") << " their light\n";
+	});
+	COMMAND("chunk_load_stats")
+	{
+		ASSERT_IN_GAME("chunk_load_stats");
+
+		const storage::chunk_load_stats stats = g.world->get_chunk_load_stats();
+		LOG(INFO) << "chunks loaded: " << stats.loaded << '\n';
+		if(stats.loaded != 0)
+		{
+			LOG(INFO) << "allocations per chunk: " << static_cast<double>(stats.allocations) / static_cast<double>(stats.loaded) << '\n';
+			LOG(INFO) << "bytes copied per chunk: " << static_cast<double>(stats.bytes_copied) / static_cast<double>(stats.loaded) << '\n';
+		}
+	});
+	COMMAND("generator_stats")
+	{
+		ASSERT_IN_GAME("generator_stats");
+
+		const world::generator_stats stats = g.world->get_generator_stats();
+		LOG(INFO) << "generator " << g.world->get_generator_name() << ", chunks generated: " << stats.chunks << '\n';
+		if(stats.chunks != 0)
+		{
+			for(std::size_t i = 0; i < world::GENERATOR_STAGE_COUNT; ++i)
+			{
+				LOG(INFO) << static_cast<world::generator_stage>(i) << ": "
+						  << stats.seconds[i] * 1e6 / static_cast<double>(stats.chunks) << " us per chunk\n";
+			}
+		}
+	});
+	COMMAND("prefetch_stats")
+	{
+		ASSERT_IN_GAME("prefetch_stats");
+
+		const world::prefetch_stats stats = g.world->get_prefetch_stats();
+		LOG(INFO) << "chunks prefetched: " << stats.requested << '\n';
+		LOG(INFO) << "hits: " << stats.hits << " (" << stats.late << " not ready in time), wasted: " << stats.wasted << '\n';
+		if(stats.hits + stats.wasted != 0)
+		{
+			LOG(INFO) << "hit rate: " << static_cast<double>(stats.hits) * 100 / static_cast<double>(stats.hits + stats.wasted) << "%\n";
+		}
+		LOG(INFO) << "lookahead: " << stats.lookahead_seconds << "s\n";
+	});
 	COMMAND("quit")
 	{
 		g.quit();
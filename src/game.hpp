@@ -3,7 +3,6 @@
 #include <cassert>
 #include <memory>
 #include <string>
-#include <tuple>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
@@ -15,6 +14,7 @@
 #include "event/EventManager.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/GUI/Base.hpp"
+#include "graphics/render_world.hpp"
 #include "fwd/input/char_press.hpp"
 #include "fwd/input/joy_press.hpp"
 #include "fwd/input/key_press.hpp"
@@ -106,9 +106,9 @@ public:
 	double get_global_time() const;
 
 	/**
-	 * @return The amount of chunks considered for drawing and the amount of chunks drawn in the last frame
+	 * @return What draw_world drew and culled in the last frame
 	 */
-	std::tuple<uint64_t, uint64_t> get_draw_stats() const;
+	graphics::draw_stats get_draw_stats() const;
 
 	void update_framebuffer_size(const window_size_t&);
 	void keypress(const input::key_press&);
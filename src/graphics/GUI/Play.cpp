@@ -18,12 +18,16 @@
 #include "console/KeybindManager.hpp"
 #include "graphics/camera.hpp"
 #include "graphics/color.hpp"
+#include "graphics/render_world.hpp"
 #include "input/key_mods.hpp"
 #include "position/block_in_chunk.hpp"
 #include "position/block_in_world.hpp"
 #include "position/chunk_in_world.hpp"
 #include "util/grisu2.hpp"
 #include "util/logger.hpp"
+#include "world/chunk_prefetcher.hpp"
+#include "world/chunk_stage.hpp"
+#include "world/world.hpp"
 
 using std::nullopt;
 using std::shared_ptr;
@@ -142,17 +146,46 @@ void Play::draw_debug_text()
 
 	{
 		ss << "render distance: " << settings::get<int64_t>("render_distance") << '\n';
-		const auto [total, drawn] = g.get_draw_stats();
-		ss << "\tchunks in range: " << total << '\n';
-		ss << "\tchunks drawn   : " << drawn;
-		if(total != 0)
+		const graphics::draw_stats stats = g.get_draw_stats();
+		ss << "\tchunks meshed   : " << stats.meshed << '\n';
+		ss << "\tfrustum culled  : " << stats.frustum_culled << '\n';
+		ss << "\tocclusion culled: " << stats.occlusion_culled << '\n';
+		ss << "\tchunks drawn    : " << stats.drawn;
+		if(stats.meshed != 0)
 		{
-			const double percent = std::round(static_cast<double>(drawn * 100 * 100) / total) / 100;
+			const double percent = std::round(static_cast<double>(stats.drawn * 100 * 100) / stats.meshed) / 100;
 			ss << " (" << percent << "%)";
 		}
 		ss << '\n';
 	}
 
+	{
+		const auto counts = g.world->get_chunk_stage_counts();
+		ss << "chunk stages:";
+		for(std::size_t i = 0; i < counts.size(); ++i)
+		{
+			ss << ' ' << static_cast<world::chunk_stage>(i) << '=' << counts[i];
+		}
+		ss << '\n';
+		const auto [completed, cancelled] = g.world->get_chunk_job_counts();
+		ss << "\tchunk jobs completed: " << completed << '\n';
+		ss << "\tchunk jobs cancelled: " << cancelled << '\n';
+		ss << "\tchunks integrated/s: " << std::round(g.world->get_chunks_integrated_per_second()) << '\n';
+		const world::prefetch_stats prefetch = g.world->get_prefetch_stats();
+		ss << "\tchunks prefetched: " << prefetch.requested << " (hits: " << prefetch.hits << ", wasted: " << prefetch.wasted
+		   << ", lookahead: " << std::round(prefetch.lookahead_seconds * 100) / 100 << "s)\n";
+		const auto [playable_seconds, loaded_seconds] = g.world->get_load_times();
+		if(playable_seconds != nullopt)
+		{
+			ss << "\tfirst playable frame after " << std::round(*playable_seconds * 100) / 100 << "s";
+			if(loaded_seconds != nullopt)
+			{
+				ss << ", all chunks meshed after " << std::round(*loaded_seconds * 100) / 100 << "s";
+			}
+			ss << '\n';
+		}
+	}
+
 	ss << "field of view: " << settings::get<double>("fov") << '\n';
 	ss << "projection type: " << settings::get<string>("projection_type") << '\n';
 
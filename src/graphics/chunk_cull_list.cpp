@@ -0,0 +1,270 @@
+#include "chunk_cull_list.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#ifdef __AVX__
+	#include <immintrin.h>
+#endif
+
+#include <glm/vec3.hpp>
+
+#include "chunk/Chunk.hpp"
+#include "physics/AABB.hpp"
+#include "world/world.hpp"
+
+namespace block_thingy::graphics {
+
+using position::chunk_in_world;
+using std::shared_ptr;
+
+#ifdef __AVX__
+// one AVX register of doubles
+constexpr std::size_t CULL_LANES = 4;
+
+namespace {
+
+/*
+ * A plane with each number in every lane, and which corner of a box is farthest along its normal
+ */
+struct avx_plane
+{
+	explicit avx_plane(const plane& p)
+	:
+		normal_x(_mm256_set1_pd(p.normal.x)),
+		normal_y(_mm256_set1_pd(p.normal.y)),
+		normal_z(_mm256_set1_pd(p.normal.z)),
+		d(_mm256_set1_pd(p.d)),
+		max_x(p.normal.x > 0),
+		max_y(p.normal.y > 0),
+		max_z(p.normal.z > 0)
+	{
+	}
+
+	__m256d normal_x;
+	__m256d normal_y;
+	__m256d normal_z;
+	__m256d d;
+	bool max_x;
+	bool max_y;
+	bool max_z;
+};
+
+}
+#endif
+
+void chunk_cull_list::update(world::world& world)
+{
+	world.take_render_changes(changes);
+	for(auto& [pos, chunk] : changes)
+	{
+		const face_connectivity chunk_connectivity = chunk != nullptr ? chunk->get_face_connectivity() : face_connectivity();
+		if(chunk_connectivity.all_connected())
+		{
+			if(connectivity.erase(pos) != 0)
+			{
+				++connectivity_generation;
+			}
+		}
+		else
+		{
+			const auto [i, emplaced] = connectivity.emplace(pos, chunk_connectivity);
+			if(emplaced || i->second != chunk_connectivity)
+			{
+				i->second = chunk_connectivity;
+				++connectivity_generation;
+			}
+		}
+
+		if(chunk != nullptr && chunk->has_mesh())
+		{
+			set(pos, std::move(chunk));
+		}
+		else
+		{
+			remove(pos);
+		}
+	}
+	changes.clear();
+}
+
+void chunk_cull_list::clear()
+{
+	min_x.clear();
+	min_y.clear();
+	min_z.clear();
+	positions.clear();
+	chunks.clear();
+	indexes.clear();
+	changes.clear();
+	connectivity.clear();
+	++connectivity_generation;
+}
+
+void chunk_cull_list::set(const chunk_in_world& pos, shared_ptr<Chunk> chunk)
+{
+	const auto [i, emplaced] = indexes.emplace(pos, positions.size());
+	if(!emplaced)
+	{
+		chunks[i->second] = std::move(chunk);
+		return;
+	}
+	// the same as physics::AABB(pos).min
+	min_x.emplace_back(static_cast<double>(pos.x * CHUNK_SIZE));
+	min_y.emplace_back(static_cast<double>(pos.y * CHUNK_SIZE));
+	min_z.emplace_back(static_cast<double>(pos.z * CHUNK_SIZE));
+	positions.emplace_back(pos);
+	chunks.emplace_back(std::move(chunk));
+}
+
+void chunk_cull_list::remove(const chunk_in_world& pos)
+{
+	const auto i = indexes.find(pos);
+	if(i == indexes.cend())
+	{
+		return;
+	}
+	// the last chunk is moved into its place
+	const std::size_t index = i->second;
+	const std::size_t last = positions.size() - 1;
+	indexes.erase(i);
+	if(index != last)
+	{
+		min_x[index] = min_x[last];
+		min_y[index] = min_y[last];
+		min_z[index] = min_z[last];
+		positions[index] = positions[last];
+		chunks[index] = std::move(chunks[last]);
+		indexes[positions[index]] = index;
+	}
+	min_x.pop_back();
+	min_y.pop_back();
+	min_z.pop_back();
+	positions.pop_back();
+	chunks.pop_back();
+}
+
+std::size_t chunk_cull_list::size() const
+{
+	return positions.size();
+}
+
+const chunk_in_world& chunk_cull_list::get_position(const std::size_t i) const
+{
+	assert(i < positions.size());
+	return positions[i];
+}
+
+const shared_ptr<Chunk>& chunk_cull_list::get_chunk(const std::size_t i) const
+{
+	assert(i < chunks.size());
+	return chunks[i];
+}
+
+void chunk_cull_list::cull
+(
+	const std::vector<plane>& planes,
+	const chunk_in_world& origin_chunk,
+	std::vector<std::size_t>& inside
+) const
+{
+	const glm::dvec3 origin(physics::AABB(origin_chunk).min);
+	const auto size = static_cast<double>(CHUNK_SIZE);
+	const std::size_t count = positions.size();
+	std::size_t i = 0;
+
+#ifdef __AVX__
+	std::vector<avx_plane> avx_planes;
+	avx_planes.reserve(planes.size());
+	for(const plane& p : planes)
+	{
+		avx_planes.emplace_back(p);
+	}
+	const __m256d origin_x = _mm256_set1_pd(origin.x);
+	const __m256d origin_y = _mm256_set1_pd(origin.y);
+	const __m256d origin_z = _mm256_set1_pd(origin.z);
+	const __m256d size_v = _mm256_set1_pd(size);
+	const __m256d zero = _mm256_setzero_pd();
+	for(; i + CULL_LANES <= count; i += CULL_LANES)
+	{
+		const __m256d x = _mm256_sub_pd(_mm256_loadu_pd(&min_x[i]), origin_x);
+		const __m256d y = _mm256_sub_pd(_mm256_loadu_pd(&min_y[i]), origin_y);
+		const __m256d z = _mm256_sub_pd(_mm256_loadu_pd(&min_z[i]), origin_z);
+		__m256d outside = zero;
+		for(const avx_plane& p : avx_planes)
+		{
+			// plane::distance_p, with the products added in the same order as glm::dot so that the result is the same
+			const __m256d corner_x = p.max_x ? _mm256_add_pd(x, size_v) : x;
+			const __m256d corner_y = p.max_y ? _mm256_add_pd(y, size_v) : y;
+			const __m256d corner_z = p.max_z ? _mm256_add_pd(z, size_v) : z;
+			const __m256d dot = _mm256_add_pd
+			(
+				_mm256_add_pd(_mm256_mul_pd(p.normal_x, corner_x), _mm256_mul_pd(p.normal_y, corner_y)),
+				_mm256_mul_pd(p.normal_z, corner_z)
+			);
+			const __m256d distance = _mm256_add_pd(p.d, dot);
+			outside = _mm256_or_pd(outside, _mm256_cmp_pd(distance, zero, _CMP_LT_OQ));
+		}
+		const int outside_mask = _mm256_movemask_pd(outside);
+		for(std::size_t lane = 0; lane < CULL_LANES; ++lane)
+		{
+			if((outside_mask & (1 << lane)) == 0)
+			{
+				inside.emplace_back(i + lane);
+			}
+		}
+	}
+#endif
+
+	// without AVX, and the chunks after the last full register
+	for(; i < count; ++i)
+	{
+		const glm::dvec3 min(min_x[i] - origin.x, min_y[i] - origin.y, min_z[i] - origin.z);
+		const physics::AABB aabb(min, min + size);
+		bool is_inside = true;
+		for(const plane& p : planes)
+		{
+			if(p.distance_p(aabb) < 0)
+			{
+				is_inside = false;
+				break;
+			}
+		}
+		if(is_inside)
+		{
+			inside.emplace_back(i);
+		}
+	}
+}
+
+std::size_t chunk_cull_list::occlude
+(
+	const chunk_in_world& camera_chunk,
+	const chunk_in_world::value_type render_distance,
+	std::vector<std::size_t>& inside
+)
+{
+	if(camera_chunk != occlusion_chunk
+		|| render_distance != occlusion_render_distance
+		|| connectivity_generation != occlusion_generation)
+	{
+		occlusion.update(camera_chunk, render_distance, [this](const chunk_in_world& pos) -> const face_connectivity*
+		{
+			const auto i = connectivity.find(pos);
+			return i != connectivity.cend() ? &i->second : nullptr;
+		});
+		occlusion_chunk = camera_chunk;
+		occlusion_render_distance = render_distance;
+		occlusion_generation = connectivity_generation;
+	}
+
+	const std::size_t count = inside.size();
+	inside.erase(std::remove_if(inside.begin(), inside.end(), [this](const std::size_t i)
+	{
+		return !occlusion.is_visible(positions[i]);
+	}), inside.end());
+	return count - inside.size();
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "chunk/face_connectivity.hpp"
+#include "graphics/chunk_occlusion.hpp"
+#include "graphics/plane.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "fwd/world/world.hpp"
+
+namespace block_thingy::graphics {
+
+/*
+ * The loaded chunks that have something to draw, with the corners of their boxes kept in an array for each axis so
+ * that cull tests several chunks against a plane at once
+ * It is kept up to date with the chunks the world meshed and removed, instead of looking up each position within
+ * render distance every frame
+ */
+class chunk_cull_list
+{
+public:
+	/*
+	 * Add the chunks the world meshed since the last update (if their mesh is not empty) and remove the chunks it
+	 * removed
+	 * The face connectivity of each meshed chunk is kept for occlude, even if its mesh is empty (a chunk of stone hides
+	 * what is behind it)
+	 */
+	void update(world::world&);
+
+	/*
+	 * Call this before the world is closed, since the chunks keep a reference to it
+	 */
+	void clear();
+
+	/*
+	 * Add the chunk, or replace the one at its position
+	 */
+	void set(const position::chunk_in_world&, std::shared_ptr<Chunk>);
+	void remove(const position::chunk_in_world&);
+
+	std::size_t size() const;
+	const position::chunk_in_world& get_position(std::size_t i) const;
+	const std::shared_ptr<Chunk>& get_chunk(std::size_t i) const;
+
+	/*
+	 * Add the index of each chunk whose box is inside every plane to inside, in order
+	 * The boxes are relative to origin_chunk, like the ones draw_world gives default_view_frustum::inside, and the
+	 * result is the same as its
+	 * With AVX (which -march=native enables where the CPU has it), 4 chunks are tested at once
+	 */
+	void cull
+	(
+		const std::vector<plane>&,
+		const position::chunk_in_world& origin_chunk,
+		std::vector<std::size_t>& inside
+	) const;
+
+	/*
+	 * Remove the chunks that can not be seen from camera_chunk (see chunk_occlusion) from inside, keeping the order
+	 * The search is done again only when the camera moves to another chunk or a chunk's connectivity changes
+	 * @return how many were removed
+	 */
+	std::size_t occlude
+	(
+		const position::chunk_in_world& camera_chunk,
+		position::chunk_in_world::value_type render_distance,
+		std::vector<std::size_t>& inside
+	);
+
+private:
+	// the corner of each chunk with the lowest coordinates, in blocks
+	std::vector<double> min_x;
+	std::vector<double> min_y;
+	std::vector<double> min_z;
+	std::vector<position::chunk_in_world> positions;
+	std::vector<std::shared_ptr<Chunk>> chunks;
+	position::unordered_map_t<position::chunk_in_world, std::size_t> indexes;
+
+	// only the chunks that are not all connected
+	position::unordered_map_t<position::chunk_in_world, face_connectivity> connectivity;
+	// incremented when connectivity changes
+	uint64_t connectivity_generation = 0;
+
+	// for occlude
+	chunk_occlusion occlusion;
+	position::chunk_in_world occlusion_chunk;
+	position::chunk_in_world::value_type occlusion_render_distance = -1;
+	uint64_t occlusion_generation = 0;
+
+	// for update
+	position::unordered_map_t<position::chunk_in_world, std::shared_ptr<Chunk>> changes;
+};
+
+}
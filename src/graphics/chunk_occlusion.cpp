@@ -0,0 +1,155 @@
+#include "chunk_occlusion.hpp"
+
+#include "block/enums/Face.hpp"
+#include "chunk/face_connectivity.hpp"
+#include "world/view_sphere.hpp"
+
+namespace block_thingy::graphics {
+
+using block::enums::Face;
+using position::chunk_in_world;
+
+constexpr uint8_t FACE_COUNT = 6;
+constexpr uint8_t ENTERED = 0x3F;
+constexpr uint8_t LOOKED_UP = 0x40;
+constexpr uint8_t OUTSIDE = 0x80;
+
+static uint8_t opposite(const uint8_t face)
+{
+	return face ^ 1;
+}
+
+chunk_occlusion::chunk_occlusion()
+:
+	render_distance(-1),
+	side(0),
+	visible_count(0)
+{
+}
+
+void chunk_occlusion::update
+(
+	const chunk_in_world& camera_chunk,
+	const chunk_in_world::value_type render_distance,
+	const connectivity_getter& get_connectivity
+)
+{
+	this->camera_chunk = camera_chunk;
+	if(render_distance != this->render_distance)
+	{
+		this->render_distance = render_distance;
+		side = static_cast<std::size_t>(render_distance * 2 + 3);
+		blank_grid.assign(side * side * side, OUTSIDE);
+		chunk_in_world offset;
+		for(offset.x = -render_distance; offset.x <= render_distance; ++offset.x)
+		for(offset.y = -render_distance; offset.y <= render_distance; ++offset.y)
+		for(offset.z = -render_distance; offset.z <= render_distance; ++offset.z)
+		{
+			if(world::view_sphere::contains(offset, render_distance))
+			{
+				blank_grid[static_cast<std::size_t>(index(offset))] = 0;
+			}
+		}
+		connectivities.resize(blank_grid.size());
+	}
+	grid = blank_grid;
+	queue.clear();
+
+	// the index and offset of the neighbor on each Face
+	const auto stride_x = static_cast<std::ptrdiff_t>(side * side);
+	const auto stride_y = static_cast<std::ptrdiff_t>(side);
+	const std::ptrdiff_t neighbors[FACE_COUNT] = {stride_x, -stride_x, stride_y, -stride_y, 1, -1};
+	const int32_t neighbor_x[FACE_COUNT] = {1, -1, 0, 0, 0, 0};
+	const int32_t neighbor_y[FACE_COUNT] = {0, 0, 1, -1, 0, 0};
+	const int32_t neighbor_z[FACE_COUNT] = {0, 0, 0, 0, 1, -1};
+
+	// a step is queued only by the first path to enter a chunk by each face, so each chunk is searched from at most 6
+	// times
+	const auto enter = [this, &neighbors, &neighbor_x, &neighbor_y, &neighbor_z]
+	(
+		const step& from,
+		const uint8_t face
+	)
+	{
+		const auto i = static_cast<std::size_t>(from.index + neighbors[face]);
+		const uint8_t entered_by = opposite(face);
+		uint8_t& cell = grid[i];
+		if((cell & (OUTSIDE | (1 << entered_by))) != 0)
+		{
+			return;
+		}
+		if((cell & ENTERED) == 0)
+		{
+			++visible_count;
+		}
+		cell |= 1 << entered_by;
+		queue.push_back
+		({
+			static_cast<uint32_t>(i),
+			from.x + neighbor_x[face],
+			from.y + neighbor_y[face],
+			from.z + neighbor_z[face],
+			entered_by,
+			static_cast<uint8_t>(from.directions | (1 << face)),
+		});
+	};
+
+	// the camera's chunk is seen out of from every face, even if it is in a wall
+	const step center{static_cast<uint32_t>(index({0, 0, 0})), 0, 0, 0, 0, 0};
+	grid[center.index] |= ENTERED;
+	visible_count = 1;
+	for(uint8_t face = 0; face < FACE_COUNT; ++face)
+	{
+		enter(center, face);
+	}
+
+	for(std::size_t next = 0; next < queue.size(); ++next)
+	{
+		const step s = queue[next];
+		if((grid[s.index] & LOOKED_UP) == 0)
+		{
+			connectivities[s.index] = get_connectivity(camera_chunk + chunk_in_world(s.x, s.y, s.z));
+			grid[s.index] |= LOOKED_UP;
+		}
+		const face_connectivity* connectivity = connectivities[s.index];
+		uint8_t faces = connectivity != nullptr ? connectivity->connected_faces(static_cast<Face>(s.entered_by)) : ENTERED;
+		// going back the way it came (which includes the face it was entered by) can not see more
+		faces &= static_cast<uint8_t>(~(((s.directions & 0x15) << 1) | ((s.directions & 0x2A) >> 1)));
+		for(uint8_t face = 0; face < FACE_COUNT; ++face)
+		{
+			if((faces & (1 << face)) != 0)
+			{
+				// the layer past render distance keeps this in grid
+				enter(s, face);
+			}
+		}
+	}
+}
+
+bool chunk_occlusion::is_visible(const chunk_in_world& pos) const
+{
+	const std::ptrdiff_t i = index(pos - camera_chunk);
+	return i >= 0 && (grid[static_cast<std::size_t>(i)] & ENTERED) != 0;
+}
+
+std::size_t chunk_occlusion::get_visible_count() const
+{
+	return visible_count;
+}
+
+std::ptrdiff_t chunk_occlusion::index(const chunk_in_world& offset) const
+{
+	// the layer past render distance is not part of the search, so it is left out here
+	const chunk_in_world::value_type r = render_distance;
+	if(r < 0
+		|| offset.x < -r || offset.x > r
+		|| offset.y < -r || offset.y > r
+		|| offset.z < -r || offset.z > r)
+	{
+		return -1;
+	}
+	const auto s = static_cast<chunk_in_world::value_type>(side);
+	return static_cast<std::ptrdiff_t>(((offset.x + r + 1) * s + (offset.y + r + 1)) * s + (offset.z + r + 1));
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+#include "fwd/chunk/face_connectivity.hpp"
+#include "position/chunk_in_world.hpp"
+
+namespace block_thingy::graphics {
+
+/*
+ * The chunks within render distance that can be seen from the camera's chunk, found with a breadth-first search that
+ * goes from a chunk to its neighbor only thru a face that the chunk connects to the face it was entered by, and never
+ * back toward the camera on an axis it has gone away from it on (so a path can not bend around behind a wall)
+ * Chunks with no face_connectivity (not loaded yet, or without opaque blocks) are seen thru from every face
+ */
+class chunk_occlusion
+{
+public:
+	using connectivity_getter = std::function<const face_connectivity*(const position::chunk_in_world&)>;
+
+	chunk_occlusion();
+
+	void update
+	(
+		const position::chunk_in_world& camera_chunk,
+		position::chunk_in_world::value_type render_distance,
+		const connectivity_getter&
+	);
+
+	/*
+	 * Outside of render distance, false
+	 */
+	bool is_visible(const position::chunk_in_world&) const;
+
+	std::size_t get_visible_count() const;
+
+private:
+	struct step
+	{
+		// in grid
+		uint32_t index;
+		// from camera_chunk (kept so that it is not divided out of index for each chunk)
+		int32_t x;
+		int32_t y;
+		int32_t z;
+		// the face of the chunk it was entered by
+		uint8_t entered_by;
+		// a bit for each Face that the path has gone out of a chunk by
+		uint8_t directions;
+	};
+
+	/*
+	 * Index in grid of the offset from camera_chunk, or -1 outside of it
+	 */
+	std::ptrdiff_t index(const position::chunk_in_world& offset) const;
+
+	position::chunk_in_world camera_chunk;
+	position::chunk_in_world::value_type render_distance;
+	// the cube around camera_chunk, with a layer outside of render distance on each side so that the neighbors of a
+	// chunk in it are too
+	std::size_t side;
+	// for each position in the cube: a bit for each Face the search entered it by (so it is visible), 0x40 if its
+	// connectivity was looked up, and 0x80 if it is past render distance
+	std::vector<uint8_t> grid;
+	// grid before searching, made again only when render_distance changes
+	std::vector<uint8_t> blank_grid;
+	std::vector<const face_connectivity*> connectivities;
+	std::vector<step> queue;
+	std::size_t visible_count;
+};
+
+}
@@ -124,4 +124,9 @@ bool default_view_frustum::inside(const physics::AABB& aabb) const
 	return true;
 }
 
+const std::vector<plane>& default_view_frustum::get_planes() const
+{
+	return planes;
+}
+
 }
@@ -38,6 +38,11 @@ public:
 	bool inside(const glm::dvec3&) const override;
 	bool inside(const physics::AABB&) const override;
 
+	/*
+	 * A point is inside if its distance to each plane is not negative
+	 */
+	const std::vector<plane>& get_planes() const;
+
 private:
 	std::vector<plane> planes;
 };
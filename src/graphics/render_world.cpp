@@ -1,7 +1,13 @@
 #include "render_world.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
 #include <memory>
+#include <optional>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include <glm/trigonometric.hpp>
 
@@ -9,16 +15,20 @@
 #include "resource_manager.hpp"
 #include "settings.hpp"
 #include "chunk/Chunk.hpp"
+#include "chunk/Mesher/LOD.hpp"
 #include "graphics/camera.hpp"
+#include "graphics/chunk_cull_list.hpp"
 #include "graphics/default_view_frustum.hpp"
-#include "graphics/null_frustum.hpp"
 #include "graphics/opengl/shader_program.hpp"
+#include "graphics/plane.hpp"
 #include "physics/AABB.hpp"
 #include "position/block_in_world.hpp"
 #include "position/chunk_in_world.hpp"
 #include "util/misc.hpp"
+#include "world/view_sphere.hpp"
 #include "world/world.hpp"
 
+using std::nullopt;
 using std::shared_ptr;
 using std::string;
 
@@ -28,9 +38,64 @@ using graphics::opengl::shader_program;
 using position::block_in_world;
 using position::chunk_in_world;
 
-std::tuple<uint64_t, uint64_t> draw_world
+/*
+ * Debug outlines for every chunk within render distance in the frustum, colored by whether it is loaded
+ */
+static void draw_chunk_outlines
 (
 	world::world& world,
+	const std::optional<default_view_frustum>& frustum,
+	const chunk_in_world& chunk_pos,
+	const chunk_in_world& camera_chunk,
+	const chunk_in_world::value_type render_distance
+)
+{
+	const chunk_in_world min = chunk_pos - render_distance;
+	const chunk_in_world max = chunk_pos + render_distance;
+	chunk_in_world pos;
+	for(pos.x = min.x; pos.x <= max.x; ++pos.x)
+	for(pos.y = min.y; pos.y <= max.y; ++pos.y)
+	for(pos.z = min.z; pos.z <= max.z; ++pos.z)
+	{
+		// the world does not load the corners of the cube
+		if(!world::view_sphere::contains(pos - chunk_pos, render_distance))
+		{
+			continue;
+		}
+		const chunk_in_world gpos(pos - camera_chunk);
+		if(frustum != nullopt && !frustum->inside(physics::AABB(gpos)))
+		{
+			continue;
+		}
+
+		const shared_ptr<Chunk> chunk = world.get_chunk(pos);
+		const glm::dvec3 box_min(static_cast<block_in_world::vec_type>(block_in_world(pos, {})));
+		const glm::dvec3 box_max(box_min + static_cast<double>(CHUNK_SIZE));
+		glm::dvec4 color(glm::uninitialize);
+		if(chunk == nullptr)
+		{
+			// not loaded = red
+			color = glm::dvec4(1, 0, 0, 1);
+		}
+		// TODO: add generating or loading = orange
+		else if(world.is_meshing_queued(chunk))
+		{
+			// meshing = yellow
+			color = glm::dvec4(1, 1, 0, 1);
+		}
+		else
+		{
+			// loaded = green
+			color = glm::dvec4(0, 1, 0, 1);
+		}
+		Gfx::instance->draw_box_outline(box_min, box_max, color);
+	}
+}
+
+draw_stats draw_world
+(
+	world::world& world,
+	chunk_cull_list& cull_list,
 	resource_manager& resource_manager,
 	graphics::camera& camera,
 	const glm::dmat4& vp_matrix_,
@@ -53,7 +118,8 @@ std::tuple<uint64_t, uint64_t> draw_world
 		}
 	});
 
-	std::unique_ptr<frustum> frustum_;
+	// with no frustum, every chunk is drawn
+	std::optional<default_view_frustum> frustum;
 	if(settings::get<bool>("frustum_culling"))
 	{
 		const string projection_type = settings::get<string>("projection_type");
@@ -65,11 +131,11 @@ std::tuple<uint64_t, uint64_t> draw_world
 		const double ratio = static_cast<double>(Gfx::instance->window_size.x) / Gfx::instance->window_size.y;
 		if(projection_type == "default")
 		{
-			frustum_ = std::make_unique<default_view_frustum>(pos, rot, near, far, fov, ratio);
+			frustum.emplace(pos, rot, near, far, fov, ratio);
 		}
 		else if(projection_type == "infinite")
 		{
-			frustum_ = std::make_unique<default_view_frustum>(pos, rot, near, fov, ratio);
+			frustum.emplace(pos, rot, near, fov, ratio);
 		}
 		else if(projection_type == "ortho")
 		{
@@ -78,75 +144,61 @@ std::tuple<uint64_t, uint64_t> draw_world
 		// note that no frustum is set if projection_type is an invalid value,
 		// but the default projection type is used for rendering
 	}
-	if(frustum_ == nullptr)
-	{
-		frustum_ = std::make_unique<null_frustum<true>>();
-	}
 
 	const chunk_in_world chunk_pos(origin);
 	const chunk_in_world::value_type render_distance_ = static_cast<chunk_in_world::value_type>(render_distance);
-	const chunk_in_world min = chunk_pos - render_distance_;
-	const chunk_in_world max = chunk_pos + render_distance_;
 
-	const bool show_chunk_outlines = settings::get<bool>("show_chunk_outlines");
+	if(settings::get<bool>("show_chunk_outlines"))
+	{
+		draw_chunk_outlines(world, frustum, chunk_pos, camera_chunk, render_distance_);
+	}
+
+	const auto lod_distance = static_cast<uint64_t>(std::max(settings::get<int64_t>("lod_distance"), int64_t(0)));
 
-	std::vector<shared_ptr<Chunk>> drawn_chunks;
+	cull_list.update(world);
+	static const std::vector<plane> no_planes;
+	std::vector<std::size_t> inside;
+	cull_list.cull(frustum != nullopt ? frustum->get_planes() : no_planes, camera_chunk, inside);
 
-	chunk_in_world pos;
-	for(pos.x = min.x; pos.x <= max.x; ++pos.x)
-	for(pos.y = min.y; pos.y <= max.y; ++pos.y)
-	for(pos.z = min.z; pos.z <= max.z; ++pos.z)
+	draw_stats stats;
+	stats.meshed = static_cast<uint64_t>(cull_list.size());
+	stats.frustum_culled = stats.meshed - static_cast<uint64_t>(inside.size());
+
+	// loaded chunks past render distance are kept for a while (such as the ones loaded ahead of a moving player)
+	const auto past_render_distance = [&cull_list, &chunk_pos, render_distance_](const std::size_t i)
 	{
-		const chunk_in_world gpos(pos - camera_chunk);
-		const physics::AABB aabb(gpos);
-		if(!frustum_->inside(aabb))
-		{
-			continue;
-		}
+		return !world::view_sphere::contains(cull_list.get_position(i) - chunk_pos, render_distance_);
+	};
+	inside.erase(std::remove_if(inside.begin(), inside.end(), past_render_distance), inside.end());
 
-		shared_ptr<Chunk> chunk = world.get_chunk(pos);
+	if(settings::get<bool>("occlusion_culling"))
+	{
+		stats.occlusion_culled = static_cast<uint64_t>(cull_list.occlude(camera_chunk, render_distance_, inside));
+	}
 
-		if(show_chunk_outlines)
-		{
-			const glm::dvec3 min(static_cast<block_in_world::vec_type>(block_in_world(pos, {})));
-			const glm::dvec3 max(min + static_cast<double>(CHUNK_SIZE));
-			glm::dvec4 color(glm::uninitialize);
-			if(chunk == nullptr)
-			{
-				// not loaded = red
-				color = glm::dvec4(1, 0, 0, 1);
-			}
-			// TODO: add generating or loading = orange
-			else if(world.is_meshing_queued(chunk))
-			{
-				// meshing = yellow
-				color = glm::dvec4(1, 1, 0, 1);
-			}
-			else
-			{
-				// loaded = green
-				color = glm::dvec4(0, 1, 0, 1);
-			}
-			Gfx::instance->draw_box_outline(min, max, color);
-		}
-		if(chunk != nullptr)
+	std::vector<std::tuple<shared_ptr<Chunk>, uint8_t>> drawn_chunks;
+	for(const std::size_t i : inside)
+	{
+		const chunk_in_world offset = cull_list.get_position(i) - chunk_pos;
+		const shared_ptr<Chunk>& chunk = cull_list.get_chunk(i);
+		const auto distance = static_cast<uint64_t>(std::max({std::abs(offset.x), std::abs(offset.y), std::abs(offset.z)}));
+		const uint8_t lod_level = mesher::lod::level_for_distance(distance, lod_distance);
+		if(lod_level != 0)
 		{
-			// false = opaque pass. Only opaque blocks will be drawn.
-			chunk->render(false);
-			drawn_chunks.emplace_back(chunk);
+			world.request_lod_mesh(chunk, lod_level);
 		}
+
+		// false = opaque pass. Only opaque blocks will be drawn.
+		chunk->render(false, lod_level);
+		drawn_chunks.emplace_back(chunk, lod_level);
 	}
 
-	for(auto& chunk : drawn_chunks)
+	for(auto& [chunk, lod_level] : drawn_chunks)
 	{
 		// true = translucent pass. Only blocks with transparency will be drawn.
-		chunk->render(true);
+		chunk->render(true, lod_level);
 	}
 
-	uint64_t total = render_distance * 2 + 1;
-	total = total * total * total;
-	const uint64_t drawn = static_cast<uint64_t>(drawn_chunks.size());
-	return {total, drawn};
-}
-
+	stats.drawn = static_cast<uint64_t>(drawn_chunks.size());
+	return stats;
 }
@@ -1,22 +1,44 @@
 #pragma once
 
-#include <tuple>
+#include <stdint.h>
 
 #include <glm/mat4x4.hpp>
 
 #include "fwd/resource_manager.hpp"
 #include "fwd/graphics/camera.hpp"
+#include "fwd/graphics/chunk_cull_list.hpp"
 #include "fwd/position/block_in_world.hpp"
 #include "fwd/world/world.hpp"
 
 namespace block_thingy::graphics {
 
+struct draw_stats
+{
+	// the loaded chunks with a mesh, which are considered for drawing
+	uint64_t meshed = 0;
+	// outside of the view frustum
+	uint64_t frustum_culled = 0;
+	// inside of the view frustum, but hidden behind other chunks (see chunk_occlusion)
+	uint64_t occlusion_culled = 0;
+	uint64_t drawn = 0;
+
+	draw_stats& operator+=(const draw_stats& that)
+	{
+		meshed += that.meshed;
+		frustum_culled += that.frustum_culled;
+		occlusion_culled += that.occlusion_culled;
+		drawn += that.drawn;
+		return *this;
+	}
+};
+
 /**
- * @return The amount of chunks considered for drawing and the amount of chunks drawn
+ * The chunks that are meshed and not culled are neither outside of the frustum nor hidden, but past render distance
  */
-std::tuple<uint64_t, uint64_t> draw_world
+draw_stats draw_world
 (
 	world::world&,
+	chunk_cull_list&,
 	resource_manager&,
 	graphics::camera&,
 	const glm::dmat4& vp_matrix,
@@ -101,6 +101,23 @@ void Plugin::load_world(world::world& world)
 	load_world(world);
 }
 
+std::shared_ptr<world::generator> Plugin::make_generator(const string& name)
+{
+	if(pImpl == nullptr)
+	{
+		return nullptr;
+	}
+
+	void* make_generator_ptr = pImpl->get_symbol("bt_plugin_make_generator");
+	if(make_generator_ptr == nullptr)
+	{
+		return nullptr;
+	}
+
+	const auto make_generator = *reinterpret_cast<std::shared_ptr<world::generator>(*)(const string&)>(make_generator_ptr);
+	return make_generator(name);
+}
+
 Plugin::impl::impl(const fs::path& path)
 :
 	handle(nullptr),
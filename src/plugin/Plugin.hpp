@@ -1,10 +1,12 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "fwd/game.hpp"
 #include "shim/propagate_const.hpp"
 #include "util/filesystem.hpp"
+#include "fwd/world/generator.hpp"
 #include "fwd/world/world.hpp"
 
 namespace block_thingy {
@@ -40,6 +42,7 @@ private:
 
 	void init(game&);
 	void load_world(world::world&);
+	std::shared_ptr<world::generator> make_generator(const std::string& name);
 
 	struct impl;
 	std::propagate_const<std::unique_ptr<impl>> pImpl;
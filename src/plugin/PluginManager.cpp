@@ -8,6 +8,7 @@
 
 #include "plugin/Plugin.hpp"
 #include "util/filesystem.hpp"
+#include "util/logger.hpp"
 #include "util/misc.hpp"
 
 using std::string;
@@ -69,4 +70,18 @@ void PluginManager::plugin_load_world(world::world& world)
 	}
 }
 
+std::shared_ptr<world::generator> PluginManager::make_generator(const string& name)
+{
+	for(Plugin& plugin : pImpl->plugins)
+	{
+		if(auto gen = plugin.make_generator(name);
+			gen != nullptr)
+		{
+			LOG(INFO) << "using generator " << name << " from " << plugin.name() << '\n';
+			return gen;
+		}
+	}
+	return nullptr;
+}
+
 }
@@ -2,9 +2,11 @@
 
 #include <cassert>
 #include <memory>
+#include <string>
 
 #include "fwd/game.hpp"
 #include "shim/propagate_const.hpp"
+#include "fwd/world/generator.hpp"
 #include "fwd/world/world.hpp"
 
 namespace block_thingy {
@@ -23,6 +25,13 @@ public:
 	void plugin_init(game&);
 	void plugin_load_world(world::world&);
 
+	/*
+	 * The generator named name, from the first plugin whose bt_plugin_make_generator makes it
+	 * (a plugin returns nullptr for names that are not its own)
+	 * @return nullptr if no plugin has it
+	 */
+	std::shared_ptr<world::generator> make_generator(const std::string& name);
+
 	static PluginManager* instance;
 
 private:
@@ -3,6 +3,7 @@
 #include <functional>
 #include <stdint.h>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace block_thingy::position {
 
@@ -36,4 +37,7 @@ struct hasher_struct
 template<typename P, typename T>
 using unordered_map_t = std::unordered_map<P, T, hasher_struct<P>>;
 
+template<typename P>
+using unordered_set_t = std::unordered_set<P, hasher_struct<P>>;
+
 }
@@ -130,6 +130,10 @@ void load()
 {
 	settings =
 	{
+		{"chunk_compaction_interval_s", 30.0}, // how often changed chunks are saved, after which their changes are dropped from the journal
+		{"chunk_integration_budget_ms", 4.0}, // per tick; at least one chunk is integrated
+		{"chunk_order_look_weight", 0.5}, // 0 to 1; how much sooner chunks in front of the camera are loaded than chunks as near behind it
+		{"chunk_prefetch"		, true}, // load and generate chunks ahead of moving players
 		{"crosshair_color"		, glm::dvec4(1.0)},
 		{"crosshair_size"		, 32.0},
 		{"crosshair_thickness"	, 2.0},
@@ -149,10 +153,12 @@ void load()
 		{"joystick_sensitivity"	, 4.0},
 		{"language"				, "en"},
 		{"light_smoothing"		, 2},
+		{"lod_distance"			, 4}, // 0 = disabled
 		{"mesher"				, "simple2"},
 		{"mouse_sensitivity"	, 0.1},
 		{"min_light"			, 0.005},
 		{"near_plane"			, 0.1},
+		{"occlusion_culling"		, true},
 		{"ortho_size"			, 6.0},
 		{"projection_type"		, "default"},
 		{"render_distance"		, 1},
@@ -163,6 +169,7 @@ void load()
 		{"show_debug_info"		, false},
 		{"show_HUD"				, true},
 		{"wireframe"			, false},
+		{"world_generator"		, "terrain"}, // for new worlds; a plugin's generator, or the built-in terrain
 	};
 
 	Console::instance->run_line("exec settings");
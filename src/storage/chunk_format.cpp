@@ -0,0 +1,411 @@
+#include "chunk_format.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "block/block.hpp"
+#include "chunk/Chunk.hpp"
+#include "chunk/ChunkData.hpp"
+#include "graphics/color.hpp"
+#include "storage/chunk_image.hpp"
+
+using std::string;
+
+namespace block_thingy::storage::chunk_format {
+
+namespace {
+
+constexpr char MAGIC[4] = {'b', 't', 'c', 'k'};
+constexpr uint8_t VERSION = 1;
+constexpr std::size_t HEADER_SIZE = sizeof(MAGIC) + 1 + 1 + 2;
+
+enum class section_mode : uint8_t
+{
+	raw  = 0,
+	runs = 1,
+};
+
+[[noreturn]] void corrupt(const char* what)
+{
+	throw std::runtime_error(string("corrupt chunk: ") + what);
+}
+
+/*
+ * How each array element is written; value() is the same number msgpack saves, so the palette can be keyed by it
+ */
+template<typename T> struct element;
+
+template<>
+struct element<block_t>
+{
+	static constexpr std::size_t size = 4;
+
+	static uint32_t value(const block_t block)
+	{
+		return (static_cast<uint32_t>(block.index) << 8) | block.generation;
+	}
+
+	static block_t from_value(const uint32_t v)
+	{
+		return block_t(v >> 8, static_cast<uint8_t>(v & 0xFF));
+	}
+};
+
+template<>
+struct element<graphics::color>
+{
+	static constexpr std::size_t size = 3;
+
+	static uint32_t value(const graphics::color& c)
+	{
+		return static_cast<uint32_t>(c.r)
+			| (static_cast<uint32_t>(c.g) << 8)
+			| (static_cast<uint32_t>(c.b) << 16);
+	}
+
+	static graphics::color from_value(const uint32_t v)
+	{
+		return graphics::color
+		(
+			static_cast<uint8_t>(v & 0xFF),
+			static_cast<uint8_t>((v >> 8) & 0xFF),
+			static_cast<uint8_t>((v >> 16) & 0xFF)
+		);
+	}
+};
+
+void put_value(string& out, uint32_t v, const std::size_t size)
+{
+	for(std::size_t i = 0; i < size; ++i)
+	{
+		out.push_back(static_cast<char>(v & 0xFF));
+		v >>= 8;
+	}
+}
+
+void put_varint(string& out, uint32_t v)
+{
+	while(v >= 0x80)
+	{
+		out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+}
+
+class reader
+{
+public:
+	reader(const std::string_view bytes)
+	:
+		p(reinterpret_cast<const uint8_t*>(bytes.data())),
+		end(p + bytes.size())
+	{
+	}
+
+	uint8_t byte()
+	{
+		if(p == end)
+		{
+			corrupt("truncated");
+		}
+		return *p++;
+	}
+
+	uint32_t value(const std::size_t size)
+	{
+		if(static_cast<std::size_t>(end - p) < size)
+		{
+			corrupt("truncated value");
+		}
+		uint32_t v = 0;
+		for(std::size_t i = 0; i < size; ++i)
+		{
+			v |= static_cast<uint32_t>(p[i]) << (i * 8);
+		}
+		p += size;
+		return v;
+	}
+
+	uint32_t varint()
+	{
+		uint32_t v = 0;
+		for(unsigned shift = 0; shift < 35; shift += 7)
+		{
+			const uint8_t b = byte();
+			v |= static_cast<uint32_t>(b & 0x7F) << shift;
+			if((b & 0x80) == 0)
+			{
+				return v;
+			}
+		}
+		corrupt("varint too long");
+	}
+
+	const uint8_t* take(const std::size_t size)
+	{
+		if(static_cast<std::size_t>(end - p) < size)
+		{
+			corrupt("truncated section");
+		}
+		const uint8_t* start = p;
+		p += size;
+		return start;
+	}
+
+	bool done() const
+	{
+		return p == end;
+	}
+
+private:
+	const uint8_t* p;
+	const uint8_t* const end;
+};
+
+template<typename T>
+void write_section(string& out, const typename chunk_data<T>::array_t& array)
+{
+	using E = element<T>;
+
+	std::vector<uint32_t> palette;
+	std::unordered_map<uint32_t, uint32_t> palette_index;
+	string runs;
+	std::size_t i = 0;
+	while(i < array.size())
+	{
+		const uint32_t v = E::value(array[i]);
+		std::size_t length = 1;
+		while(i + length < array.size() && E::value(array[i + length]) == v)
+		{
+			++length;
+		}
+		const auto p = palette_index.emplace(v, static_cast<uint32_t>(palette.size()));
+		if(p.second)
+		{
+			palette.emplace_back(v);
+		}
+		put_varint(runs, static_cast<uint32_t>(length));
+		put_varint(runs, p.first->second);
+		i += length;
+	}
+
+	string palette_bytes;
+	put_varint(palette_bytes, static_cast<uint32_t>(palette.size()));
+	for(const uint32_t v : palette)
+	{
+		put_value(palette_bytes, v, E::size);
+	}
+
+	if(palette_bytes.size() + runs.size() < array.size() * E::size)
+	{
+		out.push_back(static_cast<char>(section_mode::runs));
+		out += palette_bytes;
+		out += runs;
+	}
+	else
+	{
+		out.push_back(static_cast<char>(section_mode::raw));
+		for(const T& t : array)
+		{
+			put_value(out, E::value(t), E::size);
+		}
+	}
+}
+
+template<typename T>
+std::shared_ptr<typename chunk_data<T>::array_t> read_section(reader& r)
+{
+	using E = element<T>;
+	auto array = std::make_shared<typename chunk_data<T>::array_t>();
+
+	const auto mode = static_cast<section_mode>(r.byte());
+	switch(mode)
+	{
+		case section_mode::raw:
+		{
+			const uint8_t* p = r.take(array->size() * E::size);
+			for(T& t : *array)
+			{
+				uint32_t v = 0;
+				for(std::size_t i = 0; i < E::size; ++i)
+				{
+					v |= static_cast<uint32_t>(p[i]) << (i * 8);
+				}
+				t = E::from_value(v);
+				p += E::size;
+			}
+			return array;
+		}
+		case section_mode::runs:
+		{
+			const uint32_t palette_size = r.varint();
+			if(palette_size == 0 || palette_size > array->size())
+			{
+				corrupt("bad palette size");
+			}
+			std::vector<T> palette;
+			palette.reserve(palette_size);
+			for(uint32_t i = 0; i < palette_size; ++i)
+			{
+				palette.emplace_back(E::from_value(r.value(E::size)));
+			}
+
+			std::size_t i = 0;
+			while(i < array->size())
+			{
+				const uint32_t length = r.varint();
+				const uint32_t index = r.varint();
+				if(length == 0 || length > array->size() - i)
+				{
+					corrupt("run out of range");
+				}
+				if(index >= palette.size())
+				{
+					corrupt("palette index out of range");
+				}
+				std::fill_n(array->data() + i, length, palette[index]);
+				i += length;
+			}
+			return array;
+		}
+	}
+	corrupt("unknown section mode");
+}
+
+}
+
+string write(const chunk_image& image, const bool with_light)
+{
+	uint8_t f = 0;
+	if(!with_light)
+	{
+		f |= flags::no_light;
+	}
+	else
+	{
+		if(image.light_stamp != 0)
+		{
+			f |= flags::light_stamp;
+		}
+		if(image.light_costly)
+		{
+			f |= flags::light_costly;
+		}
+	}
+
+	string out;
+	out.reserve(4096);
+	out.append(MAGIC, sizeof(MAGIC));
+	out.push_back(static_cast<char>(VERSION));
+	out.push_back(static_cast<char>(f));
+	put_value(out, static_cast<uint32_t>(CHUNK_SIZE), 2);
+	if(f & flags::light_stamp)
+	{
+		put_value(out, image.light_stamp, 4);
+	}
+	write_section<block_t>(out, *image.blocks);
+	if(with_light)
+	{
+		write_section<graphics::color>(out, *image.blocklight);
+		write_section<graphics::color>(out, *image.skylight);
+	}
+	return out;
+}
+
+bool is_binary(const std::string_view bytes)
+{
+	return bytes.size() >= HEADER_SIZE
+		&& std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+namespace {
+
+struct decoded
+{
+	std::shared_ptr<chunk_blocks_t::array_t> blocks;
+	std::shared_ptr<chunk_data<graphics::color>::array_t> blocklight;
+	std::shared_ptr<chunk_data<graphics::color>::array_t> skylight;
+	uint32_t light_stamp;
+	bool light_costly;
+	bool has_light;
+};
+
+decoded read_arrays(const std::string_view bytes)
+{
+	if(!is_binary(bytes))
+	{
+		corrupt("not a binary chunk");
+	}
+	reader r(bytes);
+	r.take(sizeof(MAGIC));
+	const uint8_t version = r.byte();
+	if(version != VERSION)
+	{
+		throw std::runtime_error("unknown chunk format version " + std::to_string(version));
+	}
+	const uint8_t f = r.byte();
+	if((f & ~flags::all) != 0)
+	{
+		corrupt("unknown flags");
+	}
+	decoded d;
+	d.has_light = (f & flags::no_light) == 0;
+	if(!d.has_light && (f & (flags::light_stamp | flags::light_costly)) != 0)
+	{
+		corrupt("light flags without light");
+	}
+	if(r.value(2) != static_cast<uint32_t>(CHUNK_SIZE))
+	{
+		throw std::runtime_error("chunk size is not " + std::to_string(CHUNK_SIZE));
+	}
+	d.light_stamp = (f & flags::light_stamp) ? r.value(4) : 0;
+	d.light_costly = (f & flags::light_costly) != 0;
+
+	d.blocks = read_section<block_t>(r);
+	if(d.has_light)
+	{
+		d.blocklight = read_section<graphics::color>(r);
+		d.skylight = read_section<graphics::color>(r);
+	}
+	else
+	{
+		// colors start at 0, so dark
+		d.blocklight = std::make_shared<chunk_data<graphics::color>::array_t>();
+		d.skylight = std::make_shared<chunk_data<graphics::color>::array_t>();
+	}
+	if(!r.done())
+	{
+		corrupt("trailing bytes");
+	}
+	return d;
+}
+
+}
+
+bool read(const std::string_view bytes, Chunk& chunk)
+{
+	decoded d = read_arrays(bytes);
+	chunk.set_data(std::move(d.blocks), std::move(d.blocklight), std::move(d.skylight));
+	chunk.set_light_stamp(d.light_stamp);
+	chunk.set_light_costly(d.light_costly);
+	return d.has_light;
+}
+
+bool read(const std::string_view bytes, chunk_image& image)
+{
+	decoded d = read_arrays(bytes);
+	image.blocks = std::move(d.blocks);
+	image.blocklight = std::move(d.blocklight);
+	image.skylight = std::move(d.skylight);
+	image.light_stamp = d.light_stamp;
+	image.light_costly = d.light_costly;
+	return d.has_light;
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "fwd/storage/chunk_image.hpp"
+
+namespace block_thingy::storage::chunk_format {
+
+/*
+ * The binary chunk format:
+ *   the magic "btck", a version byte, a flags byte, and CHUNK_SIZE as 2 bytes
+ *   if the light_stamp flag is set, the light stamp as 4 bytes
+ *   the blocks, the blocklight, and the skylight, each as a section (without the light sections if the no_light flag is set)
+ * A section is a mode byte and then either:
+ *   raw: every value in array order
+ *   runs: a palette (a varint count and the values) and then (varint length, varint palette index) runs until the array is full
+ * Blocks are 4 bytes ((index << 8) | generation, like in msgpack) and colors are 3 bytes (r, g, b); all numbers are little-endian
+ * The section mode is whichever is smaller, so a noisy chunk costs at most 1 byte more than raw
+ */
+std::string write(const chunk_image&, bool with_light = true);
+
+/*
+ * @return true if the bytes are in this format (if not, they are the msgpack format chunks were saved in before this)
+ */
+bool is_binary(std::string_view bytes);
+
+/*
+ * Decodes straight into new arrays (ARRAY_COUNT allocations) and gives them to the chunk, with its light stamp
+ * Throws std::runtime_error if the bytes are corrupt
+ *
+ * @return false if the light was not saved (the chunk is left dark, to be lit)
+ */
+bool read(std::string_view bytes, Chunk&);
+
+/*
+ * Like read, but into an image, for tools that do not have a world to make a Chunk in (the position is not set)
+ */
+bool read(std::string_view bytes, chunk_image&);
+
+// the blocks, the blocklight, and the skylight
+constexpr std::size_t ARRAY_COUNT = 3;
+
+namespace flags {
+	// the blocklight and skylight sections are left out
+	constexpr uint8_t no_light = 1 << 0;
+	// the light stamp follows the header
+	constexpr uint8_t light_stamp = 1 << 1;
+	// the light was kept because it is costly to make (see Chunk::is_light_costly)
+	constexpr uint8_t light_costly = 1 << 2;
+
+	constexpr uint8_t all = no_light | light_stamp | light_costly;
+}
+
+}
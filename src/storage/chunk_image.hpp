@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+
+#include "chunk/Chunk.hpp"
+#include "chunk/ChunkData.hpp"
+#include "graphics/color.hpp"
+#include "position/chunk_in_world.hpp"
+
+namespace block_thingy::storage {
+
+/*
+ * The saved part of a chunk at one point in time (see Chunk::snapshot)
+ * It shares the arrays with the chunk until the chunk changes, so it is cheap to make and can be written from any thread
+ */
+struct chunk_image
+{
+	position::chunk_in_world position;
+	std::shared_ptr<const chunk_blocks_t::array_t> blocks;
+	std::shared_ptr<const chunk_data<graphics::color>::array_t> blocklight;
+	std::shared_ptr<const chunk_data<graphics::color>::array_t> skylight;
+	// see Chunk::get_light_stamp and Chunk::is_light_costly
+	uint32_t light_stamp = 0;
+	bool light_costly = false;
+};
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace block_thingy::storage {
+
+/*
+ * What loading chunks has cost so far (see world_file::load_chunk)
+ */
+struct chunk_load_stats
+{
+	uint64_t loaded;
+	// heap allocations and bytes copied on the way from the file to the chunk's arrays (not counting the Chunk itself)
+	uint64_t allocations;
+	uint64_t bytes_copied;
+};
+
+}
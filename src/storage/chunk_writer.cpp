@@ -0,0 +1,284 @@
+#include "chunk_writer.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <utility>
+
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/world_file.hpp"
+#include "util/logger.hpp"
+#include "util/ThreadThingy.hpp"
+#include "util/thread_pool.hpp"
+
+namespace block_thingy::storage {
+
+using position::chunk_in_world;
+
+struct chunk_writer::impl
+{
+	impl
+	(
+		world_file& file,
+		util::thread_pool& pool,
+		const std::size_t max_pending
+	)
+	:
+		file(file),
+		max_pending(max_pending),
+		writing(0),
+		next_ticket(1),
+		written(0),
+		coalesced(0),
+		write_thread([this](const chunk_in_world& pos)
+		{
+			write(pos);
+		}, pool, position::hasher<chunk_in_world>)
+	{
+	}
+
+	impl(impl&&) = delete;
+	impl(const impl&) = delete;
+	impl& operator=(impl&&) = delete;
+	impl& operator=(const impl&) = delete;
+
+	world_file& file;
+	const std::size_t max_pending;
+
+	struct ticketed_image
+	{
+		chunk_image image;
+		uint64_t ticket;
+	};
+	// the newest snapshot of each chunk that is waiting to be written
+	position::unordered_map_t<chunk_in_world, ticketed_image> queued;
+	std::size_t writing;
+	uint64_t next_ticket;
+	// the tickets of the snapshots that are queued or being written
+	std::set<uint64_t> unwritten;
+	// the ticket of the newest snapshot of each chunk that was saved without an error
+	position::unordered_map_t<chunk_in_world, uint64_t> saved_tickets;
+	uint64_t written;
+	uint64_t coalesced;
+	mutable std::mutex mutex;
+	// notified when a write finishes
+	std::condition_variable written_cv;
+
+	std::size_t pending() const
+	{
+		return queued.size() + writing;
+	}
+
+	// call with mutex locked
+	void enqueue(chunk_image&);
+
+	void write(const chunk_in_world&);
+
+	// declared last, so it is stopped before the things its jobs use are destroyed
+	util::ThreadThingy<chunk_in_world, position::hasher_t<chunk_in_world>> write_thread;
+};
+
+chunk_writer::chunk_writer
+(
+	world_file& file,
+	util::thread_pool& pool,
+	const std::size_t max_pending
+)
+:
+	pImpl(std::make_unique<impl>(file, pool, max_pending))
+{
+}
+
+chunk_writer::~chunk_writer()
+{
+	flush();
+	pImpl->write_thread.stop();
+}
+
+void chunk_writer::save(chunk_image image)
+{
+	const chunk_in_world pos = image.position;
+	{
+		std::unique_lock<std::mutex> lock(pImpl->mutex);
+		pImpl->written_cv.wait(lock, [this, &pos]()
+		{
+			return pImpl->pending() < pImpl->max_pending
+				|| pImpl->queued.count(pos) != 0;
+		});
+		pImpl->enqueue(image);
+	}
+	pImpl->write_thread.enqueue(pos);
+}
+
+bool chunk_writer::try_save(chunk_image image)
+{
+	const chunk_in_world pos = image.position;
+	{
+		std::lock_guard<std::mutex> g(pImpl->mutex);
+		// replacing a queued snapshot does not make the queue longer
+		if(pImpl->pending() >= pImpl->max_pending
+		&& pImpl->queued.count(pos) == 0)
+		{
+			return false;
+		}
+		pImpl->enqueue(image);
+	}
+	pImpl->write_thread.enqueue(pos);
+	return true;
+}
+
+void chunk_writer::flush(const progress_t& progress)
+{
+	std::unique_lock<std::mutex> lock(pImpl->mutex);
+	const uint64_t written_start = pImpl->written;
+	auto report = [this, &progress, written_start]()
+	{
+		if(progress != nullptr)
+		{
+			const std::size_t written = static_cast<std::size_t>(pImpl->written - written_start);
+			progress(written, written + pImpl->pending());
+		}
+	};
+	while(pImpl->pending() != 0)
+	{
+		report();
+		pImpl->written_cv.wait_for(lock, std::chrono::milliseconds(250));
+	}
+	report();
+}
+
+uint64_t chunk_writer::last_ticket() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->next_ticket - 1;
+}
+
+bool chunk_writer::written_through(const uint64_t ticket) const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->unwritten.empty() || *pImpl->unwritten.cbegin() > ticket;
+}
+
+bool chunk_writer::saved_since(const chunk_in_world& pos, const uint64_t ticket) const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	const auto i = pImpl->saved_tickets.find(pos);
+	return i != pImpl->saved_tickets.cend() && i->second > ticket;
+}
+
+void chunk_writer::forget_saved_through(const uint64_t ticket)
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	for(auto i = pImpl->saved_tickets.begin(); i != pImpl->saved_tickets.end();)
+	{
+		if(i->second <= ticket)
+		{
+			i = pImpl->saved_tickets.erase(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+std::size_t chunk_writer::pending_count() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->pending();
+}
+
+uint64_t chunk_writer::written_count() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->written;
+}
+
+uint64_t chunk_writer::coalesced_count() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->coalesced;
+}
+
+void chunk_writer::impl::enqueue(chunk_image& image)
+{
+	const chunk_in_world pos = image.position;
+	const uint64_t ticket = next_ticket++;
+	unwritten.emplace(ticket);
+	const auto i = queued.find(pos);
+	if(i == queued.cend())
+	{
+		queued.emplace(pos, ticketed_image{std::move(image), ticket});
+	}
+	else
+	{
+		unwritten.erase(i->second.ticket);
+		i->second = {std::move(image), ticket};
+		++coalesced;
+	}
+}
+
+void chunk_writer::impl::write(const chunk_in_world& pos)
+{
+	// a snapshot queued while this one is written is written by this job too
+	while(true)
+	{
+		std::optional<chunk_image> image;
+		uint64_t ticket;
+		{
+			std::lock_guard<std::mutex> g(mutex);
+			const auto i = queued.find(pos);
+			if(i == queued.cend())
+			{
+				break;
+			}
+			image = std::move(i->second.image);
+			ticket = i->second.ticket;
+			queued.erase(i);
+			++writing;
+		}
+
+		bool saved = false;
+		try
+		{
+			file.save_chunk(*image);
+			saved = true;
+		}
+		catch(const std::exception& e)
+		{
+			LOG(ERROR) << "error saving chunk " << pos << ": " << e.what() << '\n';
+		}
+
+		{
+			std::lock_guard<std::mutex> g(mutex);
+			--writing;
+			++written;
+			unwritten.erase(ticket);
+			if(saved)
+			{
+				saved_tickets.insert_or_assign(pos, ticket);
+			}
+		}
+		written_cv.notify_all();
+	}
+
+	write_thread.dequeue(pos);
+
+	// queued between the last check and dequeue, when enqueueing it would have been a no-op
+	bool requeue;
+	{
+		std::lock_guard<std::mutex> g(mutex);
+		requeue = queued.count(pos) != 0;
+	}
+	if(requeue)
+	{
+		write_thread.enqueue(pos);
+	}
+}
+
+}
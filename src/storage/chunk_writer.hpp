@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+
+#include "fwd/position/chunk_in_world.hpp"
+#include "fwd/storage/chunk_image.hpp"
+#include "fwd/storage/world_file.hpp"
+#include "fwd/util/thread_pool.hpp"
+#include "shim/propagate_const.hpp"
+
+namespace block_thingy::storage {
+
+/*
+ * Compresses and writes chunk snapshots on a thread pool
+ * Saving a chunk that is already queued replaces the queued snapshot, so a chunk that keeps changing is written once per write instead of once per change
+ * Each position is written by one worker at a time
+ */
+class chunk_writer
+{
+public:
+	/*
+	 * max_pending: how many chunks can be queued (or being written) before try_save refuses and save waits
+	 */
+	chunk_writer(world_file&, util::thread_pool&, std::size_t max_pending);
+
+	/*
+	 * Writes everything that is queued
+	 */
+	~chunk_writer();
+
+	chunk_writer(chunk_writer&&) = delete;
+	chunk_writer(const chunk_writer&) = delete;
+	chunk_writer& operator=(chunk_writer&&) = delete;
+	chunk_writer& operator=(const chunk_writer&) = delete;
+
+	/*
+	 * Waits while the queue is full
+	 */
+	void save(chunk_image);
+
+	/*
+	 * @return false if the queue is full (the snapshot is not queued)
+	 */
+	bool try_save(chunk_image);
+
+	/*
+	 * Wait until everything that is queued has been written
+	 * progress is called with the amount written since flush was called and the total to write, every so often and at the end
+	 */
+	using progress_t = std::function<void(std::size_t written, std::size_t total)>;
+	void flush(const progress_t& progress = nullptr);
+
+	/*
+	 * Each queued snapshot gets a ticket, one more than the last
+	 * @return The ticket of the last snapshot queued (0 if none has been)
+	 */
+	uint64_t last_ticket() const;
+
+	/*
+	 * @return true if every snapshot queued up to and including ticket has been written or replaced by a newer one
+	 */
+	bool written_through(uint64_t ticket) const;
+
+	/*
+	 * @return true if a snapshot of the chunk queued after ticket was saved without an error
+	 * The save is durable only after world_file::sync_chunks
+	 */
+	bool saved_since(const position::chunk_in_world&, uint64_t ticket) const;
+
+	/*
+	 * Forget the saves of the snapshots queued up to and including ticket, once saved_since will not be asked about them
+	 * Without this, the writer remembers a ticket for every chunk it has saved
+	 */
+	void forget_saved_through(uint64_t ticket);
+
+	/*
+	 * Queued or being written
+	 */
+	std::size_t pending_count() const;
+
+	uint64_t written_count() const;
+
+	/*
+	 * How many snapshots replaced a queued one
+	 */
+	uint64_t coalesced_count() const;
+
+private:
+	struct impl;
+	std::propagate_const<std::unique_ptr<impl>> pImpl;
+};
+
+}
@@ -0,0 +1,397 @@
+#include "codec.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include <zlib.h>
+#include <zstr/zstr.hpp>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "util/copy_stream.hpp"
+
+using std::string;
+
+namespace block_thingy::storage {
+
+std::ostream& operator<<(std::ostream& o, const codec c)
+{
+	switch(c)
+	{
+		case codec::none   : return o << "none";
+		case codec::deflate: return o << "deflate";
+		case codec::lz     : return o << "lz";
+	}
+	assert(false);
+	// to satisfy -Werror
+	const auto i = static_cast<std::underlying_type_t<codec>>(c);
+	return o << "ERROR(" << std::to_string(i) << ')';
+}
+
+std::optional<codec> codec_from_name(const string& name)
+{
+	if(name == "none"   ) return codec::none;
+	if(name == "deflate") return codec::deflate;
+	if(name == "lz"     ) return codec::lz;
+	return std::nullopt;
+}
+
+namespace {
+
+constexpr std::size_t HEADER_SIZE = 1 + 4;
+
+/*
+ * The most bytes a stored chunk can decode to, so that a corrupt size is not allocated
+ * The biggest chunks are in the msgpack format from before chunk_format: an array of 3 arrays (5-byte headers), with
+ * each block as a 5-byte uint and each color as an array of 3 2-byte uints
+ */
+constexpr std::size_t MAX_DECODED_SIZE = 1 + 3 * 5 + static_cast<std::size_t>(CHUNK_BLOCK_COUNT) * (5 + 2 * (1 + 3 * 2));
+
+/*
+ * The LZ format is a list of sequences. Each sequence is:
+ *   a token byte: the literal length in the high 4 bits and the match length - MIN_MATCH in the low 4 bits
+ *     (a length of 15 continues in the next bytes: each 255 adds 255 and the first byte under 255 ends it)
+ *   the literal bytes
+ *   the match offset (2 bytes, little-endian), counting back from the end of the output
+ *   the rest of the match length
+ * The last sequence has only literals, and it ends the input.
+ */
+constexpr std::size_t MIN_MATCH = 4;
+// the last bytes are always literals, so reading 4 bytes to look for a match never goes past the end
+constexpr std::size_t LAST_LITERALS = 5;
+constexpr std::size_t MAX_OFFSET = 65535;
+constexpr unsigned HASH_BITS = 14;
+
+uint32_t read32(const uint8_t* p)
+{
+	uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+void write_length(string& out, std::size_t length)
+{
+	while(length >= 255)
+	{
+		out.push_back(static_cast<char>(255));
+		length -= 255;
+	}
+	out.push_back(static_cast<char>(length));
+}
+
+void write_sequence
+(
+	string& out,
+	const uint8_t* literals,
+	const std::size_t literal_length,
+	const std::size_t offset,
+	const std::size_t match_length
+)
+{
+	const std::size_t l = literal_length < 15 ? literal_length : 15;
+	const std::size_t m = match_length == 0 ? 0 : (match_length - MIN_MATCH < 15 ? match_length - MIN_MATCH : 15);
+	out.push_back(static_cast<char>((l << 4) | m));
+	if(l == 15)
+	{
+		write_length(out, literal_length - 15);
+	}
+	out.append(reinterpret_cast<const char*>(literals), literal_length);
+	if(match_length == 0)
+	{
+		return;
+	}
+	out.push_back(static_cast<char>(offset & 0xFF));
+	out.push_back(static_cast<char>(offset >> 8));
+	if(m == 15)
+	{
+		write_length(out, match_length - MIN_MATCH - 15);
+	}
+}
+
+void lz_compress(const string& in, string& out)
+{
+	const auto base = reinterpret_cast<const uint8_t*>(in.data());
+	const std::size_t size = in.size();
+	// the position + 1 of the last place each hash was seen (0 = not seen)
+	std::vector<uint32_t> table(std::size_t(1) << HASH_BITS, 0);
+
+	std::size_t anchor = 0;
+	std::size_t i = 0;
+	const std::size_t limit = size > LAST_LITERALS ? size - LAST_LITERALS : 0;
+	while(i + MIN_MATCH <= limit)
+	{
+		const uint32_t sequence = read32(base + i);
+		const uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+		const uint32_t candidate = table[hash];
+		table[hash] = static_cast<uint32_t>(i + 1);
+		if(candidate != 0)
+		{
+			const std::size_t match = candidate - 1;
+			if(i - match <= MAX_OFFSET && read32(base + match) == sequence)
+			{
+				std::size_t length = MIN_MATCH;
+				while(i + length < limit && base[match + length] == base[i + length])
+				{
+					++length;
+				}
+				write_sequence(out, base + anchor, i - anchor, i - match, length);
+				i += length;
+				anchor = i;
+				continue;
+			}
+		}
+		++i;
+	}
+	write_sequence(out, base + anchor, size - anchor, 0, 0);
+}
+
+[[noreturn]] void corrupt(const char* what)
+{
+	throw std::runtime_error(string("corrupt lz data: ") + what);
+}
+
+void lz_decompress(const uint8_t* in, const std::size_t in_size, string& out)
+{
+	const uint8_t* const in_end = in + in_size;
+	std::size_t op = 0;
+	auto read_length = [&in, in_end](std::size_t length) -> std::size_t
+	{
+		uint8_t b;
+		do
+		{
+			if(in == in_end)
+			{
+				corrupt("truncated length");
+			}
+			b = *in++;
+			length += b;
+		}
+		while(b == 255);
+		return length;
+	};
+
+	while(true)
+	{
+		if(in == in_end)
+		{
+			corrupt("missing token");
+		}
+		const uint8_t token = *in++;
+
+		std::size_t literal_length = token >> 4;
+		if(literal_length == 15)
+		{
+			literal_length = read_length(literal_length);
+		}
+		if(literal_length > static_cast<std::size_t>(in_end - in)
+		|| literal_length > out.size() - op)
+		{
+			corrupt("literals out of range");
+		}
+		std::memcpy(&out[op], in, literal_length);
+		in += literal_length;
+		op += literal_length;
+
+		if(in == in_end)
+		{
+			break;
+		}
+
+		if(in_end - in < 2)
+		{
+			corrupt("truncated offset");
+		}
+		const std::size_t offset = static_cast<std::size_t>(in[0]) | (static_cast<std::size_t>(in[1]) << 8);
+		in += 2;
+		if(offset == 0 || offset > op)
+		{
+			corrupt("offset out of range");
+		}
+
+		std::size_t match_length = token & 15;
+		if(match_length == 15)
+		{
+			match_length = read_length(match_length);
+		}
+		match_length += MIN_MATCH;
+		if(match_length > out.size() - op)
+		{
+			corrupt("match out of range");
+		}
+
+		// a match longer than its offset overlaps the bytes it makes (a repeating pattern), so it is copied offset bytes at a time
+		while(match_length > 0)
+		{
+			const std::size_t n = match_length < offset ? match_length : offset;
+			std::memcpy(&out[op], &out[op - offset], n);
+			op += n;
+			match_length -= n;
+		}
+	}
+
+	if(op != out.size())
+	{
+		corrupt("wrong size");
+	}
+}
+
+bool is_gzip(const std::string_view stored)
+{
+	return stored.size() >= 2
+		&& static_cast<uint8_t>(stored[0]) == 0x1F
+		&& static_cast<uint8_t>(stored[1]) == 0x8B;
+}
+
+}
+
+string encode(const codec c, const string& bytes)
+{
+	if(bytes.size() > UINT32_MAX)
+	{
+		throw std::invalid_argument("storage::encode: too big: " + std::to_string(bytes.size()));
+	}
+	const auto size = static_cast<uint32_t>(bytes.size());
+
+	string out;
+	out.reserve(HEADER_SIZE + bytes.size() / 2);
+	out.push_back(static_cast<char>(c));
+	for(unsigned i = 0; i < 4; ++i)
+	{
+		out.push_back(static_cast<char>((size >> (i * 8)) & 0xFF));
+	}
+
+	switch(c)
+	{
+		case codec::none:
+		{
+			out += bytes;
+			break;
+		}
+		case codec::deflate:
+		{
+			uLongf compressed_size = compressBound(static_cast<uLong>(bytes.size()));
+			out.resize(HEADER_SIZE + compressed_size);
+			const int result = compress2
+			(
+				reinterpret_cast<Bytef*>(&out[HEADER_SIZE]),
+				&compressed_size,
+				reinterpret_cast<const Bytef*>(bytes.data()),
+				static_cast<uLong>(bytes.size()),
+				Z_BEST_COMPRESSION
+			);
+			if(result != Z_OK)
+			{
+				throw std::runtime_error("zlib compress2 failed: " + std::to_string(result));
+			}
+			out.resize(HEADER_SIZE + compressed_size);
+			break;
+		}
+		case codec::lz:
+		{
+			lz_compress(bytes, out);
+			break;
+		}
+	}
+	return out;
+}
+
+string decode(const string& stored)
+{
+	string buffer;
+	const std::string_view bytes = decode(stored, buffer);
+	if(bytes.data() != buffer.data())
+	{
+		buffer.assign(bytes.data(), bytes.size());
+	}
+	return buffer;
+}
+
+std::optional<codec> stored_codec(const std::string_view stored)
+{
+	if(is_gzip(stored))
+	{
+		return std::nullopt;
+	}
+	if(stored.empty())
+	{
+		throw std::runtime_error("stored chunk is too short");
+	}
+	const auto c = static_cast<codec>(stored[0]);
+	switch(c)
+	{
+		case codec::none:
+		case codec::deflate:
+		case codec::lz:
+			return c;
+	}
+	throw std::runtime_error("unknown codec: " + std::to_string(static_cast<uint8_t>(stored[0])));
+}
+
+std::string_view decode(const std::string_view stored, string& buffer)
+{
+	if(is_gzip(stored))
+	{
+		std::istringstream ss(string(stored), std::ios::binary);
+		zstr::istream stream(ss);
+		buffer = util::read_stream(stream);
+		return buffer;
+	}
+
+	if(stored.size() < HEADER_SIZE)
+	{
+		throw std::runtime_error("stored chunk is too short");
+	}
+	const auto p = reinterpret_cast<const uint8_t*>(stored.data());
+	const uint32_t size = static_cast<uint32_t>(p[1])
+		| (static_cast<uint32_t>(p[2]) << 8)
+		| (static_cast<uint32_t>(p[3]) << 16)
+		| (static_cast<uint32_t>(p[4]) << 24);
+	if(size > MAX_DECODED_SIZE)
+	{
+		throw std::runtime_error("stored chunk is too big: " + std::to_string(size) + " bytes");
+	}
+	const uint8_t* data = p + HEADER_SIZE;
+	const std::size_t data_size = stored.size() - HEADER_SIZE;
+
+	switch(static_cast<codec>(p[0]))
+	{
+		case codec::none:
+		{
+			if(data_size != size)
+			{
+				throw std::runtime_error("stored chunk has the wrong size");
+			}
+			return std::string_view(reinterpret_cast<const char*>(data), size);
+		}
+		case codec::deflate:
+		{
+			buffer.resize(size);
+			uLongf out_size = size;
+			const int result = uncompress
+			(
+				reinterpret_cast<Bytef*>(buffer.data()),
+				&out_size,
+				data,
+				static_cast<uLong>(data_size)
+			);
+			if(result != Z_OK || out_size != size)
+			{
+				throw std::runtime_error("zlib uncompress failed: " + std::to_string(result));
+			}
+			return buffer;
+		}
+		case codec::lz:
+		{
+			buffer.resize(size);
+			lz_decompress(data, data_size, buffer);
+			return buffer;
+		}
+	}
+	throw std::runtime_error("unknown codec: " + std::to_string(p[0]));
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <iosfwd>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+namespace block_thingy::storage {
+
+/*
+ * How saved chunks are compressed
+ * The value is the tag byte at the start of the stored bytes, so each chunk can use a different codec
+ */
+enum class codec : uint8_t
+{
+	none    = 0,
+	// zlib at its best compression level; small, but slow to save
+	deflate = 1,
+	// byte-oriented LZ77 in the style of LZ4; much faster to save and load, but bigger
+	lz      = 2,
+};
+std::ostream& operator<<(std::ostream&, codec);
+
+std::optional<codec> codec_from_name(const std::string&);
+
+/*
+ * @return The tag, the uncompressed size, and the compressed bytes
+ */
+std::string encode(codec, const std::string& bytes);
+
+/*
+ * Also decodes the untagged gzip that chunks were saved as before codecs
+ * Throws std::runtime_error if the bytes are corrupt
+ */
+std::string decode(const std::string& stored);
+
+/*
+ * The codec that stored bytes were encoded with (nullopt for the untagged gzip from before codecs)
+ * Throws std::runtime_error if the tag is not a codec
+ */
+std::optional<codec> stored_codec(std::string_view stored);
+
+/*
+ * Like decode, but reuses buffer's memory instead of making a new string
+ * @return The decoded bytes, which are in buffer, or in stored for codec::none (so nothing is copied)
+ */
+std::string_view decode(std::string_view stored, std::string& buffer);
+
+}
@@ -0,0 +1,486 @@
+#include "edit_journal.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <zlib.h>
+
+#include "chunk/Chunk.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "util/logger.hpp"
+#include "util/positional_file.hpp"
+
+using std::string;
+
+namespace block_thingy::storage {
+
+using position::block_in_world;
+using position::chunk_in_world;
+
+namespace {
+
+constexpr char MAGIC[8] = {'b', 't', 'j', 'o', 'u', 'r', 'n', 'l'};
+constexpr uint32_t VERSION = 1;
+constexpr std::size_t HEADER_SIZE = sizeof(MAGIC) + 4;
+constexpr std::size_t BATCH_HEADER_SIZE = 4 + 4;
+constexpr std::size_t RECORD_SIZE = 8 + 3 * 8 + 4;
+
+struct record
+{
+	uint64_t sequence;
+	block_in_world pos;
+	block_t block;
+};
+
+void put_u32(string& out, const uint32_t v)
+{
+	for(unsigned i = 0; i < 4; ++i)
+	{
+		out.push_back(static_cast<char>((v >> (i * 8)) & 0xFF));
+	}
+}
+
+void put_u64(string& out, const uint64_t v)
+{
+	for(unsigned i = 0; i < 8; ++i)
+	{
+		out.push_back(static_cast<char>((v >> (i * 8)) & 0xFF));
+	}
+}
+
+uint32_t get_u32(const char* p)
+{
+	uint32_t v = 0;
+	for(unsigned i = 0; i < 4; ++i)
+	{
+		v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (i * 8);
+	}
+	return v;
+}
+
+uint64_t get_u64(const char* p)
+{
+	uint64_t v = 0;
+	for(unsigned i = 0; i < 8; ++i)
+	{
+		v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (i * 8);
+	}
+	return v;
+}
+
+string header()
+{
+	string out(MAGIC, sizeof(MAGIC));
+	put_u32(out, VERSION);
+	return out;
+}
+
+template<typename Iterator>
+string encode_batch(Iterator begin, const Iterator end)
+{
+	string records;
+	uint32_t count = 0;
+	for(; begin != end; ++begin)
+	{
+		const record& r = *begin;
+		put_u64(records, r.sequence);
+		put_u64(records, static_cast<uint64_t>(r.pos.x));
+		put_u64(records, static_cast<uint64_t>(r.pos.y));
+		put_u64(records, static_cast<uint64_t>(r.pos.z));
+		put_u32(records, (static_cast<uint32_t>(r.block.index) << 8) | r.block.generation);
+		++count;
+	}
+	const auto crc = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(records.data()), static_cast<uInt>(records.size())));
+
+	string out;
+	out.reserve(BATCH_HEADER_SIZE + records.size());
+	put_u32(out, count);
+	put_u32(out, crc);
+	out += records;
+	return out;
+}
+
+}
+
+struct edit_journal::impl
+{
+	impl(const fs::path& path, const std::chrono::milliseconds commit_interval)
+	:
+		path(path),
+		commit_interval(commit_interval),
+		next_sequence(1),
+		change_count(0),
+		bytes_written(0),
+		stopping(false),
+		file_end(0),
+		written_sequence(0)
+	{
+		open();
+		thread = std::thread([this]()
+		{
+			run();
+		});
+	}
+
+	impl(impl&&) = delete;
+	impl(const impl&) = delete;
+	impl& operator=(impl&&) = delete;
+	impl& operator=(const impl&) = delete;
+
+	const fs::path path;
+	const std::chrono::milliseconds commit_interval;
+
+	// guards everything below except the file
+	mutable std::mutex mutex;
+	uint64_t next_sequence;
+	// appended, but not written yet
+	std::vector<record> pending;
+	// every change that has not been compacted away (including pending), oldest first
+	position::unordered_map_t<chunk_in_world, std::vector<record>> changes;
+	uint64_t change_count;
+	uint64_t bytes_written;
+
+	struct compaction
+	{
+		uint64_t through_sequence;
+		std::vector<chunk_in_world> chunks;
+		std::function<void()> make_durable;
+	};
+	std::deque<compaction> compactions;
+	bool stopping;
+	std::condition_variable cv;
+
+	// guards the file; taken before mutex when both are needed
+	std::mutex file_mutex;
+	std::unique_ptr<util::positional_file> file;
+	uint64_t file_end;
+	// every change up to this is in the file
+	uint64_t written_sequence;
+
+	std::thread thread;
+
+	void open();
+	void run();
+	// call with file_mutex locked
+	void write_pending();
+	void compact(const compaction&);
+};
+
+edit_journal::edit_journal(const fs::path& path, const std::chrono::milliseconds commit_interval)
+:
+	pImpl(std::make_unique<impl>(path, commit_interval))
+{
+}
+
+edit_journal::~edit_journal()
+{
+	{
+		std::lock_guard<std::mutex> g(pImpl->mutex);
+		pImpl->stopping = true;
+	}
+	pImpl->cv.notify_all();
+	pImpl->thread.join();
+}
+
+uint64_t edit_journal::append(const block_in_world& pos, const block_t block)
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	const record r{pImpl->next_sequence++, pos, block};
+	pImpl->pending.emplace_back(r);
+	pImpl->changes[chunk_in_world(pos)].emplace_back(r);
+	++pImpl->change_count;
+	return r.sequence;
+}
+
+void edit_journal::commit()
+{
+	std::lock_guard<std::mutex> g(pImpl->file_mutex);
+	pImpl->write_pending();
+}
+
+bool edit_journal::replay(Chunk& chunk) const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	const auto i = pImpl->changes.find(chunk.get_position());
+	if(i == pImpl->changes.cend())
+	{
+		return false;
+	}
+	for(const record& r : i->second)
+	{
+		chunk.set_block(position::block_in_chunk(r.pos), r.block);
+	}
+	return true;
+}
+
+bool edit_journal::has_changes(const chunk_in_world& pos) const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->changes.count(pos) != 0;
+}
+
+uint64_t edit_journal::last_sequence() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->next_sequence - 1;
+}
+
+void edit_journal::compact
+(
+	const uint64_t through_sequence,
+	std::vector<chunk_in_world> chunks,
+	std::function<void()> make_durable
+)
+{
+	{
+		std::lock_guard<std::mutex> g(pImpl->mutex);
+		pImpl->compactions.push_back({through_sequence, std::move(chunks), std::move(make_durable)});
+	}
+	pImpl->cv.notify_all();
+}
+
+uint64_t edit_journal::change_count() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->change_count;
+}
+
+uint64_t edit_journal::bytes_written() const
+{
+	std::lock_guard<std::mutex> g(pImpl->mutex);
+	return pImpl->bytes_written;
+}
+
+void edit_journal::impl::open()
+{
+	fs::create_directories(path.parent_path());
+	file = std::make_unique<util::positional_file>(path);
+	const uint64_t size = file->size();
+	if(size == 0)
+	{
+		file->write(0, header());
+		file_end = HEADER_SIZE;
+		return;
+	}
+
+	const string bytes = file->read(0, static_cast<std::size_t>(size));
+	if(bytes.size() < HEADER_SIZE
+	|| std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw std::runtime_error("error loading " + path.u8string() + ": not a journal");
+	}
+	const uint32_t version = get_u32(bytes.data() + sizeof(MAGIC));
+	if(version != VERSION)
+	{
+		throw std::runtime_error("error loading " + path.u8string() + ": unknown version " + std::to_string(version));
+	}
+
+	std::size_t offset = HEADER_SIZE;
+	uint64_t count = 0;
+	while(bytes.size() - offset >= BATCH_HEADER_SIZE)
+	{
+		const uint32_t record_count = get_u32(bytes.data() + offset);
+		const uint32_t crc = get_u32(bytes.data() + offset + 4);
+		const std::size_t records_size = record_count * RECORD_SIZE;
+		if(record_count == 0
+		|| bytes.size() - offset - BATCH_HEADER_SIZE < records_size)
+		{
+			break;
+		}
+		const char* p = bytes.data() + offset + BATCH_HEADER_SIZE;
+		if(crc32(0, reinterpret_cast<const Bytef*>(p), static_cast<uInt>(records_size)) != crc)
+		{
+			break;
+		}
+		for(uint32_t i = 0; i < record_count; ++i, p += RECORD_SIZE)
+		{
+			const uint32_t block = get_u32(p + 32);
+			const record r
+			{
+				get_u64(p),
+				block_in_world
+				(
+					static_cast<block_in_world::value_type>(get_u64(p + 8)),
+					static_cast<block_in_world::value_type>(get_u64(p + 16)),
+					static_cast<block_in_world::value_type>(get_u64(p + 24))
+				),
+				block_t(block >> 8, static_cast<uint8_t>(block & 0xFF)),
+			};
+			changes[chunk_in_world(r.pos)].emplace_back(r);
+			next_sequence = std::max(next_sequence, r.sequence + 1);
+		}
+		count += record_count;
+		offset += BATCH_HEADER_SIZE + records_size;
+	}
+	if(offset != bytes.size())
+	{
+		LOG(WARN) << "ignoring " << (bytes.size() - offset) << " bytes at the end of " << path.u8string() << " (probably cut off by a crash)\n";
+	}
+	// the next batch overwrites what was ignored
+	file_end = offset;
+	written_sequence = next_sequence - 1;
+	change_count = count;
+	if(count != 0)
+	{
+		LOG(INFO) << "replaying " << count << " block changes from " << path.u8string() << '\n';
+	}
+}
+
+void edit_journal::impl::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(true)
+	{
+		cv.wait_for(lock, commit_interval, [this]()
+		{
+			return stopping || !compactions.empty();
+		});
+		const bool stop = stopping;
+
+		lock.unlock();
+		try
+		{
+			std::lock_guard<std::mutex> g(file_mutex);
+			write_pending();
+		}
+		catch(const std::exception& e)
+		{
+			LOG(ERROR) << "error writing " << path.u8string() << ": " << e.what() << '\n';
+		}
+		lock.lock();
+
+		while(!compactions.empty())
+		{
+			const compaction c = std::move(compactions.front());
+			compactions.pop_front();
+			lock.unlock();
+			try
+			{
+				compact(c);
+			}
+			catch(const std::exception& e)
+			{
+				LOG(ERROR) << "error compacting " << path.u8string() << ": " << e.what() << '\n';
+			}
+			lock.lock();
+		}
+
+		if(stop)
+		{
+			break;
+		}
+	}
+}
+
+void edit_journal::impl::write_pending()
+{
+	std::vector<record> batch;
+	{
+		std::lock_guard<std::mutex> g(mutex);
+		batch.swap(pending);
+	}
+	if(batch.empty())
+	{
+		return;
+	}
+
+	const string bytes = encode_batch(batch.cbegin(), batch.cend());
+	file->write(file_end, bytes);
+	file->sync();
+	file_end += bytes.size();
+	written_sequence = batch.back().sequence;
+
+	std::lock_guard<std::mutex> g(mutex);
+	bytes_written += bytes.size();
+}
+
+void edit_journal::impl::compact(const compaction& c)
+{
+	if(c.make_durable != nullptr)
+	{
+		c.make_durable();
+	}
+
+	std::lock_guard<std::mutex> fg(file_mutex);
+	write_pending();
+
+	// the changes that stay, in sequence order (changes appended after write_pending are written after the rewrite)
+	std::vector<record> kept;
+	{
+		std::lock_guard<std::mutex> g(mutex);
+		for(const chunk_in_world& pos : c.chunks)
+		{
+			const auto i = changes.find(pos);
+			if(i == changes.cend())
+			{
+				continue;
+			}
+			std::vector<record>& records = i->second;
+			const auto old_size = records.size();
+			records.erase(std::remove_if(records.begin(), records.end(), [&c](const record& r)
+			{
+				return r.sequence <= c.through_sequence;
+			}), records.end());
+			change_count -= old_size - records.size();
+			if(records.empty())
+			{
+				changes.erase(i);
+			}
+		}
+		for(const auto& [pos, records] : changes)
+		{
+			for(const record& r : records)
+			{
+				if(r.sequence <= written_sequence)
+				{
+					kept.emplace_back(r);
+				}
+			}
+		}
+	}
+	std::sort(kept.begin(), kept.end(), [](const record& a, const record& b)
+	{
+		return a.sequence < b.sequence;
+	});
+
+	string bytes = header();
+	if(!kept.empty())
+	{
+		bytes += encode_batch(kept.cbegin(), kept.cend());
+	}
+	const fs::path temp_path = path.u8string() + ".new";
+	fs::remove(temp_path);
+	{
+		util::positional_file temp(temp_path);
+		temp.write(0, bytes);
+		temp.sync();
+	}
+	file.reset();
+	try
+	{
+		fs::rename(temp_path, path);
+	}
+	catch(...)
+	{
+		file = std::make_unique<util::positional_file>(path);
+		throw;
+	}
+	file = std::make_unique<util::positional_file>(path);
+	file_end = bytes.size();
+
+	std::lock_guard<std::mutex> g(mutex);
+	bytes_written += bytes.size();
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "block/block.hpp"
+#include "fwd/chunk/Chunk.hpp"
+#include "fwd/position/block_in_world.hpp"
+#include "fwd/position/chunk_in_world.hpp"
+#include "shim/propagate_const.hpp"
+#include "util/filesystem.hpp"
+
+namespace block_thingy::storage {
+
+/*
+ * An append-only log of block changes, so that an edit does not rewrite its whole chunk
+ *
+ * Each change gets a sequence number. A background thread writes the changes in batches every commit interval and
+ * syncs each batch (group commit). Once images of the changed chunks are saved, compact drops their changes. Until
+ * then, replay sets a chunk's changes on top of the image it was loaded from, so a crash loses at most one interval.
+ *
+ * The file is the magic "btjournl" and a version, then batches: a record count, a CRC-32 of the records, and the
+ * records (sequence number, block position, and block as (index << 8) | generation), all little-endian. A batch that
+ * was cut off by a crash fails its check, and it and anything after it are ignored.
+ */
+class edit_journal
+{
+public:
+	/*
+	 * Reads the changes in the file (creating it if it does not exist)
+	 */
+	edit_journal(const fs::path&, std::chrono::milliseconds commit_interval);
+	/*
+	 * Commits, finishes the requested compactions, and stops the thread
+	 */
+	~edit_journal();
+
+	edit_journal(edit_journal&&) = delete;
+	edit_journal(const edit_journal&) = delete;
+	edit_journal& operator=(edit_journal&&) = delete;
+	edit_journal& operator=(const edit_journal&) = delete;
+
+	/*
+	 * @return The sequence number of the change
+	 */
+	uint64_t append(const position::block_in_world&, block_t);
+
+	/*
+	 * Write and sync the changes appended so far, without waiting for the timer
+	 */
+	void commit();
+
+	/*
+	 * Set the chunk's changes on it, oldest first (setting a block is idempotent, so it does not matter if the
+	 * image already has some of them)
+	 * The light is not updated
+	 *
+	 * @return true if the chunk has changes
+	 */
+	bool replay(Chunk&) const;
+
+	bool has_changes(const position::chunk_in_world&) const;
+
+	/*
+	 * The sequence number of the newest change (0 if there are none)
+	 */
+	uint64_t last_sequence() const;
+
+	/*
+	 * On the journal's thread: call make_durable, then drop the changes of the given chunks up to and including
+	 * through_sequence and rewrite the file without them
+	 * Give only chunks whose images taken after through_sequence are already saved; make_durable should sync them, and
+	 * it runs between group commits, so it should not wait on anything slow. If it throws, nothing is dropped.
+	 */
+	void compact
+	(
+		uint64_t through_sequence,
+		std::vector<position::chunk_in_world> chunks,
+		std::function<void()> make_durable
+	);
+
+	uint64_t change_count() const;
+	uint64_t bytes_written() const;
+
+private:
+	struct impl;
+	std::propagate_const<std::unique_ptr<impl>> pImpl;
+};
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -13,7 +15,7 @@ template<> \
 template<> \
 void chunk_data<T>::save(msgpack::packer<zstr::ostream>& o) const \
 { \
-	o.pack(blocks); \
+	o.pack(*snapshot()); \
 } \
 \
 template<> \
@@ -21,8 +23,10 @@ template<> \
 void chunk_data<T>::load(const msgpack::object& o) \
 { \
 	if(o.type != msgpack::type::ARRAY) throw msgpack::type_error(); \
-	if(o.via.array.size != blocks.size()) throw msgpack::type_error(); \
-	blocks = o.as<decltype(blocks)>(); \
+	if(o.via.array.size != CHUNK_BLOCK_COUNT) throw msgpack::type_error(); \
+	auto loaded = std::make_shared<array_t>(o.as<array_t>()); \
+	std::lock_guard<std::mutex> g(blocks_mutex); \
+	blocks = std::move(loaded); \
 } \
 
 INSTANTIATE(block_t)
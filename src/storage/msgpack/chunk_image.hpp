@@ -0,0 +1,30 @@
+#pragma once
+
+#include "storage/chunk_image.hpp"
+#include "storage/msgpack/block.hpp"
+#include "storage/msgpack/color.hpp"
+
+namespace msgpack {
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
+namespace adaptor {
+
+using block_thingy::storage::chunk_image;
+
+// the same format as Chunk, so chunk_image does not need a convert (a chunk file is loaded into a Chunk)
+template<>
+struct pack<chunk_image>
+{
+	template<typename Stream>
+	packer<Stream>& operator()(packer<Stream>& o, const chunk_image& image) const
+	{
+		o.pack_array(3);
+		o.pack(*image.blocks);
+		o.pack(*image.blocklight);
+		o.pack(*image.skylight);
+		return o;
+	}
+};
+
+} // namespace adaptor
+} // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+} // namespace msgpack
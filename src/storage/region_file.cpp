@@ -0,0 +1,318 @@
+#include "region_file.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include "util/logger.hpp"
+
+using std::string;
+
+namespace block_thingy::storage {
+
+namespace {
+
+constexpr char MAGIC[8] = {'b', 't', 'r', 'e', 'g', 'i', 'o', 'n'};
+constexpr uint32_t VERSION = 1;
+constexpr uint64_t TABLE_OFFSET = sizeof(MAGIC) + 4 + 4;
+constexpr uint64_t ENTRY_SIZE = 8;
+constexpr uint64_t HEADER_SIZE = TABLE_OFFSET + region_file::CHUNK_COUNT * ENTRY_SIZE;
+constexpr uint32_t HEADER_SECTORS = static_cast<uint32_t>((HEADER_SIZE + region_file::SECTOR_SIZE - 1) / region_file::SECTOR_SIZE);
+// a region that is written often without being synced syncs once this many old sectors are waiting to be freed
+constexpr uint64_t MAX_UNSYNCED_FREE_SECTORS = 256;
+
+void put_u32(char* p, const uint32_t v)
+{
+	p[0] = static_cast<char>(v & 0xFF);
+	p[1] = static_cast<char>((v >> 8) & 0xFF);
+	p[2] = static_cast<char>((v >> 16) & 0xFF);
+	p[3] = static_cast<char>((v >> 24) & 0xFF);
+}
+
+uint32_t get_u32(const char* p)
+{
+	return static_cast<uint32_t>(static_cast<unsigned char>(p[0]))
+		| (static_cast<uint32_t>(static_cast<unsigned char>(p[1])) << 8)
+		| (static_cast<uint32_t>(static_cast<unsigned char>(p[2])) << 16)
+		| (static_cast<uint32_t>(static_cast<unsigned char>(p[3])) << 24);
+}
+
+}
+
+region_file::region_file(const fs::path& path)
+:
+	file(path),
+	table(CHUNK_COUNT, entry{0, 0}),
+	unsynced_free_sectors(0)
+{
+	const uint64_t file_size = file.size();
+	if(file_size == 0)
+	{
+		string header(HEADER_SECTORS * SECTOR_SIZE, '\0');
+		std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+		put_u32(header.data() + sizeof(MAGIC), VERSION);
+		put_u32(header.data() + sizeof(MAGIC) + 4, static_cast<uint32_t>(REGION_SIZE));
+		file.write(0, header);
+		used.assign(HEADER_SECTORS, true);
+		return;
+	}
+
+	if(file_size < HEADER_SIZE)
+	{
+		throw std::runtime_error("error loading " + path.u8string() + ": truncated header");
+	}
+	const string header = file.read(0, HEADER_SIZE);
+	if(std::memcmp(header.data(), MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw std::runtime_error("error loading " + path.u8string() + ": not a region file");
+	}
+	const uint32_t version = get_u32(header.data() + sizeof(MAGIC));
+	if(version != VERSION)
+	{
+		throw std::runtime_error("error loading " + path.u8string() + ": unknown version " + std::to_string(version));
+	}
+	if(get_u32(header.data() + sizeof(MAGIC) + 4) != REGION_SIZE)
+	{
+		throw std::runtime_error("error loading " + path.u8string() + ": region size is not " + std::to_string(REGION_SIZE));
+	}
+
+	const uint64_t file_sectors = (file_size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+	used.assign(std::max<uint64_t>(file_sectors, HEADER_SECTORS), false);
+	set_used(0, HEADER_SECTORS, true);
+	for(std::size_t i = 0; i < CHUNK_COUNT; ++i)
+	{
+		const char* p = header.data() + TABLE_OFFSET + i * ENTRY_SIZE;
+		const entry e{get_u32(p), get_u32(p + 4)};
+		if(e.sector == 0)
+		{
+			continue;
+		}
+		const uint32_t count = sectors_for(e.length);
+		if(e.sector < HEADER_SECTORS || e.sector + count > used.size())
+		{
+			// probably a crash while the file was growing; the chunk is lost, but the rest are fine
+			continue;
+		}
+		table[i] = e;
+		set_used(e.sector, count, true);
+	}
+}
+
+region_file::~region_file()
+{
+	try
+	{
+		sync_locked();
+	}
+	catch(const std::exception& e)
+	{
+		LOG(ERROR) << "error syncing " << path().u8string() << ": " << e.what() << '\n';
+	}
+}
+
+bool region_file::has(const std::size_t index) const
+{
+	assert(index < CHUNK_COUNT);
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	return table[index].sector != 0;
+}
+
+std::optional<string> region_file::read(const std::size_t index) const
+{
+	assert(index < CHUNK_COUNT);
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	const entry e = table[index];
+	if(e.sector == 0)
+	{
+		return std::nullopt;
+	}
+	return file.read(e.sector * SECTOR_SIZE, e.length);
+}
+
+bool region_file::read_mapped(const std::size_t index, const std::function<void(std::string_view)>& f) const
+{
+	assert(index < CHUNK_COUNT);
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	const entry e = table[index];
+	if(e.sector == 0)
+	{
+		return false;
+	}
+	const util::mapped_view view = file.map(e.sector * SECTOR_SIZE, e.length);
+	f(std::string_view(view.data(), view.size()));
+	return true;
+}
+
+void region_file::write(const std::size_t index, const string& bytes)
+{
+	const uint32_t count = check_length(bytes);
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	write_locked(index, bytes, count);
+}
+
+bool region_file::write_if_missing(const std::size_t index, const string& bytes)
+{
+	const uint32_t count = check_length(bytes);
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	if(table[index].sector != 0)
+	{
+		return false;
+	}
+	write_locked(index, bytes, count);
+	return true;
+}
+
+void region_file::sync()
+{
+	std::unique_lock<std::shared_mutex> lock(mutex);
+	sync_locked();
+}
+
+std::vector<std::size_t> region_file::saved() const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	std::vector<std::size_t> indexes;
+	for(std::size_t i = 0; i < CHUNK_COUNT; ++i)
+	{
+		if(table[i].sector != 0)
+		{
+			indexes.emplace_back(i);
+		}
+	}
+	return indexes;
+}
+
+std::size_t region_file::index_of(const int64_t x, const int64_t y, const int64_t z)
+{
+	assert(x >= 0 && x < REGION_SIZE);
+	assert(y >= 0 && y < REGION_SIZE);
+	assert(z >= 0 && z < REGION_SIZE);
+	return static_cast<std::size_t>(REGION_SIZE * REGION_SIZE * x + REGION_SIZE * y + z);
+}
+
+uint64_t region_file::free_sector_count() const
+{
+	std::shared_lock<std::shared_mutex> lock(mutex);
+	uint64_t count = 0;
+	for(const bool u : used)
+	{
+		if(!u)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+const fs::path& region_file::path() const
+{
+	return file.path();
+}
+
+void region_file::sync_locked()
+{
+	if(unsynced_entries.empty())
+	{
+		return;
+	}
+	// the data first, so that the table on disk never points to data that is not there
+	file.sync();
+	for(const std::size_t index : unsynced_entries)
+	{
+		write_entry(index);
+	}
+	file.sync();
+	unsynced_entries.clear();
+	for(const entry& e : unsynced_free)
+	{
+		set_used(e.sector, sectors_for(e.length), false);
+	}
+	unsynced_free.clear();
+	unsynced_free_sectors = 0;
+}
+
+uint32_t region_file::check_length(const string& bytes)
+{
+	if(bytes.empty() || bytes.size() > UINT32_MAX)
+	{
+		throw std::invalid_argument("region_file::write: bad chunk length " + std::to_string(bytes.size()));
+	}
+	return sectors_for(bytes.size());
+}
+
+void region_file::write_locked(const std::size_t index, const string& bytes, const uint32_t count)
+{
+	assert(index < CHUNK_COUNT);
+	// the old sectors stay used until the new ones are in the table on disk, so a crash at any point leaves one whole copy
+	const entry old = table[index];
+	const entry e{allocate(count), static_cast<uint32_t>(bytes.size())};
+	file.write(e.sector * SECTOR_SIZE, bytes);
+	table[index] = e;
+	unsynced_entries.emplace_back(index);
+	if(old.sector != 0)
+	{
+		// reused only after sync, since until then the table on disk may still point to them
+		unsynced_free.push_back(old);
+		unsynced_free_sectors += sectors_for(old.length);
+		if(unsynced_free_sectors >= MAX_UNSYNCED_FREE_SECTORS)
+		{
+			sync_locked();
+		}
+	}
+}
+
+void region_file::write_entry(const std::size_t index)
+{
+	char buf[ENTRY_SIZE];
+	put_u32(buf, table[index].sector);
+	put_u32(buf + 4, table[index].length);
+	file.write(TABLE_OFFSET + index * ENTRY_SIZE, buf, ENTRY_SIZE);
+}
+
+uint32_t region_file::sectors_for(const uint64_t length)
+{
+	return static_cast<uint32_t>((length + SECTOR_SIZE - 1) / SECTOR_SIZE);
+}
+
+uint32_t region_file::allocate(const uint32_t count)
+{
+	// first fit
+	uint32_t run_start = 0;
+	uint32_t run_length = 0;
+	for(uint32_t i = HEADER_SECTORS; i < used.size(); ++i)
+	{
+		if(used[i])
+		{
+			run_length = 0;
+			continue;
+		}
+		if(run_length == 0)
+		{
+			run_start = i;
+		}
+		++run_length;
+		if(run_length == count)
+		{
+			set_used(run_start, count, true);
+			return run_start;
+		}
+	}
+
+	// a free run at the end of the file is extended
+	const uint32_t start = run_length != 0 ? run_start : static_cast<uint32_t>(used.size());
+	used.resize(start + count, false);
+	set_used(start, count, true);
+	return start;
+}
+
+void region_file::set_used(const uint32_t first, const uint32_t count, const bool u)
+{
+	for(uint32_t i = first; i < first + count; ++i)
+	{
+		used[i] = u;
+	}
+}
+
+}
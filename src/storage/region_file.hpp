@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "util/filesystem.hpp"
+#include "util/positional_file.hpp"
+
+namespace block_thingy::storage {
+
+/*
+ * Holds the saved data of REGION_SIZE³ chunks in one file
+ *
+ * The file starts with a header: a magic string, the format version, and a table that has the first sector and the
+ * length in bytes of each chunk (sector 0 means the chunk is not saved). Chunks are stored in 4 KiB sectors after the
+ * header. A chunk is always written to the first free run of sectors that is big enough (or the end of the file), and
+ * the table on disk is changed to point to it only by sync, after the data is synced, so a crash leaves either the old
+ * or the new copy. Its old sectors can be reused once the table is synced. Until then, reads get the new copy.
+ *
+ * Reading a chunk is one read (or mapping) of a known extent. Reads can happen in parallel; writes are serialized.
+ */
+class region_file
+{
+public:
+	static constexpr int64_t REGION_SIZE = 16;
+	static constexpr std::size_t CHUNK_COUNT = REGION_SIZE * REGION_SIZE * REGION_SIZE;
+	static constexpr uint64_t SECTOR_SIZE = 4096;
+
+	/*
+	 * Creates the file if it does not exist
+	 * Throws if the file is not a region file
+	 */
+	explicit region_file(const fs::path&);
+
+	/*
+	 * Syncs
+	 */
+	~region_file();
+
+	region_file(region_file&&) = delete;
+	region_file(const region_file&) = delete;
+	region_file& operator=(region_file&&) = delete;
+	region_file& operator=(const region_file&) = delete;
+
+	/*
+	 * @param index see index_of
+	 */
+	bool has(std::size_t index) const;
+	std::optional<std::string> read(std::size_t index) const;
+	/*
+	 * Calls f with the chunk's bytes mapped from the file instead of copied
+	 * The region can not be written until f returns
+	 * @return false if the chunk is not saved
+	 */
+	bool read_mapped(std::size_t index, const std::function<void(std::string_view)>& f) const;
+	void write(std::size_t index, const std::string& bytes);
+	/*
+	 * Like write, but checks that the chunk is not saved in the same lock, so that a save on another thread is not
+	 * overwritten
+	 * @return false if the chunk is saved (nothing is written)
+	 */
+	bool write_if_missing(std::size_t index, const std::string& bytes);
+
+	/*
+	 * Make the chunks written so far durable: sync their data, then write their table entries and sync again
+	 * Writing many chunks and then syncing once costs 2 syncs instead of 2 for each chunk
+	 */
+	void sync();
+
+	/*
+	 * The indexes of the chunks that are saved
+	 */
+	std::vector<std::size_t> saved() const;
+
+	/*
+	 * @param x, y, z the chunk position in the region (0 to REGION_SIZE - 1)
+	 */
+	static std::size_t index_of(int64_t x, int64_t y, int64_t z);
+
+	/*
+	 * Sectors that are not used by any chunk (including ones at the end that were freed)
+	 */
+	uint64_t free_sector_count() const;
+
+	const fs::path& path() const;
+
+private:
+	struct entry
+	{
+		uint32_t sector;
+		uint32_t length;
+	};
+
+	util::positional_file file;
+	std::vector<entry> table;
+	// one for each sector in the file
+	std::vector<bool> used;
+	// the chunks whose table entry on disk is older than the one in table
+	std::vector<std::size_t> unsynced_entries;
+	// the old places of chunks that were moved since the last sync
+	std::vector<entry> unsynced_free;
+	uint64_t unsynced_free_sectors;
+	mutable std::shared_mutex mutex;
+
+	// throws if the chunk can not be stored; @return its sector count
+	static uint32_t check_length(const std::string& bytes);
+	// call with mutex locked
+	void write_locked(std::size_t index, const std::string& bytes, uint32_t count);
+	void sync_locked();
+	void write_entry(std::size_t index);
+	static uint32_t sectors_for(uint64_t length);
+	uint32_t allocate(uint32_t sector_count);
+	void set_used(uint32_t first, uint32_t count, bool);
+};
+
+}
@@ -1,9 +1,13 @@
 #include "world_file.hpp"
 
 #include <fstream>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include <msgpack.hpp>
 #include <zstr/zstr.hpp>
@@ -12,16 +16,18 @@
 #include "Player.hpp"
 #include "chunk/Chunk.hpp"
 #include "position/chunk_in_world.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
 #include "storage/msgpack_util.hpp"
 #include "storage/msgpack/Chunk.hpp"
 #include "storage/msgpack/Player.hpp"
 #include "storage/msgpack/world.hpp"
-#include "util/copy_stream.hpp"
 #include "util/filesystem.hpp"
 #include "util/logger.hpp"
 #include "util/misc.hpp"
 #include "world/world.hpp"
 
+using std::nullopt;
 using std::string;
 using std::unique_ptr;
 
@@ -31,7 +37,14 @@ world_file::world_file(const fs::path& world_dir)
 :
 	world_path(world_dir / "world"),
 	player_dir(world_dir / "players"),
-	chunk_dir(world_dir / "chunks")
+	region_dir(world_dir / "regions"),
+	chunk_dir(world_dir / "chunks"),
+	chunk_codec(codec::lz),
+	save_light(true),
+	loaded_count(0),
+	load_allocations(0),
+	load_bytes_copied(0),
+	region_uses(0)
 {
 }
 
@@ -68,7 +81,8 @@ string world_file::get_name() const
 void world_file::load(world::world& world)
 {
 	fs::create_directories(player_dir);
-	fs::create_directories(chunk_dir);
+	fs::create_directories(region_dir);
+	build_index();
 
 	if(!fs::is_regular_file(world_path))
 	{
@@ -129,58 +143,406 @@ unique_ptr<Player> world_file::load_player
 
 void world_file::save_chunk(const Chunk& chunk)
 {
-	position::chunk_in_world position = chunk.get_position();
-	fs::path file_path = chunk_path(position);
-	LOG(DEBUG) << "saving " << file_path.u8string() << '\n';
+	save_chunk(chunk.snapshot());
+}
+
+void world_file::save_chunk(const chunk_image& image)
+{
+	const string stored = encode(chunk_codec, chunk_format::write(image, save_light || image.light_costly));
 
-	std::ofstream stdstream(file_path, std::ofstream::binary);
-	zstr::ostream stream(stdstream);
-	msgpack::pack(stream, chunk);
+	position::chunk_in_world region_pos;
+	std::size_t index;
+	region_of(image.position, region_pos, index);
+	get_region(region_pos)->write(index, stored);
+
+	std::lock_guard<std::mutex> g(index_mutex);
+	saved_chunks[region_pos].set(index);
+}
+
+void world_file::sync_chunks(const std::vector<position::chunk_in_world>& positions)
+{
+	position::unordered_set_t<position::chunk_in_world> region_positions;
+	for(const position::chunk_in_world& position : positions)
+	{
+		position::chunk_in_world region_pos;
+		std::size_t index;
+		region_of(position, region_pos, index);
+		region_positions.emplace(region_pos);
+	}
+	for(const position::chunk_in_world& region_pos : region_positions)
+	{
+		get_region(region_pos)->sync();
+	}
+}
+
+void world_file::sync_all()
+{
+	std::vector<std::shared_ptr<region_file>> open;
+	{
+		std::lock_guard<std::mutex> g(regions_mutex);
+		for(const auto& [region_pos, region] : regions)
+		{
+			open.emplace_back(region.file);
+		}
+	}
+	for(const std::shared_ptr<region_file>& region : open)
+	{
+		region->sync();
+	}
 }
 
 unique_ptr<Chunk> world_file::load_chunk(world::world& world, const position::chunk_in_world& position)
 {
-	fs::path file_path = chunk_path(position);
-	if(!fs::exists(file_path))
+	bool has_light;
+	return load_chunk(world, position, has_light);
+}
+
+unique_ptr<Chunk> world_file::load_chunk(world::world& world, const position::chunk_in_world& position, bool& has_light)
+{
+	has_light = true;
+	position::chunk_in_world region_pos;
+	std::size_t index;
+	region_of(position, region_pos, index);
+	bool in_region;
+	bool in_file;
+	{
+		std::lock_guard<std::mutex> g(index_mutex);
+		const auto i = saved_chunks.find(region_pos);
+		in_region = i != saved_chunks.cend() && i->second.test(index);
+		in_file = !in_region && chunk_files.count(position) != 0;
+	}
+
+	if(!in_region && !in_file)
 	{
 		return nullptr;
 	}
 
-	std::ifstream stdstream(file_path, std::ifstream::binary);
-	zstr::istream stream(stdstream);
-	string bytes = util::read_stream(stream);
+	std::shared_ptr<const region_file> region;
+	fs::path file_path;
+	// for error messages
+	string source;
+	if(in_region)
+	{
+		region = get_region(region_pos);
+		std::ostringstream ss;
+		ss << region->path().u8string() << " (chunk " << position << ')';
+		source = ss.str();
+	}
+	else
+	{
+		file_path = chunk_path(position);
+		source = file_path.u8string();
+	}
+
 	auto chunk = std::make_unique<Chunk>(position, world);
 	try
 	{
-		unpack_bytes(bytes, *chunk);
+		if(region != nullptr)
+		{
+			// decoded while it is mapped, so the stored bytes are not copied out of the file first
+			region->read_mapped(index, [this, &chunk, &has_light](const std::string_view stored)
+			{
+				has_light = decode_chunk(stored, *chunk);
+			});
+		}
+		else
+		{
+			const string stored = util::read_file(file_path);
+			load_allocations += 1;
+			load_bytes_copied += stored.size();
+			// the old chunk files are gzip, which decode recognizes
+			has_light = decode_chunk(stored, *chunk);
+		}
 	}
 	// TODO: rename the bad file so the user can attempt to recover it (because the new chunk will overwrite it)
 	catch(const msgpack::v1::insufficient_bytes& e)
 	{
 		// TODO: load truncated chunks
-		LOG(ERROR) << "error loading " << file_path.u8string() << ": " << e.what() << '\n';
+		LOG(ERROR) << "error loading " << source << ": " << e.what() << '\n';
 		return nullptr;
 	}
 	catch(const std::exception& e)
 	{
-		LOG(ERROR) << "error loading " << file_path.u8string() << ": " << e.what() << '\n';
+		LOG(ERROR) << "error loading " << source << ": " << e.what() << '\n';
 		return nullptr;
 	}
 	catch(...)
 	{
-		LOG(ERROR) << "error loading " << file_path.u8string() << '\n';
+		LOG(ERROR) << "error loading " << source << '\n';
 		return nullptr;
 	}
 
+	++loaded_count;
 	return chunk;
 }
 
+bool world_file::decode_chunk(const std::string_view stored, Chunk& chunk)
+{
+	// reused by every load on this thread, so decompressing does not allocate once it is big enough
+	thread_local string buffer;
+	const std::size_t capacity = buffer.capacity();
+	const std::string_view bytes = decode(stored, buffer);
+	if(buffer.capacity() != capacity)
+	{
+		++load_allocations;
+	}
+	if(bytes.data() == buffer.data())
+	{
+		load_bytes_copied += bytes.size();
+	}
+
+	if(chunk_format::is_binary(bytes))
+	{
+		load_allocations += chunk_format::ARRAY_COUNT;
+		return chunk_format::read(bytes, chunk);
+	}
+	else
+	{
+		// saved before the binary format
+		// msgpack converts each array on the stack before copying it into the chunk (its zone is not counted here)
+		unpack_bytes(string(bytes), chunk);
+		load_allocations += 1 + chunk_format::ARRAY_COUNT;
+		load_bytes_copied += bytes.size()
+			+ sizeof(chunk_blocks_t::array_t)
+			+ 2 * sizeof(chunk_data<graphics::color>::array_t);
+		return true;
+	}
+}
+
+chunk_load_stats world_file::get_load_stats() const
+{
+	return
+	{
+		loaded_count,
+		load_allocations,
+		load_bytes_copied,
+	};
+}
+
 bool world_file::has_chunk(const position::chunk_in_world& position)
 {
-	return fs::exists(chunk_path(position));
+	position::chunk_in_world region_pos;
+	std::size_t index;
+	region_of(position, region_pos, index);
+
+	std::lock_guard<std::mutex> g(index_mutex);
+	if(const auto i = saved_chunks.find(region_pos);
+		i != saved_chunks.cend() && i->second.test(index))
+	{
+		return true;
+	}
+	return chunk_files.count(position) != 0;
+}
+
+std::size_t world_file::migrate_chunk_files()
+{
+	std::vector<position::chunk_in_world> positions;
+	{
+		std::lock_guard<std::mutex> g(index_mutex);
+		positions.assign(chunk_files.cbegin(), chunk_files.cend());
+	}
+
+	std::size_t count = 0;
+	for(const position::chunk_in_world& position : positions)
+	{
+		const fs::path path = chunk_path(position);
+		try
+		{
+			position::chunk_in_world region_pos;
+			std::size_t index;
+			region_of(position, region_pos, index);
+			// if the region has it, it was saved after the file (checked in the region's lock, since chunk_writer can
+			// save a newer copy at any time)
+			const std::shared_ptr<region_file> region = get_region(region_pos);
+			if(region->write_if_missing(index, util::read_file(path)))
+			{
+				// the file is removed below, so the region's table has to point to the copy on disk first
+				region->sync();
+			}
+			{
+				std::lock_guard<std::mutex> g(index_mutex);
+				saved_chunks[region_pos].set(index);
+				chunk_files.erase(position);
+			}
+			fs::remove(path);
+			++count;
+		}
+		catch(const std::exception& e)
+		{
+			LOG(ERROR) << "error migrating " << path.u8string() << ": " << e.what() << '\n';
+		}
+	}
+
+	if(fs::is_directory(chunk_dir) && fs::is_empty(chunk_dir))
+	{
+		fs::remove(chunk_dir);
+	}
+	LOG(INFO) << "moved " << count << " chunks into region files\n";
+	return count;
+}
+
+std::optional<position::chunk_in_world> world_file::parse_position(const fs::path& path, const string& extension)
+{
+	if(path.extension() != extension)
+	{
+		return nullopt;
+	}
+	position::chunk_in_world position;
+	char sep1;
+	char sep2;
+	std::istringstream name(path.stem().u8string());
+	if(!(name >> position.x >> sep1 >> position.y >> sep2 >> position.z)
+	|| sep1 != '_' || sep2 != '_'
+	|| name.peek() != std::char_traits<char>::eof())
+	{
+		return nullopt;
+	}
+	return position;
+}
+
+void world_file::build_index()
+{
+	decltype(saved_chunks) saved;
+	decltype(chunk_files) files;
+
+	for(const auto& entry : fs::directory_iterator(region_dir))
+	{
+		const auto region_pos = parse_position(entry.path(), ".region");
+		if(region_pos == nullopt)
+		{
+			continue;
+		}
+		try
+		{
+			// only the header is read; the region is opened again when a chunk in it is used
+			const region_file region(entry.path());
+			auto& bits = saved[*region_pos];
+			for(const std::size_t index : region.saved())
+			{
+				bits.set(index);
+			}
+		}
+		catch(const std::exception& e)
+		{
+			LOG(ERROR) << e.what() << '\n';
+		}
+	}
+
+	if(fs::is_directory(chunk_dir))
+	{
+		for(const auto& entry : fs::directory_iterator(chunk_dir))
+		{
+			const auto position = parse_position(entry.path(), ".gz");
+			if(position == nullopt)
+			{
+				LOG(WARN) << "not a chunk file: " << entry.path().u8string() << '\n';
+				continue;
+			}
+			files.emplace(*position);
+		}
+	}
+	if(!files.empty())
+	{
+		LOG(INFO) << "this world has " << files.size() << " chunks in the old format; use migrate_chunks to move them into region files\n";
+	}
+
+	std::lock_guard<std::mutex> g(index_mutex);
+	saved_chunks = std::move(saved);
+	chunk_files = std::move(files);
+}
+
+void world_file::region_of
+(
+	const position::chunk_in_world& chunk_pos,
+	position::chunk_in_world& region_pos,
+	std::size_t& index
+)
+{
+	constexpr auto size = region_file::REGION_SIZE;
+	auto floor_div = [](const int64_t a) -> int64_t
+	{
+		return (a >= 0 ? a : a - (size - 1)) / size;
+	};
+	region_pos = {floor_div(chunk_pos.x), floor_div(chunk_pos.y), floor_div(chunk_pos.z)};
+	index = region_file::index_of
+	(
+		chunk_pos.x - region_pos.x * size,
+		chunk_pos.y - region_pos.y * size,
+		chunk_pos.z - region_pos.z * size
+	);
+}
+
+codec world_file::get_chunk_codec() const
+{
+	return chunk_codec;
+}
+
+void world_file::set_chunk_codec(const codec c)
+{
+	chunk_codec = c;
+}
+
+bool world_file::get_save_light() const
+{
+	return save_light;
+}
+
+void world_file::set_save_light(const bool save)
+{
+	save_light = save;
+}
+
+std::shared_ptr<region_file> world_file::get_region(const position::chunk_in_world& region_pos)
+{
+	std::lock_guard<std::mutex> g(regions_mutex);
+	auto i = regions.find(region_pos);
+	if(i == regions.end())
+	{
+		if(regions.size() >= MAX_OPEN_REGIONS)
+		{
+			// a region that another thread has gotten is still in use, so it is not closed (and is not opened twice)
+			auto oldest = regions.end();
+			for(auto j = regions.begin(); j != regions.end(); ++j)
+			{
+				if(j->second.file.use_count() == 1
+				&& (oldest == regions.end() || j->second.last_used < oldest->second.last_used))
+				{
+					oldest = j;
+				}
+			}
+			if(oldest != regions.end())
+			{
+				// its destructor syncs it
+				regions.erase(oldest);
+			}
+		}
+		i = regions.emplace(region_pos, open_region{std::make_shared<region_file>(region_path(region_pos)), 0}).first;
+	}
+	i->second.last_used = ++region_uses;
+	return i->second.file;
+}
+
+position::chunk_in_world world_file::chunk_in_region(const position::chunk_in_world& region_pos, const std::size_t index)
+{
+	constexpr auto size = region_file::REGION_SIZE;
+	const auto i = static_cast<int64_t>(index);
+	return
+	{
+		region_pos.x * size + i / (size * size),
+		region_pos.y * size + (i / size) % size,
+		region_pos.z * size + i % size,
+	};
+}
+
+fs::path world_file::region_path(const position::chunk_in_world& region_pos) const
+{
+	const string x = std::to_string(region_pos.x);
+	const string y = std::to_string(region_pos.y);
+	const string z = std::to_string(region_pos.z);
+	return region_dir / (x + '_' + y + '_' + z + ".region");
 }
 
-fs::path world_file::chunk_path(const position::chunk_in_world& position)
+fs::path world_file::chunk_path(const position::chunk_in_world& position) const
 {
 	const string x = std::to_string(position.x);
 	const string y = std::to_string(position.y);
@@ -1,11 +1,24 @@
 #pragma once
 
+#include <atomic>
+#include <bitset>
+#include <cstddef>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
 
 #include "fwd/Player.hpp"
 #include "fwd/chunk/Chunk.hpp"
-#include "fwd/position/chunk_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "fwd/storage/chunk_image.hpp"
+#include "storage/chunk_load_stats.hpp"
+#include "storage/codec.hpp"
+#include "storage/region_file.hpp"
 #include "util/filesystem.hpp"
 #include "fwd/world/world.hpp"
 
@@ -52,19 +65,128 @@ public:
 	 */
 	void save_chunk(const Chunk&);
 
+	/**
+	 * Save a chunk snapshot
+	 *
+	 * @note This can be called from any thread, but not for the same position from two threads at once
+	 * @note The save is durable after sync_chunks or sync_all (or once the world_file is closed)
+	 */
+	void save_chunk(const chunk_image&);
+
+	/**
+	 * Make the saves of the given chunks durable by syncing the regions they are in
+	 */
+	void sync_chunks(const std::vector<position::chunk_in_world>&);
+	/**
+	 * Make every save so far durable
+	 */
+	void sync_all();
+
 	/**
 	 * Load the chunk that is at specified position. If the chunk does not exist, `nullptr` is returned.
 	 */
 	std::unique_ptr<Chunk> load_chunk(world::world&, const position::chunk_in_world&);
+	/**
+	 * @param has_light set to false if the chunk was saved without its light
+	 */
+	std::unique_ptr<Chunk> load_chunk(world::world&, const position::chunk_in_world&, bool& has_light);
+	chunk_load_stats get_load_stats() const;
 
+	/**
+	 * This does not touch the disk
+	 */
 	bool has_chunk(const position::chunk_in_world&);
 
+	/**
+	 * Move the chunks saved one per file (the old format) into region files
+	 *
+	 * @return The amount of chunks moved
+	 */
+	std::size_t migrate_chunk_files();
+
+	codec get_chunk_codec() const;
+	void set_chunk_codec(codec);
+
+	/**
+	 * If false, chunks are saved without their light (unless it is costly to make), to be lit again when loaded
+	 */
+	bool get_save_light() const;
+	void set_save_light(bool);
+
+	/**
+	 * Where a chunk saved one per file (the old format) is
+	 */
+	fs::path chunk_path(const position::chunk_in_world&) const;
+	fs::path region_path(const position::chunk_in_world& region_pos) const;
+
+	/**
+	 * @param region_pos set to the position of the region that has the chunk
+	 * @param index set to the chunk's index in the region
+	 */
+	static void region_of
+	(
+		const position::chunk_in_world&,
+		position::chunk_in_world& region_pos,
+		std::size_t& index
+	);
+
+	/**
+	 * The inverse of region_of
+	 */
+	static position::chunk_in_world chunk_in_region(const position::chunk_in_world& region_pos, std::size_t index);
+
+	/**
+	 * Parse a chunk or region file name like 1_-2_3.ext
+	 */
+	static std::optional<position::chunk_in_world> parse_position(const fs::path&, const std::string& extension);
+
 private:
 	fs::path world_path;
 	fs::path player_dir;
+	fs::path region_dir;
+	// chunks saved before region files were used; these are loaded, but new saves go to a region file
 	fs::path chunk_dir;
 
-	fs::path chunk_path(const position::chunk_in_world&);
+	std::atomic<codec> chunk_codec;
+	std::atomic<bool> save_light;
+
+	std::atomic<uint64_t> loaded_count;
+	std::atomic<uint64_t> load_allocations;
+	std::atomic<uint64_t> load_bytes_copied;
+	/**
+	 * Decode stored (compressed) chunk bytes into the chunk and count what it cost
+	 *
+	 * @return false if the chunk was saved without its light
+	 */
+	bool decode_chunk(std::string_view stored, Chunk&);
+
+	/**
+	 * At most this many regions are kept open (unless more are in use at once); each open region holds a file descriptor
+	 */
+	static constexpr std::size_t MAX_OPEN_REGIONS = 64;
+	struct open_region
+	{
+		std::shared_ptr<region_file> file;
+		// when it was last gotten, to close the least recently used one first
+		uint64_t last_used;
+	};
+	position::unordered_map_t<position::chunk_in_world, open_region> regions;
+	uint64_t region_uses;
+	std::mutex regions_mutex;
+	/**
+	 * Open (or create) a region file
+	 * If too many regions are open, the least recently used one that is not in use is synced and closed
+	 */
+	std::shared_ptr<region_file> get_region(const position::chunk_in_world& region_pos);
+
+	/**
+	 * Which chunks are saved, so has_chunk does not touch the disk
+	 * Built by load from the region headers and the old chunk files, and updated by save_chunk
+	 */
+	position::unordered_map_t<position::chunk_in_world, std::bitset<region_file::CHUNK_COUNT>> saved_chunks;
+	std::unordered_set<position::chunk_in_world, position::hasher_struct<position::chunk_in_world>> chunk_files;
+	std::mutex index_mutex;
+	void build_index();
 };
 
 }
@@ -1,17 +1,25 @@
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <thread>
-#include <unordered_set>
-#include <vector>
+#include <stdint.h>
+#include <unordered_map>
 
-#include <concurrentqueue/concurrentqueue.hpp>
+#include "util/thread_pool.hpp"
 
 namespace block_thingy::util {
 
+/*
+ * Runs f on each enqueued thing in a thread pool (which can be shared with other ThreadThingys)
+ * A thing is not enqueued again until dequeue or drop is called for it, but a thing enqueued with low priority is moved
+ * up if it is enqueued with normal priority before it starts
+ * A cancelled thing is skipped if it has not started; if it has, f can check is_cancelled and stop early
+ */
 template
 <
 	typename T,
@@ -23,30 +31,18 @@ public:
 	ThreadThingy
 	(
 		std::function<void(T&)> f,
-		std::size_t thread_count,
+		thread_pool& pool,
 		const Hash& hash = Hash()
 	)
 	:
+		f(std::move(f)),
+		pool(pool),
 		queued(0, hash),
-		running(true)
+		running(true),
+		in_flight(0),
+		completed(0),
+		cancelled(0)
 	{
-		auto g = [this, f]()
-		{
-			while(running)
-			{
-				T thing;
-				if(things.try_dequeue(thing))
-				{
-					f(thing);
-				}
-				using namespace std::chrono_literals;
-				std::this_thread::sleep_for(10ms);
-			}
-		};
-		for(std::size_t i = 0; i < thread_count; ++i)
-		{
-			threads.emplace_back(g);
-		}
 	}
 
 	~ThreadThingy()
@@ -54,25 +50,121 @@ public:
 		stop();
 	}
 
-	void enqueue(const T& thing)
+	ThreadThingy(ThreadThingy&&) = delete;
+	ThreadThingy(const ThreadThingy&) = delete;
+	ThreadThingy& operator=(ThreadThingy&&) = delete;
+	ThreadThingy& operator=(const ThreadThingy&) = delete;
+
+	void enqueue(const T& thing, const thread_pool::priority priority = thread_pool::priority::normal)
 	{
-		bool emplaced;
+		if(!running)
+		{
+			return;
+		}
+		const bool low = priority == thread_pool::priority::low;
+		bool submit;
 		{
 			std::lock_guard<std::mutex> g(queued_mutex);
-			emplaced = queued.emplace(thing).second;
+			const auto [i, emplaced] = queued.emplace(thing, state{false, false, low});
+			state& s = i->second;
+			// wanted again before it was dropped
+			s.cancelled = false;
+			// the low priority job is still waiting; the first of the two jobs to start runs f, and the other is skipped
+			const bool promote = !emplaced && s.low && !s.started && !low;
+			if(promote)
+			{
+				s.low = false;
+			}
+			submit = emplaced || promote;
 		}
-		if(emplaced)
+		if(submit)
 		{
-			things.enqueue(thing);
+			++in_flight;
+			pool.submit([this, thing = T(thing)]() mutable
+			{
+				bool skip = false;
+				{
+					std::lock_guard<std::mutex> g(queued_mutex);
+					const auto i = queued.find(thing);
+					if(i == queued.cend() || i->second.started)
+					{
+						// the other job of a promoted thing got to it first
+						skip = true;
+					}
+					else if(i->second.cancelled)
+					{
+						queued.erase(i);
+						++cancelled;
+						skip = true;
+					}
+					else
+					{
+						i->second.started = true;
+					}
+				}
+				if(running && !skip)
+				{
+					f(thing);
+				}
+				std::lock_guard<std::mutex> g(in_flight_mutex);
+				--in_flight;
+				in_flight_cv.notify_all();
+			}, priority);
 		}
 	}
 
+	/*
+	 * Call this when the thing is done
+	 */
 	void dequeue(const T& thing)
 	{
 		std::lock_guard<std::mutex> g(queued_mutex);
 		const auto i = queued.find(thing);
 		assert(i != queued.cend());
 		queued.erase(i);
+		++completed;
+	}
+
+	/*
+	 * Call this instead of dequeue when the thing was cancelled after it started
+	 */
+	void drop(const T& thing)
+	{
+		std::lock_guard<std::mutex> g(queued_mutex);
+		queued.erase(thing);
+		++cancelled;
+	}
+
+	/*
+	 * @return false if the thing is not queued
+	 */
+	bool cancel(const T& thing)
+	{
+		std::lock_guard<std::mutex> g(queued_mutex);
+		const auto i = queued.find(thing);
+		if(i == queued.cend())
+		{
+			return false;
+		}
+		i->second.cancelled = true;
+		return true;
+	}
+
+	bool is_cancelled(const T& thing) const
+	{
+		std::lock_guard<std::mutex> g(queued_mutex);
+		const auto i = queued.find(thing);
+		return i != queued.cend() && i->second.cancelled;
+	}
+
+	uint64_t completed_count() const
+	{
+		return completed;
+	}
+
+	uint64_t cancelled_count() const
+	{
+		return cancelled;
 	}
 
 	bool has(const T& thing) const
@@ -88,24 +180,42 @@ public:
 		return queued.find(std::const_pointer_cast<T2>(thing)) != queued.cend();
 	}
 
+	/*
+	 * Things that have not started are skipped
+	 * This waits for the ones that have started, so f can safely use whatever it captured after this returns
+	 */
 	void stop()
 	{
-		if(running)
+		running = false;
+		std::unique_lock<std::mutex> lock(in_flight_mutex);
+		in_flight_cv.wait(lock, [this]()
 		{
-			running = false;
-			for(auto& thread : threads)
-			{
-				thread.join();
-			}
-		}
+			return in_flight == 0;
+		});
 	}
 
 private:
-	moodycamel::ConcurrentQueue<T> things;
-	std::unordered_set<T, Hash> queued;
+	std::function<void(T&)> f;
+	thread_pool& pool;
+	struct state
+	{
+		bool cancelled;
+		// f was called for it
+		bool started;
+		// its only job so far is a low priority one
+		bool low;
+	};
+	std::unordered_map<T, state, Hash> queued;
 	mutable std::mutex queued_mutex;
 	std::atomic<bool> running;
-	std::vector<std::thread> threads;
+
+	// submitted to the pool and not finished (including skipped)
+	std::atomic<std::size_t> in_flight;
+	std::mutex in_flight_mutex;
+	std::condition_variable in_flight_cv;
+
+	std::atomic<uint64_t> completed;
+	std::atomic<uint64_t> cancelled;
 };
 
 }
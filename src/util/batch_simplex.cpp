@@ -0,0 +1,177 @@
+#include "batch_simplex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+#ifdef __AVX__
+	#include <immintrin.h>
+#endif
+
+namespace block_thingy::util {
+
+namespace {
+
+/*
+ * simplex is written once for a lane type with these functions: double (one lane) and, with AVX, avx_lanes (4)
+ */
+inline double floor_(const double x) { return std::floor(x); }
+inline double min_(const double a, const double b) { return std::min(a, b); }
+inline double max_(const double a, const double b) { return std::max(a, b); }
+inline double abs_(const double x) { return std::abs(x); }
+// glm::step(edge, x)
+inline double step_(const double edge, const double x) { return x < edge ? 0.0 : 1.0; }
+
+#ifdef __AVX__
+struct avx_lanes
+{
+	avx_lanes(const __m256d v) : v(v) {}
+	avx_lanes(const double x) : v(_mm256_set1_pd(x)) {}
+
+	__m256d v;
+};
+static_assert(SIMPLEX_LANES == 4, "an AVX register has 4 doubles");
+
+inline avx_lanes operator+(const avx_lanes& a, const avx_lanes& b) { return _mm256_add_pd(a.v, b.v); }
+inline avx_lanes operator-(const avx_lanes& a, const avx_lanes& b) { return _mm256_sub_pd(a.v, b.v); }
+inline avx_lanes operator*(const avx_lanes& a, const avx_lanes& b) { return _mm256_mul_pd(a.v, b.v); }
+inline avx_lanes floor_(const avx_lanes& x) { return _mm256_floor_pd(x.v); }
+inline avx_lanes min_(const avx_lanes& a, const avx_lanes& b) { return _mm256_min_pd(a.v, b.v); }
+inline avx_lanes max_(const avx_lanes& a, const avx_lanes& b) { return _mm256_max_pd(a.v, b.v); }
+// clears the sign bits (-0.0 as a mask is not safe to write with -fno-signed-zeros)
+inline avx_lanes abs_(const avx_lanes& x) { return _mm256_and_pd(_mm256_castsi256_pd(_mm256_set1_epi64x(INT64_MAX)), x.v); }
+inline avx_lanes step_(const avx_lanes& edge, const avx_lanes& x)
+{
+	return _mm256_and_pd(_mm256_cmp_pd(x.v, edge.v, _CMP_GE_OQ), _mm256_set1_pd(1.0));
+}
+#endif
+
+template<typename V>
+V mod289(const V& x)
+{
+	return x - floor_(x * V(1.0 / 289.0)) * V(289.0);
+}
+
+template<typename V>
+V permute(const V& x)
+{
+	return mod289(((x * V(34.0)) + V(1.0)) * x);
+}
+
+/*
+ * glm's simplex(vec3) with the vector components as separate variables
+ */
+template<typename V>
+V simplex(const V& v_x, const V& v_y, const V& v_z)
+{
+	const V C_x(1.0 / 6.0);
+	const V C_y(1.0 / 3.0);
+	constexpr double n_ = 0.142857142857; // 1.0/7.0
+	const V ns_x(n_ * 2.0);
+	const V ns_y(n_ * 0.5 - 1.0);
+	const V ns_z(n_ * 1.0);
+	const V zero(0.0);
+	const V one(1.0);
+
+	// first corner
+	const V skew = v_x * C_y + v_y * C_y + v_z * C_y;
+	const V i_x = floor_(v_x + skew);
+	const V i_y = floor_(v_y + skew);
+	const V i_z = floor_(v_z + skew);
+	const V unskew = i_x * C_x + i_y * C_x + i_z * C_x;
+	const V x0[3]
+	{
+		v_x - i_x + unskew,
+		v_y - i_y + unskew,
+		v_z - i_z + unskew,
+	};
+
+	// other corners
+	const V g_x = step_(x0[1], x0[0]);
+	const V g_y = step_(x0[2], x0[1]);
+	const V g_z = step_(x0[0], x0[2]);
+	const V l_x = one - g_x;
+	const V l_y = one - g_y;
+	const V l_z = one - g_z;
+	const V i1[3] {min_(g_x, l_z), min_(g_y, l_x), min_(g_z, l_y)};
+	const V i2[3] {max_(g_x, l_z), max_(g_y, l_x), max_(g_z, l_y)};
+
+	// for each corner: its offset from the first, and the point's offset from it
+	const V offset[4][3]
+	{
+		{zero, zero, zero},
+		{i1[0], i1[1], i1[2]},
+		{i2[0], i2[1], i2[2]},
+		{one, one, one},
+	};
+	const V x[4][3]
+	{
+		{x0[0], x0[1], x0[2]},
+		{x0[0] - i1[0] + C_x, x0[1] - i1[1] + C_x, x0[2] - i1[2] + C_x},
+		{x0[0] - i2[0] + C_y, x0[1] - i2[1] + C_y, x0[2] - i2[2] + C_y},
+		{x0[0] - V(0.5), x0[1] - V(0.5), x0[2] - V(0.5)},
+	};
+
+	// permutations
+	const V cell_x = mod289(i_x);
+	const V cell_y = mod289(i_y);
+	const V cell_z = mod289(i_z);
+
+	V noise = zero;
+	for(std::size_t corner = 0; corner < 4; ++corner)
+	{
+		const V* o = offset[corner];
+		const V* xc = x[corner];
+		const V p = permute(permute(permute(
+			cell_z + o[2]) +
+			cell_y + o[1]) +
+			cell_x + o[0]);
+
+		// gradients: 7x7 points over a square, mapped onto an octahedron
+		const V j = p - V(49.0) * floor_(p * ns_z * ns_z);
+		const V x_ = floor_(j * ns_z);
+		const V y_ = floor_(j - V(7.0) * x_);
+		const V gx = x_ * ns_x + ns_y;
+		const V gy = y_ * ns_x + ns_y;
+		const V h = one - abs_(gx) - abs_(gy);
+		const V sh = zero - step_(h, zero);
+		V p_x = gx + (floor_(gx) * V(2.0) + one) * sh;
+		V p_y = gy + (floor_(gy) * V(2.0) + one) * sh;
+		V p_z = h;
+
+		// normalize the gradient
+		const V norm = V(1.79284291400159) - V(0.85373472095314) * (p_x * p_x + p_y * p_y + p_z * p_z);
+		p_x = p_x * norm;
+		p_y = p_y * norm;
+		p_z = p_z * norm;
+
+		// mix the final noise value
+		V m = max_(V(0.6) - (xc[0] * xc[0] + xc[1] * xc[1] + xc[2] * xc[2]), zero);
+		m = m * m;
+		noise = noise + m * m * (p_x * xc[0] + p_y * xc[1] + p_z * xc[2]);
+	}
+	return V(42.0) * noise;
+}
+
+}
+
+void batch_simplex
+(
+	const double (&x)[SIMPLEX_LANES],
+	const double (&y)[SIMPLEX_LANES],
+	const double (&z)[SIMPLEX_LANES],
+	double (&out)[SIMPLEX_LANES]
+)
+{
+#ifdef __AVX__
+	const avx_lanes noise = simplex<avx_lanes>(_mm256_loadu_pd(x), _mm256_loadu_pd(y), _mm256_loadu_pd(z));
+	_mm256_storeu_pd(out, noise.v);
+#else
+	for(std::size_t lane = 0; lane < SIMPLEX_LANES; ++lane)
+	{
+		out[lane] = simplex<double>(x[lane], y[lane], z[lane]);
+	}
+#endif
+}
+
+}
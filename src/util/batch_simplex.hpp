@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+namespace block_thingy::util {
+
+// one AVX register of doubles
+constexpr std::size_t SIMPLEX_LANES = 4;
+
+/*
+ * glm::simplex of SIMPLEX_LANES 3D points at once
+ * With AVX (which -march=native enables where the CPU has it), the lanes go through glm's arithmetic together in
+ * vector registers; otherwise, one at a time. Both give the same bits, since multiplies and adds are not fused
+ * (-ffp-contract=off), so terrain made on one CPU is made again the same on another.
+ */
+void batch_simplex
+(
+	const double (&x)[SIMPLEX_LANES],
+	const double (&y)[SIMPLEX_LANES],
+	const double (&z)[SIMPLEX_LANES],
+	double (&out)[SIMPLEX_LANES]
+);
+
+}
@@ -0,0 +1,297 @@
+#include "positional_file.hpp"
+
+#ifdef HAVE_POSIX
+	#include <cerrno>
+	#include <cstring>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#elif defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using std::string;
+
+namespace block_thingy::util {
+
+#ifdef HAVE_POSIX
+static string error_string()
+{
+	return std::strerror(errno);
+}
+#elif defined(_WIN32)
+static string error_string()
+{
+	return "error " + std::to_string(GetLastError());
+}
+#endif
+
+mapped_view::mapped_view()
+:
+	base(nullptr),
+	base_size(0),
+	offset(0),
+	size_(0)
+{
+}
+
+mapped_view::~mapped_view()
+{
+	unmap();
+}
+
+mapped_view::mapped_view(mapped_view&& that)
+:
+	base(that.base),
+	base_size(that.base_size),
+	offset(that.offset),
+	size_(that.size_)
+{
+	that.base = nullptr;
+	that.base_size = 0;
+	that.size_ = 0;
+}
+
+mapped_view& mapped_view::operator=(mapped_view&& that)
+{
+	if(this != &that)
+	{
+		unmap();
+		base = that.base;
+		base_size = that.base_size;
+		offset = that.offset;
+		size_ = that.size_;
+		that.base = nullptr;
+		that.base_size = 0;
+		that.size_ = 0;
+	}
+	return *this;
+}
+
+const char* mapped_view::data() const
+{
+	return static_cast<const char*>(base) + offset;
+}
+
+std::size_t mapped_view::size() const
+{
+	return size_;
+}
+
+void mapped_view::unmap()
+{
+	if(base == nullptr)
+	{
+		return;
+	}
+#ifdef HAVE_POSIX
+	::munmap(base, base_size);
+#elif defined(_WIN32)
+	UnmapViewOfFile(base);
+#endif
+	base = nullptr;
+}
+
+positional_file::positional_file(const fs::path& path)
+:
+	path_(path)
+{
+#ifdef HAVE_POSIX
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if(fd == -1)
+	{
+		throw std::runtime_error("error opening " + path.u8string() + ": " + error_string());
+	}
+#elif defined(_WIN32)
+	handle = CreateFileW
+	(
+		path.c_str(),
+		GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_ALWAYS,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	);
+	if(handle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("error opening " + path.u8string() + ": " + error_string());
+	}
+#endif
+}
+
+positional_file::~positional_file()
+{
+#ifdef HAVE_POSIX
+	::close(fd);
+#elif defined(_WIN32)
+	CloseHandle(handle);
+#endif
+}
+
+string positional_file::read(const uint64_t offset, const std::size_t size) const
+{
+	string s(size, '\0');
+	read(offset, s.data(), size);
+	return s;
+}
+
+void positional_file::read(uint64_t offset, char* buf, std::size_t size) const
+{
+	while(size > 0)
+	{
+	#ifdef HAVE_POSIX
+		const ssize_t n = ::pread(fd, buf, size, static_cast<off_t>(offset));
+		if(n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			throw std::runtime_error("error reading " + path_.u8string() + ": " + (n == 0 ? "unexpected end of file" : error_string()));
+		}
+	#elif defined(_WIN32)
+		OVERLAPPED o{};
+		o.Offset = static_cast<DWORD>(offset);
+		o.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD n = 0;
+		const DWORD want = static_cast<DWORD>(std::min<std::size_t>(size, 1u << 30));
+		if(!ReadFile(handle, buf, want, &n, &o) || n == 0)
+		{
+			throw std::runtime_error("error reading " + path_.u8string() + ": " + (n == 0 ? "unexpected end of file" : error_string()));
+		}
+	#endif
+		buf += n;
+		offset += static_cast<uint64_t>(n);
+		size -= static_cast<std::size_t>(n);
+	}
+}
+
+mapped_view positional_file::map(const uint64_t offset, const std::size_t size) const
+{
+	if(size == 0)
+	{
+		throw std::invalid_argument("positional_file::map: size is 0");
+	}
+	mapped_view view;
+#ifdef HAVE_POSIX
+	static const uint64_t alignment = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+	const uint64_t start = offset - offset % alignment;
+	view.offset = static_cast<std::size_t>(offset - start);
+	view.base_size = view.offset + size;
+	void* p = ::mmap(nullptr, view.base_size, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(start));
+	if(p == MAP_FAILED)
+	{
+		throw std::runtime_error("error mapping " + path_.u8string() + ": " + error_string());
+	}
+	view.base = p;
+#elif defined(_WIN32)
+	static const uint64_t alignment = []()
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return static_cast<uint64_t>(info.dwAllocationGranularity);
+	}();
+	const uint64_t start = offset - offset % alignment;
+	view.offset = static_cast<std::size_t>(offset - start);
+	view.base_size = view.offset + size;
+	HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping == nullptr)
+	{
+		throw std::runtime_error("error mapping " + path_.u8string() + ": " + error_string());
+	}
+	void* p = MapViewOfFile(mapping, FILE_MAP_READ, static_cast<DWORD>(start >> 32), static_cast<DWORD>(start), view.base_size);
+	// the view keeps the mapping open
+	CloseHandle(mapping);
+	if(p == nullptr)
+	{
+		throw std::runtime_error("error mapping " + path_.u8string() + ": " + error_string());
+	}
+	view.base = p;
+#endif
+	view.size_ = size;
+	return view;
+}
+
+void positional_file::write(const uint64_t offset, const string& s)
+{
+	write(offset, s.data(), s.size());
+}
+
+void positional_file::write(uint64_t offset, const char* buf, std::size_t size)
+{
+	while(size > 0)
+	{
+	#ifdef HAVE_POSIX
+		const ssize_t n = ::pwrite(fd, buf, size, static_cast<off_t>(offset));
+		if(n == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			throw std::runtime_error("error writing " + path_.u8string() + ": " + error_string());
+		}
+	#elif defined(_WIN32)
+		OVERLAPPED o{};
+		o.Offset = static_cast<DWORD>(offset);
+		o.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD n = 0;
+		const DWORD want = static_cast<DWORD>(std::min<std::size_t>(size, 1u << 30));
+		if(!WriteFile(handle, buf, want, &n, &o))
+		{
+			throw std::runtime_error("error writing " + path_.u8string() + ": " + error_string());
+		}
+	#endif
+		buf += n;
+		offset += static_cast<uint64_t>(n);
+		size -= static_cast<std::size_t>(n);
+	}
+}
+
+void positional_file::sync()
+{
+#ifdef HAVE_POSIX
+	if(::fsync(fd) == -1)
+	{
+		throw std::runtime_error("error syncing " + path_.u8string() + ": " + error_string());
+	}
+#elif defined(_WIN32)
+	if(!FlushFileBuffers(handle))
+	{
+		throw std::runtime_error("error syncing " + path_.u8string() + ": " + error_string());
+	}
+#endif
+}
+
+uint64_t positional_file::size() const
+{
+#ifdef HAVE_POSIX
+	struct stat st;
+	if(::fstat(fd, &st) == -1)
+	{
+		throw std::runtime_error("error reading size of " + path_.u8string() + ": " + error_string());
+	}
+	return static_cast<uint64_t>(st.st_size);
+#elif defined(_WIN32)
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(handle, &size))
+	{
+		throw std::runtime_error("error reading size of " + path_.u8string() + ": " + error_string());
+	}
+	return static_cast<uint64_t>(size.QuadPart);
+#endif
+}
+
+const fs::path& positional_file::path() const
+{
+	return path_;
+}
+
+}
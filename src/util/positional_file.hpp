@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+#include "util/filesystem.hpp"
+
+namespace block_thingy::util {
+
+/*
+ * A read-only memory mapping of part of a file (see positional_file::map)
+ */
+class mapped_view
+{
+public:
+	mapped_view();
+	~mapped_view();
+
+	mapped_view(mapped_view&&);
+	mapped_view& operator=(mapped_view&&);
+
+	mapped_view(const mapped_view&) = delete;
+	mapped_view& operator=(const mapped_view&) = delete;
+
+	const char* data() const;
+	std::size_t size() const;
+
+private:
+	friend class positional_file;
+
+	// the mapping starts at an aligned offset, which can be before the requested part
+	void* base;
+	std::size_t base_size;
+	std::size_t offset;
+	std::size_t size_;
+
+	void unmap();
+};
+
+/*
+ * A file that is read and written at explicit offsets (pread/pwrite), without a shared file position
+ * Reads and writes from different threads do not interfere, as long as they do not overlap
+ */
+class positional_file
+{
+public:
+	/*
+	 * Opens the file for reading and writing, creating it if it does not exist
+	 */
+	explicit positional_file(const fs::path&);
+	~positional_file();
+
+	positional_file(positional_file&&) = delete;
+	positional_file(const positional_file&) = delete;
+	positional_file& operator=(positional_file&&) = delete;
+	positional_file& operator=(const positional_file&) = delete;
+
+	/*
+	 * Throws if fewer than size bytes can be read
+	 */
+	std::string read(uint64_t offset, std::size_t size) const;
+	void read(uint64_t offset, char* buf, std::size_t size) const;
+
+	/*
+	 * Map part of the file into memory instead of copying it
+	 * The part must be inside the file; writes to it are seen through the view
+	 */
+	mapped_view map(uint64_t offset, std::size_t size) const;
+
+	void write(uint64_t offset, const std::string&);
+	void write(uint64_t offset, const char* buf, std::size_t size);
+
+	/*
+	 * Wait until the data written so far is on the disk
+	 */
+	void sync();
+
+	uint64_t size() const;
+
+	const fs::path& path() const;
+
+private:
+	fs::path path_;
+#ifdef _WIN32
+	void* handle;
+#else
+	int fd;
+#endif
+};
+
+}
@@ -0,0 +1,198 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace block_thingy::util {
+
+namespace {
+
+struct worker_queue
+{
+	std::mutex mutex;
+	std::deque<thread_pool::job_t> jobs;
+};
+
+// which pool and worker the current thread is, for submitting from inside a job
+thread_local const void* current_pool = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}
+
+struct thread_pool::impl
+{
+	explicit impl(std::size_t thread_count);
+
+	impl(impl&&) = delete;
+	impl(const impl&) = delete;
+	impl& operator=(impl&&) = delete;
+	impl& operator=(const impl&) = delete;
+
+	void work(std::size_t self);
+	bool try_pop(std::size_t self, job_t&);
+
+	std::vector<std::unique_ptr<worker_queue>> queues;
+	// normal jobs submitted from outside the pool, taken from the front
+	worker_queue shared_queue;
+	// taken from the front once there is no normal job
+	worker_queue low_queue;
+	std::vector<std::thread> threads;
+
+	// jobs submitted and not yet taken by a worker (of either priority)
+	std::atomic<std::size_t> pending;
+	std::atomic<bool> running;
+	std::mutex park_mutex;
+	std::condition_variable park_cv;
+};
+
+thread_pool::impl::impl(std::size_t thread_count)
+:
+	pending(0),
+	running(true)
+{
+	if(thread_count == 0)
+	{
+		// hardware_concurrency may return 0 when it does not know
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	for(std::size_t i = 0; i < thread_count; ++i)
+	{
+		queues.emplace_back(std::make_unique<worker_queue>());
+	}
+	for(std::size_t i = 0; i < thread_count; ++i)
+	{
+		threads.emplace_back(&impl::work, this, i);
+	}
+}
+
+void thread_pool::impl::work(const std::size_t self)
+{
+	current_pool = this;
+	current_worker = self;
+
+	job_t job;
+	while(true)
+	{
+		if(try_pop(self, job))
+		{
+			--pending;
+			job();
+			job = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(park_mutex);
+		park_cv.wait(lock, [this]()
+		{
+			return pending != 0 || !running;
+		});
+		if(!running && pending == 0)
+		{
+			return;
+		}
+	}
+}
+
+bool thread_pool::impl::try_pop(const std::size_t self, job_t& job)
+{
+	{
+		worker_queue& own = *queues[self];
+		std::lock_guard<std::mutex> g(own.mutex);
+		if(!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			return true;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> g(shared_queue.mutex);
+		if(!shared_queue.jobs.empty())
+		{
+			job = std::move(shared_queue.jobs.front());
+			shared_queue.jobs.pop_front();
+			return true;
+		}
+	}
+	for(std::size_t i = 1; i < queues.size(); ++i)
+	{
+		worker_queue& other = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> g(other.mutex);
+		if(!other.jobs.empty())
+		{
+			job = std::move(other.jobs.front());
+			other.jobs.pop_front();
+			return true;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> g(low_queue.mutex);
+		if(!low_queue.jobs.empty())
+		{
+			job = std::move(low_queue.jobs.front());
+			low_queue.jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+thread_pool::thread_pool(const std::size_t thread_count)
+:
+	pImpl(std::make_unique<impl>(thread_count))
+{
+}
+
+thread_pool::~thread_pool()
+{
+	stop();
+}
+
+void thread_pool::submit(job_t job, const priority job_priority)
+{
+	{
+		// counted before it is pushed, so that a worker that takes it right away does not take pending below 0
+		// locked so that a worker can not miss this between checking pending and waiting
+		std::lock_guard<std::mutex> g(pImpl->park_mutex);
+		++pImpl->pending;
+	}
+	{
+		worker_queue& queue
+			= (job_priority == priority::low) ? pImpl->low_queue
+			: (current_pool == pImpl.get()) ? *pImpl->queues[current_worker]
+			: pImpl->shared_queue;
+		std::lock_guard<std::mutex> g(queue.mutex);
+		queue.jobs.emplace_back(std::move(job));
+	}
+	pImpl->park_cv.notify_one();
+}
+
+std::size_t thread_pool::thread_count() const
+{
+	return pImpl->threads.size();
+}
+
+void thread_pool::stop()
+{
+	{
+		std::lock_guard<std::mutex> g(pImpl->park_mutex);
+		if(!pImpl->running)
+		{
+			return;
+		}
+		pImpl->running = false;
+	}
+	pImpl->park_cv.notify_all();
+	for(auto& thread : pImpl->threads)
+	{
+		thread.join();
+	}
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include "shim/propagate_const.hpp"
+
+namespace block_thingy::util {
+
+/*
+ * Each worker has its own deque of the jobs submitted from its jobs, and jobs submitted from other threads wait in one
+ * shared queue, so that they start in the order they were submitted
+ * A worker takes the newest job from its own deque, then the oldest job from the shared queue, and then steals the
+ * oldest job from another worker
+ * Low priority jobs wait in another shared queue, oldest first, and are taken only when there is no normal job
+ * Workers with nothing to do sleep until a job is submitted
+ */
+class thread_pool
+{
+public:
+	/*
+	 * thread_count = 0 means std::thread::hardware_concurrency()
+	 */
+	explicit thread_pool(std::size_t thread_count = 0);
+	~thread_pool();
+
+	thread_pool(thread_pool&&) = delete;
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(thread_pool&&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	using job_t = std::function<void()>;
+
+	enum class priority
+	{
+		normal,
+		low, // for work that is only wanted ahead of time, such as prefetching
+	};
+
+	/*
+	 * Normal jobs submitted from a worker go to that worker's deque
+	 */
+	void submit(job_t, priority = priority::normal);
+
+	std::size_t thread_count() const;
+
+	/*
+	 * Runs the jobs that are already submitted, then joins the workers
+	 */
+	void stop();
+
+private:
+	struct impl;
+	std::propagate_const<std::unique_ptr<impl>> pImpl;
+};
+
+}
@@ -0,0 +1,208 @@
+#include "chunk_light.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <stdint.h>
+
+#include "block/component/info.hpp"
+#include "chunk/Chunk.hpp"
+#include "graphics/color.hpp"
+#include "position/block_in_chunk.hpp"
+
+namespace block_thingy::world {
+
+using position::block_in_chunk;
+
+// change this when the way light spreads changes, so saved light is not trusted
+constexpr uint64_t LIGHT_VERSION = 1;
+
+/*
+ * @return false if pos + offset is outside of the chunk
+ */
+static bool offset_in_chunk(const block_in_chunk& pos, const int8_t x, const int8_t y, const int8_t z, block_in_chunk& out)
+{
+	const int_fast32_t x2 = pos.x + x;
+	const int_fast32_t y2 = pos.y + y;
+	const int_fast32_t z2 = pos.z + z;
+	if(x2 < 0 || x2 >= CHUNK_SIZE
+	|| y2 < 0 || y2 >= CHUNK_SIZE
+	|| z2 < 0 || z2 >= CHUNK_SIZE)
+	{
+		return false;
+	}
+	#define s(a) static_cast<block_in_chunk::value_type>(a)
+	out = block_in_chunk(s(x2), s(y2), s(z2));
+	#undef s
+	return true;
+}
+
+/*
+ * @return false if the light does not go into the block
+ */
+static bool filter_light(const block::component::info& info, const block_t block, graphics::color& color)
+{
+	if(info.is_opaque(block))
+	{
+		return false;
+	}
+	if(info.is_translucent(block))
+	{
+		const graphics::color f = info.light_filter(block);
+		color.r = std::min(color.r, f.r);
+		color.g = std::min(color.g, f.g);
+		color.b = std::min(color.b, f.b);
+	}
+	return true;
+}
+
+/*
+ * @return true if any channel was raised
+ */
+static bool raise(graphics::color& current, const graphics::color& color)
+{
+	bool set = false;
+	if(current.r < color.r) { current.r = color.r; set = true; }
+	if(current.g < color.g) { current.g = color.g; set = true; }
+	if(current.b < color.b) { current.b = color.b; set = true; }
+	return set;
+}
+
+static void spread_blocklight(Chunk& chunk, const block::component::info& info)
+{
+	std::deque<block_in_chunk> queue;
+
+	block_in_chunk pos;
+	for(pos.x = 0; pos.x < CHUNK_SIZE; ++pos.x)
+	for(pos.y = 0; pos.y < CHUNK_SIZE; ++pos.y)
+	for(pos.z = 0; pos.z < CHUNK_SIZE; ++pos.z)
+	{
+		const graphics::color light = info.light(chunk.get_block(pos));
+		if(light != 0)
+		{
+			chunk.set_blocklight(pos, light);
+			queue.emplace_back(pos);
+		}
+	}
+
+	while(!queue.empty())
+	{
+		const block_in_chunk pos = queue.front();
+		queue.pop_front();
+
+		const graphics::color color = chunk.get_blocklight(pos) - 1;
+		if(color == 0)
+		{
+			continue;
+		}
+
+		auto fill = [&chunk, &info, &queue, &pos](const int8_t x, const int8_t y, const int8_t z, graphics::color color)
+		{
+			block_in_chunk pos2;
+			if(!offset_in_chunk(pos, x, y, z, pos2)
+			|| !filter_light(info, chunk.get_block(pos2), color))
+			{
+				return;
+			}
+			graphics::color color2 = chunk.get_blocklight(pos2);
+			if(raise(color2, color))
+			{
+				chunk.set_blocklight(pos2, color2);
+				queue.emplace_back(pos2);
+			}
+		};
+
+		fill( 0,  0, -1, color);
+		fill( 0,  0, +1, color);
+		fill( 0, -1,  0, color);
+		fill( 0, +1,  0, color);
+		fill(-1,  0,  0, color);
+		fill(+1,  0,  0, color);
+	}
+}
+
+static void spread_skylight(Chunk& chunk, const block::component::info& info, const graphics::color& skylight_color)
+{
+	std::deque<block_in_chunk> queue;
+
+	// TODO: handle skylight being blocked by above chunks
+	// currently, every chunk has skylight emitted at the top
+	block_in_chunk pos(0, CHUNK_SIZE - 1, 0);
+	for(pos.x = 0; pos.x < CHUNK_SIZE; ++pos.x)
+	for(pos.z = 0; pos.z < CHUNK_SIZE; ++pos.z)
+	{
+		graphics::color light = skylight_color;
+		if(!filter_light(info, chunk.get_block(pos), light))
+		{
+			light = 0;
+		}
+		chunk.set_skylight(pos, light);
+		queue.emplace_back(pos);
+	}
+
+	while(!queue.empty())
+	{
+		const block_in_chunk pos = queue.front();
+		queue.pop_front();
+
+		const graphics::color color = chunk.get_skylight(pos);
+		const graphics::color color1 = color - 1;
+
+		auto fill = [&chunk, &info, &queue, &pos](const int8_t x, const int8_t y, const int8_t z, graphics::color color)
+		{
+			block_in_chunk pos2;
+			if(color == 0
+			|| !offset_in_chunk(pos, x, y, z, pos2)
+			|| !filter_light(info, chunk.get_block(pos2), color))
+			{
+				return;
+			}
+			graphics::color color2 = chunk.get_skylight(pos2);
+			if(raise(color2, color))
+			{
+				chunk.set_skylight(pos2, color2);
+				queue.emplace_back(pos2);
+			}
+		};
+
+		fill( 0,  0, -1, color1);
+		fill( 0,  0, +1, color1);
+		// see world::impl::process_skylight_add
+		fill( 0, -1,  0, (color == skylight_color) ? color : color1);
+		fill( 0, +1,  0, color1);
+		fill(-1,  0,  0, color1);
+		fill(+1,  0,  0, color1);
+	}
+}
+
+void light_chunk
+(
+	Chunk& chunk,
+	const block::component::info& info,
+	const graphics::color& skylight_color
+)
+{
+	spread_blocklight(chunk, info);
+	spread_skylight(chunk, info, skylight_color);
+}
+
+uint32_t light_stamp
+(
+	const block::component::info& info,
+	const graphics::color& skylight_color
+)
+{
+	uint64_t hash = info.light_hash();
+	hash ^= LIGHT_VERSION << 56;
+	hash ^= static_cast<uint64_t>(skylight_color.r)
+		| (static_cast<uint64_t>(skylight_color.g) << 8)
+		| (static_cast<uint64_t>(skylight_color.b) << 16)
+		| (static_cast<uint64_t>(graphics::color::max) << 24);
+	// mix the high bits into the low ones
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDu;
+	hash ^= hash >> 33;
+	const auto stamp = static_cast<uint32_t>(hash);
+	return stamp != 0 ? stamp : 1;
+}
+
+}
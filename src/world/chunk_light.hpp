@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "fwd/block/component/info.hpp"
+#include "fwd/chunk/Chunk.hpp"
+#include "fwd/graphics/color.hpp"
+
+namespace block_thingy::world {
+
+/*
+ * Spread block light and skylight inside a new chunk before it is added to the world
+ * This uses the same rules as the world's light propagation, but stops at the sides of the chunk
+ * The world continues the light into the neighboring chunks when the chunk is added
+ */
+void light_chunk
+(
+	Chunk&,
+	const block::component::info&,
+	const graphics::color& skylight_color
+);
+
+/*
+ * Identifies the rules light_chunk and the world's light propagation follow (this code, the block light properties,
+ * and the skylight color), so light saved with one stamp can be trusted while the stamp is the same
+ * Never 0
+ */
+uint32_t light_stamp
+(
+	const block::component::info&,
+	const graphics::color& skylight_color
+);
+
+}
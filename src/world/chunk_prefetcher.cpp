@@ -0,0 +1,167 @@
+#include "chunk_prefetcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "position/block_in_world.hpp"
+#include "world/view_sphere.hpp"
+
+namespace block_thingy::world {
+
+using position::block_in_world;
+using position::chunk_in_world;
+
+// the lookahead when nothing has been prefetched yet
+constexpr double START_LOOKAHEAD = 1;
+// once for each tick with a late hit, or with waste and no late hit
+constexpr double LOOKAHEAD_GROWTH = 1.1;
+constexpr double LOOKAHEAD_SHRINK = 0.98;
+// how far the chunks in front of where the player looks are moved up (and those behind moved back)
+constexpr double LOOK_WEIGHT = 0.25;
+// the most points along the path, for when the player is very fast (such as falling for a long time)
+constexpr std::size_t MAX_PATH_STEPS = 64;
+
+chunk_prefetcher::chunk_prefetcher()
+:
+	lookahead(START_LOOKAHEAD),
+	stats()
+{
+}
+
+void chunk_prefetcher::plan
+(
+	const glm::dvec3& view_position,
+	const glm::dvec3& velocity,
+	const glm::dvec3& look,
+	const view_sphere& sphere,
+	std::vector<chunk_in_world>& planned
+) const
+{
+	const double speed = glm::length(velocity);
+	if(speed < MIN_SPEED)
+	{
+		return;
+	}
+
+	// a point every half chunk, so that no chunk the path goes thru is missed
+	const double path_length = speed * lookahead;
+	const auto steps = std::min
+	(
+		static_cast<std::size_t>(std::ceil(path_length / (CHUNK_SIZE / 2.0))),
+		MAX_PATH_STEPS
+	);
+	const auto render_distance = sphere.get_render_distance();
+	const std::size_t first = planned.size();
+	const chunk_in_world start{block_in_world(view_position)};
+	chunk_in_world prev = start;
+	position::unordered_set_t<chunk_in_world> added;
+	for(std::size_t i = 1; i <= steps; ++i)
+	{
+		const double t = lookahead * static_cast<double>(i) / static_cast<double>(steps);
+		const chunk_in_world center(block_in_world(view_position + velocity * t));
+		if(center == prev)
+		{
+			continue;
+		}
+		for(const chunk_in_world& offset : sphere.get_offsets())
+		{
+			const chunk_in_world pos = center + offset;
+			// wanted already, or near the point before (so most likely added for it)
+			if(view_sphere::contains(pos - start, render_distance)
+			|| view_sphere::contains(pos - prev, render_distance))
+			{
+				continue;
+			}
+			if(added.emplace(pos).second)
+			{
+				planned.emplace_back(pos);
+			}
+		}
+		prev = center;
+	}
+
+	const auto key = [&view_position, &look](const chunk_in_world& pos)
+	{
+		const glm::dvec3 center = (glm::dvec3(chunk_in_world::vec_type(pos)) + 0.5) * static_cast<double>(CHUNK_SIZE);
+		return view_weighted_distance(center - view_position, look, LOOK_WEIGHT);
+	};
+	const auto nearer = [&key](const chunk_in_world& a, const chunk_in_world& b)
+	{
+		return key(a) < key(b);
+	};
+	const auto begin = planned.begin() + static_cast<std::ptrdiff_t>(first);
+	if(planned.size() - first > MAX_PLANNED)
+	{
+		const auto end = begin + static_cast<std::ptrdiff_t>(MAX_PLANNED);
+		std::nth_element(begin, end, planned.end(), nearer);
+		planned.erase(end, planned.end());
+	}
+	std::sort(begin, planned.end(), nearer);
+}
+
+void chunk_prefetcher::requested(const chunk_in_world& pos)
+{
+	prefetched.emplace(pos);
+	++stats.requested;
+}
+
+void chunk_prefetcher::update
+(
+	const position::unordered_set_t<chunk_in_world>& active,
+	const position::unordered_set_t<chunk_in_world>& planned,
+	const std::function<bool(const chunk_in_world&)>& in_world
+)
+{
+	bool any_late = false;
+	bool any_wasted = false;
+	for(auto i = prefetched.begin(); i != prefetched.end();)
+	{
+		const chunk_in_world& pos = *i;
+		if(active.count(pos) != 0)
+		{
+			++stats.hits;
+			if(!in_world(pos))
+			{
+				++stats.late;
+				any_late = true;
+			}
+		}
+		else if(planned.count(pos) == 0)
+		{
+			++stats.wasted;
+			any_wasted = true;
+		}
+		else
+		{
+			++i;
+			continue;
+		}
+		i = prefetched.erase(i);
+	}
+
+	if(any_late)
+	{
+		lookahead = std::min(lookahead * LOOKAHEAD_GROWTH, MAX_LOOKAHEAD);
+	}
+	else if(any_wasted)
+	{
+		lookahead = std::max(lookahead * LOOKAHEAD_SHRINK, MIN_LOOKAHEAD);
+	}
+}
+
+double chunk_prefetcher::get_lookahead() const
+{
+	return lookahead;
+}
+
+prefetch_stats chunk_prefetcher::get_stats() const
+{
+	prefetch_stats stats = this->stats;
+	stats.lookahead_seconds = lookahead;
+	return stats;
+}
+
+}
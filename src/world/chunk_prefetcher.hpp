@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "fwd/world/view_sphere.hpp"
+
+namespace block_thingy::world {
+
+struct prefetch_stats
+{
+	// chunks queued to load or generate ahead of a player
+	uint64_t requested;
+	// of those, the ones that came within render distance of a player
+	uint64_t hits;
+	// of the hits, the ones that were not in the world yet when they did
+	uint64_t late;
+	// the ones that were unloaded or cancelled without coming within render distance
+	uint64_t wasted;
+	double lookahead_seconds;
+};
+
+/*
+ * Decides which chunks past the render distance to load or generate ahead of a moving player, and counts how many of
+ * them were used
+ *
+ * The chunks wanted over the next lookahead seconds are those in the view sphere around each point of the player's
+ * path, going at their current velocity. The lookahead grows when prefetched chunks are still not in the world when
+ * the player reaches them, and shrinks when prefetched chunks are wasted (the player turned or stopped).
+ */
+class chunk_prefetcher
+{
+public:
+	static constexpr double MIN_LOOKAHEAD = 0.25;
+	static constexpr double MAX_LOOKAHEAD = 4;
+	// blocks per second; slower than this, the chunks within render distance load in time
+	static constexpr double MIN_SPEED = 4;
+	// for each player
+	static constexpr std::size_t MAX_PLANNED = 1024;
+
+	chunk_prefetcher();
+
+	/*
+	 * Add the chunks a player will want within the lookahead (those in the view sphere around each point of their
+	 * path) that are not in the view sphere around them now, nearest first, with the chunks in front of where they look
+	 * before the chunks behind
+	 * velocity is in blocks per second, and look is a unit vector
+	 */
+	void plan
+	(
+		const glm::dvec3& view_position,
+		const glm::dvec3& velocity,
+		const glm::dvec3& look,
+		const view_sphere&,
+		std::vector<position::chunk_in_world>& planned
+	) const;
+
+	/*
+	 * A planned chunk that was queued (it was not in the world or queued already)
+	 */
+	void requested(const position::chunk_in_world&);
+
+	/*
+	 * Call this each tick, after planning
+	 * Prefetched chunks that are now active are hits, and those that are neither active nor planned are wasted
+	 * planned should include the chunks that are kept for a while after they were last planned, so that only the ones
+	 * that are let go are counted as wasted
+	 */
+	void update
+	(
+		const position::unordered_set_t<position::chunk_in_world>& active,
+		const position::unordered_set_t<position::chunk_in_world>& planned,
+		const std::function<bool(const position::chunk_in_world&)>& in_world
+	);
+
+	double get_lookahead() const;
+	prefetch_stats get_stats() const;
+
+private:
+	double lookahead;
+	// requested and not yet a hit or wasted
+	position::unordered_set_t<position::chunk_in_world> prefetched;
+	prefetch_stats stats;
+};
+
+}
@@ -0,0 +1,29 @@
+#include "chunk_stage.hpp"
+
+#include <cassert>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+namespace block_thingy::world {
+
+std::ostream& operator<<(std::ostream& o, const chunk_stage s)
+{
+	switch(s)
+	{
+		case chunk_stage::load     : return o << "load";
+		case chunk_stage::generate : return o << "generate";
+		case chunk_stage::light    : return o << "light";
+		case chunk_stage::integrate: return o << "integrate";
+		case chunk_stage::neighbors: return o << "neighbors";
+		case chunk_stage::mesh     : return o << "mesh";
+		case chunk_stage::upload   : return o << "upload";
+		case chunk_stage::ready    : return o << "ready";
+	}
+	assert(false);
+	// to satisfy -Werror
+	const auto i = static_cast<std::underlying_type_t<chunk_stage>>(s);
+	return o << "ERROR(" << std::to_string(i) << ')';
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iosfwd>
+#include <stdint.h>
+
+namespace block_thingy::world {
+
+/*
+ * The stages a chunk goes thru before it is drawn, in order
+ * A chunk skips light if it was loaded (its light is saved with it)
+ */
+enum class chunk_stage : uint8_t
+{
+	load,      // queued for or being loaded from the world file
+	generate,  // queued for or being generated
+	light,     // light inside the chunk is being spread (on a worker)
+	integrate, // waiting for world::step to add it to the world
+	neighbors, // in the world, waiting for its neighbors so that it is not meshed twice
+	mesh,      // queued for or being meshed
+	upload,    // meshed, waiting to be drawn for the first time
+	ready,
+};
+constexpr std::size_t CHUNK_STAGE_COUNT = 8;
+
+using chunk_stage_counts_t = std::array<uint64_t, CHUNK_STAGE_COUNT>;
+
+std::ostream& operator<<(std::ostream&, chunk_stage);
+
+}
@@ -0,0 +1,149 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <type_traits>
+
+#include "block/manager.hpp"
+
+using std::shared_ptr;
+
+namespace block_thingy::world {
+
+using position::block_in_chunk;
+using position::chunk_in_world;
+
+std::ostream& operator<<(std::ostream& o, const generator_stage s)
+{
+	switch(s)
+	{
+		case generator_stage::density   : return o << "density";
+		case generator_stage::surface   : return o << "surface";
+		case generator_stage::decoration: return o << "decoration";
+	}
+	assert(false);
+	// to satisfy -Werror
+	const auto i = static_cast<std::underlying_type_t<generator_stage>>(s);
+	return o << "ERROR(" << std::to_string(i) << ')';
+}
+
+static std::size_t block_index(const block_in_chunk& pos)
+{
+	constexpr auto size = static_cast<std::size_t>(CHUNK_SIZE);
+	// the same order as chunk_data
+	return size * size * pos.x + size * pos.y + pos.z;
+}
+
+gen_buffer::gen_buffer
+(
+	const chunk_in_world& chunk_pos,
+	const double seed,
+	const block::manager& block_manager
+)
+:
+	chunk_pos(chunk_pos),
+	seed(seed),
+	block_manager(block_manager),
+	air(block_manager.get_block("air").value_or(block_t()))
+{
+}
+
+block_t gen_buffer::get(const block_in_chunk& pos) const
+{
+	return blocks == nullptr ? air : (*blocks)[block_index(pos)];
+}
+
+void gen_buffer::set(const block_in_chunk& pos, const block_t block)
+{
+	get_blocks()[block_index(pos)] = block;
+}
+
+void gen_buffer::set_span(const block_in_chunk& pos, const std::size_t count, const block_t block)
+{
+	assert(pos.z + count <= static_cast<std::size_t>(CHUNK_SIZE));
+	std::fill_n(get_blocks().data() + block_index(pos), count, block);
+}
+
+shared_ptr<chunk_blocks_t::array_t> gen_buffer::take_blocks()
+{
+	return std::move(blocks);
+}
+
+chunk_blocks_t::array_t& gen_buffer::get_blocks()
+{
+	if(blocks == nullptr)
+	{
+		blocks = std::make_shared<chunk_blocks_t::array_t>();
+		blocks->fill(air);
+	}
+	return *blocks;
+}
+
+generator::~generator()
+{
+}
+
+void generator::density(gen_buffer&) const
+{
+}
+
+void generator::surface(gen_buffer&) const
+{
+}
+
+void generator::decoration(gen_buffer&) const
+{
+}
+
+void generator::run_stage(const generator_stage stage, gen_buffer& buffer) const
+{
+	switch(stage)
+	{
+		case generator_stage::density   : density(buffer); return;
+		case generator_stage::surface   : surface(buffer); return;
+		case generator_stage::decoration: decoration(buffer); return;
+	}
+	assert(false);
+}
+
+generator_timings::generator_timings()
+:
+	chunks(0)
+{
+	reset();
+}
+
+void generator_timings::generate(const generator& gen, gen_buffer& buffer)
+{
+	for(std::size_t i = 0; i < GENERATOR_STAGE_COUNT; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		gen.run_stage(static_cast<generator_stage>(i), buffer);
+		const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+		nanoseconds[i].fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+	}
+	chunks.fetch_add(1, std::memory_order_relaxed);
+}
+
+generator_stats generator_timings::get() const
+{
+	generator_stats stats;
+	stats.chunks = chunks.load(std::memory_order_relaxed);
+	for(std::size_t i = 0; i < GENERATOR_STAGE_COUNT; ++i)
+	{
+		stats.seconds[i] = static_cast<double>(nanoseconds[i].load(std::memory_order_relaxed)) / 1e9;
+	}
+	return stats;
+}
+
+void generator_timings::reset()
+{
+	chunks.store(0, std::memory_order_relaxed);
+	for(std::atomic<uint64_t>& n : nanoseconds)
+	{
+		n.store(0, std::memory_order_relaxed);
+	}
+}
+
+}
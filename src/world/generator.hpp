@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "block/block.hpp"
+#include "chunk/Chunk.hpp"
+#include "fwd/block/manager.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/chunk_in_world.hpp"
+#include "world/heightmap.hpp"
+
+namespace block_thingy::world {
+
+/*
+ * The stages a generator fills a chunk in, in order
+ */
+enum class generator_stage : uint8_t
+{
+	density,    // the shape of the terrain (and the heightmap, for generators that make one)
+	surface,    // the blocks at and under the surface
+	decoration, // things placed on the terrain (they must stay inside the chunk)
+};
+constexpr std::size_t GENERATOR_STAGE_COUNT = 3;
+
+std::ostream& operator<<(std::ostream&, generator_stage);
+
+/*
+ * The blocks of a chunk being generated, as one array that the stages write to without locking
+ * The array is made by the first write, so a chunk that is left as air costs nothing
+ */
+class gen_buffer
+{
+public:
+	gen_buffer(const position::chunk_in_world&, double seed, const block::manager&);
+
+	const position::chunk_in_world chunk_pos;
+	const double seed;
+	// for looking up the blocks to place (look them up once for each chunk, not for each block)
+	const block::manager& block_manager;
+
+	/*
+	 * Set by the density stage of generators that make one, for the later stages
+	 */
+	std::shared_ptr<const heightmap> heights;
+
+	block_t get(const position::block_in_chunk&) const;
+	void set(const position::block_in_chunk&, block_t);
+	/*
+	 * Set count blocks from the position going in +z, which are next to each other in the array
+	 */
+	void set_span(const position::block_in_chunk&, std::size_t count, block_t);
+
+	/*
+	 * nullptr if nothing was written
+	 */
+	std::shared_ptr<chunk_blocks_t::array_t> take_blocks();
+
+private:
+	block_t air;
+	std::shared_ptr<chunk_blocks_t::array_t> blocks;
+	chunk_blocks_t::array_t& get_blocks();
+};
+
+/*
+ * Makes the terrain of new chunks, one stage at a time
+ *
+ * The stages run on the world's thread pool, on several chunks at once, so they must be safe to call from several
+ * threads. A generator must make the same blocks for the same seed and position each time (no matter which chunks
+ * were generated before, or in which order), so that generated chunks can be made again instead of being saved.
+ * Plugins provide generators with bt_plugin_make_generator (see PluginManager::make_generator).
+ */
+class generator
+{
+public:
+	virtual ~generator();
+
+	/*
+	 * Saved with the world, to find the generator again when it is loaded
+	 */
+	virtual std::string get_name() const = 0;
+
+	// each does nothing unless it is overridden
+	virtual void density(gen_buffer&) const;
+	virtual void surface(gen_buffer&) const;
+	virtual void decoration(gen_buffer&) const;
+
+	void run_stage(generator_stage, gen_buffer&) const;
+};
+
+/*
+ * The time spent in each stage, summed over the chunks generated
+ */
+struct generator_stats
+{
+	uint64_t chunks;
+	std::array<double, GENERATOR_STAGE_COUNT> seconds;
+};
+
+/*
+ * Counts generator_stats from several threads at once
+ */
+class generator_timings
+{
+public:
+	generator_timings();
+
+	/*
+	 * Run each stage in order, timing it
+	 */
+	void generate(const generator&, gen_buffer&);
+
+	generator_stats get() const;
+	void reset();
+
+private:
+	std::atomic<uint64_t> chunks;
+	std::array<std::atomic<uint64_t>, GENERATOR_STAGE_COUNT> nanoseconds;
+};
+
+}
@@ -0,0 +1,180 @@
+#include "heightmap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <glm/common.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/noise.hpp>
+
+#include "util/batch_simplex.hpp"
+
+using std::shared_ptr;
+
+namespace block_thingy::world {
+
+using position::block_in_world;
+using position::chunk_in_world;
+
+constexpr double BASE_FREQUENCY = 1;
+constexpr double FREQUENCY_MULTIPLIER = 2.07;
+constexpr std::size_t OCTAVES = 8;
+
+/*
+ * The noise coordinates of a column of blocks
+ * They must not be (0, 0) (it makes the surface always 0)
+ */
+static glm::dvec2 noise_coords(const block_in_world::value_type x, const block_in_world::value_type z)
+{
+	return (x == 0 && z == 0) ? glm::dvec2(0.0001) : glm::dvec2(x, z) / 1024.0;
+}
+
+// https://www.shadertoy.com/view/Xl3GWS
+static heightmap::height_t surface_from_noise(const double noise)
+{
+	const glm::dvec2 n(-noise);
+	const double a = n.x * n.y;
+	const double b = glm::mod(a, 1.0);
+	const auto d = static_cast<uint_fast8_t>(glm::mod(std::ceil(a), 2.0));
+	const double y = (d == 0 ? b : 1 - b) - 1;
+	return static_cast<heightmap::height_t>(std::round(y * heightmap::DEPTH));
+}
+
+heightmap heightmap::make(const double seed, const chunk_in_world& chunk_pos)
+{
+	constexpr std::size_t L = util::SIMPLEX_LANES;
+	constexpr auto size = static_cast<std::size_t>(CHUNK_SIZE);
+	constexpr std::size_t column_count = size * size;
+	const block_in_world min(chunk_pos, {0, 0, 0});
+
+	heightmap map;
+	for(std::size_t first = 0; first < column_count; first += L)
+	{
+		double x[L];
+		double z[L];
+		for(std::size_t lane = 0; lane < L; ++lane)
+		{
+			// the lanes past the last column (if CHUNK_SIZE² is not a multiple of L) repeat it
+			const std::size_t i = std::min(first + lane, column_count - 1);
+			const glm::dvec2 coords = noise_coords
+			(
+				min.x + static_cast<block_in_world::value_type>(i / size),
+				min.z + static_cast<block_in_world::value_type>(i % size)
+			);
+			x[lane] = coords.x;
+			z[lane] = coords.y;
+		}
+
+		double sum[L] {};
+		double freq = BASE_FREQUENCY;
+		for(std::size_t octave = 0; octave < OCTAVES; ++octave)
+		{
+			double px[L];
+			double py[L];
+			double pz[L];
+			for(std::size_t lane = 0; lane < L; ++lane)
+			{
+				px[lane] = x[lane] * freq;
+				py[lane] = z[lane] * freq;
+				pz[lane] = seed * freq;
+			}
+			double noise[L];
+			util::batch_simplex(px, py, pz, noise);
+			for(std::size_t lane = 0; lane < L; ++lane)
+			{
+				sum[lane] += std::abs(noise[lane] / freq);
+			}
+			freq *= FREQUENCY_MULTIPLIER;
+		}
+
+		for(std::size_t lane = 0; lane < L && first + lane < column_count; ++lane)
+		{
+			map.heights[first + lane] = surface_from_noise(sum[lane]);
+		}
+	}
+
+	const auto [min_height, max_height] = std::minmax_element(map.heights.cbegin(), map.heights.cend());
+	map.min = *min_height;
+	map.max = *max_height;
+	assert(map.min >= -DEPTH && map.max <= 0);
+	return map;
+}
+
+heightmap::height_t heightmap::surface_at
+(
+	const double seed,
+	const block_in_world::value_type x,
+	const block_in_world::value_type z
+)
+{
+	const glm::dvec3 P(noise_coords(x, z), seed);
+	double val = 0;
+	double freq = BASE_FREQUENCY;
+	for(std::size_t i = 0; i < OCTAVES; i++)
+	{
+		val += std::abs(glm::simplex(P * freq) / freq);
+		freq *= FREQUENCY_MULTIPLIER;
+	}
+	return surface_from_noise(val);
+}
+
+heightmap_cache::heightmap_cache(const std::size_t capacity)
+:
+	capacity(std::max<std::size_t>(capacity, 1)),
+	seed(0),
+	hits(0),
+	misses(0)
+{
+}
+
+shared_ptr<const heightmap> heightmap_cache::get(const double seed, const chunk_in_world& chunk_pos)
+{
+	const chunk_in_world key(chunk_pos.x, 0, chunk_pos.z);
+	{
+		std::lock_guard<std::mutex> g(mutex);
+		if(seed != this->seed)
+		{
+			this->seed = seed;
+			columns.clear();
+			order.clear();
+		}
+		if(const auto i = columns.find(key);
+			i != columns.cend())
+		{
+			++hits;
+			return i->second;
+		}
+		++misses;
+	}
+
+	auto map = std::make_shared<const heightmap>(heightmap::make(seed, key));
+
+	std::lock_guard<std::mutex> g(mutex);
+	// the seed may have changed while this was made
+	if(seed == this->seed && columns.emplace(key, map).second)
+	{
+		order.emplace_back(key);
+		while(order.size() > capacity)
+		{
+			columns.erase(order.front());
+			order.pop_front();
+		}
+	}
+	return map;
+}
+
+uint64_t heightmap_cache::get_hits() const
+{
+	std::lock_guard<std::mutex> g(mutex);
+	return hits;
+}
+
+uint64_t heightmap_cache::get_misses() const
+{
+	std::lock_guard<std::mutex> g(mutex);
+	return misses;
+}
+
+}
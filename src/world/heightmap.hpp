@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#include "fwd/chunk/Chunk.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+
+namespace block_thingy::world {
+
+/*
+ * The terrain's surface (the y of the highest filled block) at each column of blocks in a column of chunks, which
+ * every chunk with the same x and z shares
+ */
+struct heightmap
+{
+	using height_t = int32_t;
+
+	// the surface is between -DEPTH and 0
+	static constexpr height_t DEPTH = 20;
+
+	height_t at(const std::size_t x, const std::size_t z) const
+	{
+		return heights[static_cast<std::size_t>(CHUNK_SIZE) * x + z];
+	}
+
+	std::array<height_t, CHUNK_SIZE * CHUNK_SIZE> heights;
+	height_t min;
+	height_t max;
+
+	/*
+	 * Make the heightmap of the chunk column at x and z (chunk coordinates; y is ignored)
+	 * The noise is made for util::SIMPLEX_LANES columns at once
+	 */
+	static heightmap make(double seed, const position::chunk_in_world&);
+
+	/*
+	 * The surface at one column of blocks, made with glm::simplex like the generator did before heightmaps
+	 * For checking make against
+	 */
+	static height_t surface_at(double seed, position::block_in_world::value_type x, position::block_in_world::value_type z);
+};
+
+/*
+ * Heightmaps of recently generated chunk columns, so the chunks stacked in a column make it once
+ * Safe to use from several threads. Threads that miss the same column at the same time each make it, which costs
+ * less than making them wait for one another.
+ */
+class heightmap_cache
+{
+public:
+	/*
+	 * capacity is the number of chunk columns kept; the oldest is dropped for a new one
+	 */
+	explicit heightmap_cache(std::size_t capacity);
+
+	/*
+	 * The heightmap of the chunk column that the chunk is in
+	 * The cache is emptied if seed is not the one of the heightmaps in it
+	 */
+	std::shared_ptr<const heightmap> get(double seed, const position::chunk_in_world&);
+
+	uint64_t get_hits() const;
+	uint64_t get_misses() const;
+
+private:
+	const std::size_t capacity;
+	mutable std::mutex mutex;
+	double seed;
+	// by chunk_in_world with y = 0
+	position::unordered_map_t<position::chunk_in_world, std::shared_ptr<const heightmap>> columns;
+	// oldest first
+	std::deque<position::chunk_in_world> order;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+}
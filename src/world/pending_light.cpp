@@ -0,0 +1,230 @@
+#include "pending_light.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "fwd/chunk/Chunk.hpp"
+
+using std::string;
+
+namespace block_thingy::world {
+
+using position::block_in_chunk;
+
+constexpr auto BLOCK_COUNT = static_cast<uint32_t>(CHUNK_BLOCK_COUNT);
+
+// the size that compacting starts at, so small chunks are not compacted on every change
+constexpr std::size_t MIN_COMPACT_SIZE = 64;
+
+void pending_light::add(const std::size_t layer, const block_in_chunk& pos)
+{
+	assert(layer < LAYER_COUNT);
+	adds[layer].emplace_back(index_of(pos));
+	maybe_compact();
+}
+
+void pending_light::sub(const std::size_t layer, const block_in_chunk& pos, const graphics::color& color)
+{
+	assert(layer < LAYER_COUNT);
+	subs[layer].emplace_back(index_of(pos), color);
+	maybe_compact();
+}
+
+void pending_light::compact()
+{
+	for(std::size_t layer = 0; layer < LAYER_COUNT; ++layer)
+	{
+		auto& a = adds[layer];
+		std::sort(a.begin(), a.end());
+		a.erase(std::unique(a.begin(), a.end()), a.end());
+
+		auto& s = subs[layer];
+		std::sort(s.begin(), s.end(), [](const auto& x, const auto& y)
+		{
+			return x.first < y.first;
+		});
+		// merge each run of the same block into its first sub
+		std::size_t out = 0;
+		for(std::size_t i = 1; i < s.size(); ++i)
+		{
+			if(s[i].first == s[out].first)
+			{
+				for(std::ptrdiff_t c = 0; c < 3; ++c)
+				{
+					s[out].second[c] = std::max(s[out].second[c], s[i].second[c]);
+				}
+			}
+			else
+			{
+				s[++out] = s[i];
+			}
+		}
+		if(!s.empty())
+		{
+			s.resize(out + 1);
+		}
+	}
+	compacted_size = size();
+}
+
+bool pending_light::empty() const
+{
+	return size() == 0;
+}
+
+std::size_t pending_light::size() const
+{
+	std::size_t size = 0;
+	for(std::size_t layer = 0; layer < LAYER_COUNT; ++layer)
+	{
+		size += adds[layer].size() + subs[layer].size();
+	}
+	return size;
+}
+
+static void put_varint(string& out, uint32_t v)
+{
+	while(v >= 0x80)
+	{
+		out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+}
+
+string pending_light::write()
+{
+	compact();
+	string out;
+	for(std::size_t layer = 0; layer < LAYER_COUNT; ++layer)
+	{
+		put_varint(out, static_cast<uint32_t>(subs[layer].size()));
+		uint32_t prev = 0;
+		for(const auto& [index, color] : subs[layer])
+		{
+			put_varint(out, index - prev);
+			prev = index;
+			out.push_back(static_cast<char>(color.r));
+			out.push_back(static_cast<char>(color.g));
+			out.push_back(static_cast<char>(color.b));
+		}
+
+		put_varint(out, static_cast<uint32_t>(adds[layer].size()));
+		prev = 0;
+		for(const uint32_t index : adds[layer])
+		{
+			put_varint(out, index - prev);
+			prev = index;
+		}
+	}
+	return out;
+}
+
+pending_light pending_light::read(const std::string_view bytes)
+{
+	const auto* p = reinterpret_cast<const uint8_t*>(bytes.data());
+	const auto* const end = p + bytes.size();
+	auto byte = [&p, end]() -> uint8_t
+	{
+		if(p == end)
+		{
+			throw std::runtime_error("corrupt pending light: truncated");
+		}
+		return *p++;
+	};
+	auto varint = [&byte]() -> uint32_t
+	{
+		uint32_t v = 0;
+		for(unsigned shift = 0; shift < 35; shift += 7)
+		{
+			const uint8_t b = byte();
+			v |= static_cast<uint32_t>(b & 0x7F) << shift;
+			if((b & 0x80) == 0)
+			{
+				return v;
+			}
+		}
+		throw std::runtime_error("corrupt pending light: varint too long");
+	};
+	// sorted and without duplicates, so each index is after the one before it
+	auto next_index = [&varint](uint32_t& prev, const bool first) -> uint32_t
+	{
+		const uint32_t delta = varint();
+		if(!first && delta == 0)
+		{
+			throw std::runtime_error("corrupt pending light: duplicate block");
+		}
+		if(delta >= BLOCK_COUNT - prev)
+		{
+			throw std::runtime_error("corrupt pending light: block out of range");
+		}
+		prev += delta;
+		return prev;
+	};
+
+	pending_light light;
+	for(std::size_t layer = 0; layer < LAYER_COUNT; ++layer)
+	{
+		const uint32_t sub_count = varint();
+		if(sub_count > BLOCK_COUNT)
+		{
+			throw std::runtime_error("corrupt pending light: too many changes");
+		}
+		light.subs[layer].reserve(sub_count);
+		uint32_t prev = 0;
+		for(uint32_t i = 0; i < sub_count; ++i)
+		{
+			const uint32_t index = next_index(prev, i == 0);
+			const uint8_t r = byte();
+			const uint8_t g = byte();
+			const uint8_t b = byte();
+			light.subs[layer].emplace_back(index, graphics::color(r, g, b));
+		}
+
+		const uint32_t add_count = varint();
+		if(add_count > BLOCK_COUNT)
+		{
+			throw std::runtime_error("corrupt pending light: too many changes");
+		}
+		light.adds[layer].reserve(add_count);
+		prev = 0;
+		for(uint32_t i = 0; i < add_count; ++i)
+		{
+			light.adds[layer].emplace_back(next_index(prev, i == 0));
+		}
+	}
+	if(p != end)
+	{
+		throw std::runtime_error("corrupt pending light: trailing bytes");
+	}
+	light.compacted_size = light.size();
+	return light;
+}
+
+uint32_t pending_light::index_of(const block_in_chunk& pos)
+{
+	return static_cast<uint32_t>(CHUNK_SIZE * CHUNK_SIZE * pos.x + CHUNK_SIZE * pos.y + pos.z);
+}
+
+block_in_chunk pending_light::block_at(const uint32_t index)
+{
+	const auto size = static_cast<uint32_t>(CHUNK_SIZE);
+	return block_in_chunk
+	(
+		static_cast<block_in_chunk::value_type>(index / (size * size)),
+		static_cast<block_in_chunk::value_type>((index / size) % size),
+		static_cast<block_in_chunk::value_type>(index % size)
+	);
+}
+
+void pending_light::maybe_compact()
+{
+	const std::size_t size = this->size();
+	if(size >= MIN_COMPACT_SIZE && size >= 2 * compacted_size)
+	{
+		compact();
+	}
+}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "graphics/color.hpp"
+#include "position/block_in_chunk.hpp"
+
+namespace block_thingy::world {
+
+/*
+ * Light changes that are waiting for one chunk to be loaded (they were queued when it was unloaded, or when the world
+ * was saved), to be continued when it is
+ *
+ * Blocks are kept as their index in the chunk. compact sorts them and removes duplicates, so a chunk keeps at most one
+ * change of each kind per block and layer no matter how long it waits.
+ */
+class pending_light
+{
+public:
+	// block light and skylight
+	static constexpr std::size_t LAYER_COUNT = 2;
+
+	/*
+	 * Light spreading from the block
+	 */
+	void add(std::size_t layer, const position::block_in_chunk&);
+	/*
+	 * Light being removed from the block (a duplicate keeps the most of each channel)
+	 */
+	void sub(std::size_t layer, const position::block_in_chunk&, const graphics::color&);
+
+	/*
+	 * Sort and remove duplicates
+	 * Called by add and sub when they have doubled the size since the last compact
+	 */
+	void compact();
+
+	bool empty() const;
+	std::size_t size() const;
+
+	/*
+	 * Compacts, then calls add(layer, block) and sub(layer, block, color) for each change, subs first
+	 */
+	template<typename Add, typename Sub>
+	void for_each(Add&& add, Sub&& sub)
+	{
+		compact();
+		for(std::size_t layer = 0; layer < LAYER_COUNT; ++layer)
+		{
+			for(const auto& [index, color] : subs[layer])
+			{
+				sub(layer, block_at(index), color);
+			}
+			for(const uint32_t index : adds[layer])
+			{
+				add(layer, block_at(index));
+			}
+		}
+	}
+
+	/*
+	 * For each layer: the varint count of subs and then each sub as a varint of the difference from the previous
+	 * index and the color as 3 bytes, and then the same for adds without colors
+	 */
+	std::string write();
+	/*
+	 * Throws std::runtime_error if the bytes are corrupt
+	 */
+	static pending_light read(std::string_view);
+
+private:
+	std::vector<uint32_t> adds[LAYER_COUNT];
+	std::vector<std::pair<uint32_t, graphics::color>> subs[LAYER_COUNT];
+	std::size_t compacted_size = 0;
+
+	static uint32_t index_of(const position::block_in_chunk&);
+	static position::block_in_chunk block_at(uint32_t index);
+	void maybe_compact();
+};
+
+}
@@ -0,0 +1,93 @@
+#include "terrain_generator.hpp"
+
+#include <algorithm>
+#include <optional>
+
+#include "block/manager.hpp"
+#include "position/block_in_chunk.hpp"
+#include "position/block_in_world.hpp"
+
+using std::nullopt;
+using std::string;
+
+namespace block_thingy::world {
+
+using position::block_in_chunk;
+using position::block_in_world;
+
+terrain_generator::terrain_generator(const std::size_t cache_columns)
+:
+	heightmaps(cache_columns)
+{
+}
+
+string terrain_generator::get_name() const
+{
+	return NAME;
+}
+
+void terrain_generator::density(gen_buffer& buffer) const
+{
+	// above the highest surface there can be, so the heightmap is not needed
+	if(block_in_world(buffer.chunk_pos, {0, 0, 0}).y > 0)
+	{
+		return;
+	}
+	buffer.heights = heightmaps.get(buffer.seed, buffer.chunk_pos);
+}
+
+void terrain_generator::surface(gen_buffer& buffer) const
+{
+	const heightmap* map = buffer.heights.get();
+	const block_in_world min(buffer.chunk_pos, {0, 0, 0});
+	const block_in_world max(buffer.chunk_pos, {CHUNK_SIZE - 1, CHUNK_SIZE - 1, CHUNK_SIZE - 1});
+	if(map == nullptr || min.y > map->max)
+	{
+		return;
+	}
+	// below the lowest surface in the column, so every column is filled to the top of the chunk
+	const bool below_surface = max.y <= map->min;
+
+	// looked up once for each chunk instead of for each block (nullopt if the block does not exist; its blocks are left as air)
+	const std::optional<block_t> upper_block = buffer.block_manager.get_block("test_white");
+	const std::optional<block_t> lower_block = buffer.block_manager.get_block("test_black");
+
+	constexpr auto size = static_cast<std::size_t>(CHUNK_SIZE);
+	const auto top = std::min<block_in_world::value_type>(max.y, map->max);
+	for(std::size_t x = 0; x < size; ++x)
+	for(auto y = min.y; y <= top; ++y)
+	{
+		const std::optional<block_t>& block = y > -heightmap::DEPTH / 2 ? upper_block : lower_block;
+		if(block == nullopt)
+		{
+			continue;
+		}
+
+		// each run of columns along z that reach up to y, which are next to each other in the chunk's array
+		const auto local_y = static_cast<block_in_chunk::value_type>(y - min.y);
+		std::size_t z = 0;
+		while(z < size)
+		{
+			if(!below_surface && map->at(x, z) < y)
+			{
+				++z;
+				continue;
+			}
+			std::size_t end = z + 1;
+			while(end < size && (below_surface || map->at(x, end) >= y))
+			{
+				++end;
+			}
+			const block_in_chunk pos
+			(
+				static_cast<block_in_chunk::value_type>(x),
+				local_y,
+				static_cast<block_in_chunk::value_type>(z)
+			);
+			buffer.set_span(pos, end - z, *block);
+			z = end;
+		}
+	}
+}
+
+}
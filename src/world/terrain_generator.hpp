@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "world/generator.hpp"
+#include "world/heightmap.hpp"
+
+namespace block_thingy::world {
+
+/*
+ * The built-in generator: hills of test_white, with test_black under half of heightmap::DEPTH
+ * density makes (or finds) the column's heightmap, surface fills the columns up to it, and there is no decoration
+ */
+class terrain_generator : public generator
+{
+public:
+	static constexpr const char* NAME = "terrain";
+	// 4 KiB each with 32³ chunks
+	static constexpr std::size_t DEFAULT_CACHE_COLUMNS = 1024;
+
+	/*
+	 * cache_columns is the number of chunk columns whose heightmap is kept
+	 */
+	explicit terrain_generator(std::size_t cache_columns = DEFAULT_CACHE_COLUMNS);
+
+	std::string get_name() const override;
+
+	void density(gen_buffer&) const override;
+	void surface(gen_buffer&) const override;
+
+private:
+	// shared by the chunks stacked in each column, which may be generated at the same time
+	mutable heightmap_cache heightmaps;
+};
+
+}
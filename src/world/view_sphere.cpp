@@ -0,0 +1,79 @@
+#include "view_sphere.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <tuple>
+
+#include <glm/geometric.hpp>
+
+using std::abs;
+
+namespace block_thingy::world {
+
+using position::chunk_in_world;
+
+view_sphere::view_sphere(const chunk_in_world::value_type render_distance)
+:
+	render_distance(render_distance)
+{
+	const auto r = render_distance;
+	chunk_in_world offset;
+	for(offset.x = -r; offset.x <= r; ++offset.x)
+	for(offset.y = -r; offset.y <= r; ++offset.y)
+	for(offset.z = -r; offset.z <= r; ++offset.z)
+	{
+		if(contains(offset, r))
+		{
+			offsets.emplace_back(offset);
+		}
+	}
+	std::sort(offsets.begin(), offsets.end(), [](const chunk_in_world& a, const chunk_in_world& b)
+	{
+		// the position breaks ties, so that the order does not depend on the sort
+		return std::make_tuple(a.x * a.x + a.y * a.y + a.z * a.z, a.x, a.y, a.z)
+			 < std::make_tuple(b.x * b.x + b.y * b.y + b.z * b.z, b.x, b.y, b.z);
+	});
+}
+
+chunk_in_world::value_type view_sphere::get_render_distance() const
+{
+	return render_distance;
+}
+
+const std::vector<chunk_in_world>& view_sphere::get_offsets() const
+{
+	return offsets;
+}
+
+std::size_t view_sphere::get_near_count() const
+{
+	return std::min<std::size_t>(27, offsets.size());
+}
+
+bool view_sphere::contains(const chunk_in_world& offset, const chunk_in_world::value_type render_distance)
+{
+	// the whole chunks between the player's chunk and the other one on each axis
+	const auto gap = [](const chunk_in_world::value_type d)
+	{
+		return std::max<chunk_in_world::value_type>(abs(d) - 1, 0);
+	};
+	const auto x = gap(offset.x);
+	const auto y = gap(offset.y);
+	const auto z = gap(offset.z);
+	return abs(offset.x) <= render_distance
+		&& abs(offset.y) <= render_distance
+		&& abs(offset.z) <= render_distance
+		&& x * x + y * y + z * z <= render_distance * render_distance;
+}
+
+double view_weighted_distance(const glm::dvec3& offset, const glm::dvec3& look, const double look_weight)
+{
+	const double distance = glm::length(offset);
+	if(distance == 0)
+	{
+		return 0;
+	}
+	return distance * (1 - look_weight * glm::dot(look, offset / distance));
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "position/chunk_in_world.hpp"
+
+namespace block_thingy::world {
+
+/*
+ * The chunks a player wants: the ones with a block within render_distance chunks of the player's chunk, as offsets
+ * from it, nearest first
+ * The corners of the cube around the player's chunk are farther than that, so they are left out
+ */
+class view_sphere
+{
+public:
+	explicit view_sphere(position::chunk_in_world::value_type render_distance);
+
+	position::chunk_in_world::value_type get_render_distance() const;
+
+	/*
+	 * Sorted by the distance between the chunks' centers; the first is {0, 0, 0}, and the next 26 are its neighbors
+	 */
+	const std::vector<position::chunk_in_world>& get_offsets() const;
+
+	/*
+	 * How many of the offsets are the player's chunk and its neighbors (27, or 1 when render_distance is 0)
+	 */
+	std::size_t get_near_count() const;
+
+	static bool contains(const position::chunk_in_world& offset, position::chunk_in_world::value_type render_distance);
+
+private:
+	position::chunk_in_world::value_type render_distance;
+	std::vector<position::chunk_in_world> offsets;
+};
+
+/*
+ * For ordering chunk requests: the length of offset (from the camera), made up to look_weight times shorter when it
+ * points where the camera looks (look is a unit vector) and as much longer when it points behind
+ */
+double view_weighted_distance(const glm::dvec3& offset, const glm::dvec3& look, double look_weight);
+
+}
@@ -7,21 +7,25 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <deque>
 #include <fstream>
+#include <iterator>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
 #include <stdint.h>
 #include <tuple>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <glm/common.hpp>
 #include <glm/vec2.hpp>
-#include <glm/gtc/noise.hpp>
 #include <msgpack.hpp>
 
 #include "Player.hpp"
@@ -33,11 +37,24 @@
 #include "position/block_in_world.hpp"
 #include "position/chunk_in_world.hpp"
 #include "position/hash.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/chunk_writer.hpp"
+#include "storage/codec.hpp"
+#include "storage/edit_journal.hpp"
 #include "storage/world_file.hpp"
 #include "storage/msgpack/block_manager.hpp"
 #include "storage/msgpack/color.hpp"
 #include "storage/msgpack/position.hpp"
+#include "util/logger.hpp"
 #include "util/ThreadThingy.hpp"
+#include "util/thread_pool.hpp"
+#include "world/chunk_light.hpp"
+#include "world/chunk_prefetcher.hpp"
+#include "world/chunk_stage.hpp"
+#include "world/generator.hpp"
+#include "world/pending_light.hpp"
+#include "world/terrain_generator.hpp"
+#include "world/view_sphere.hpp"
 
 using std::nullopt;
 using std::string;
@@ -53,7 +70,47 @@ using position::chunk_in_world;
 constexpr std::size_t LIGHT_LAYER_BLOCK = 0;
 constexpr std::size_t LIGHT_LAYER_SKY   = 1;
 constexpr std::size_t LIGHT_LAYER_COUNT = 2;
+static_assert(pending_light::LAYER_COUNT == LIGHT_LAYER_COUNT);
 constexpr double TICKS_PER_SECOND = 60;
+// chunks queued to be written before saving waits (or in step, is put off)
+constexpr std::size_t MAX_PENDING_CHUNK_SAVES = 256;
+// how often block changes are written to the journal (the most a crash can lose)
+constexpr std::chrono::milliseconds JOURNAL_COMMIT_INTERVAL(100);
+// chunks that take longer than this to light keep their light when they are saved, even if the world omits light
+constexpr std::chrono::microseconds RELIGHT_BUDGET(2000);
+// prefetched chunks are queued a few at a time, so that the queue does not fill with chunks that may not be wanted
+constexpr std::size_t MAX_PREFETCH_REQUESTS_PER_TICK = 32;
+// prefetched chunks are kept this long after they were last planned, so that a player who slows down for a moment (such
+// as when landing or hitting a wall) does not unload them all
+constexpr uint64_t PREFETCH_GRACE_TICKS = static_cast<uint64_t>(2 * TICKS_PER_SECOND);
+
+struct mesh_job
+{
+	shared_ptr<Chunk> chunk;
+	uint8_t lod_level;
+
+	bool operator==(const mesh_job& that) const
+	{
+		return chunk == that.chunk
+		    && lod_level == that.lod_level;
+	}
+};
+
+struct mesh_job_hasher
+{
+	std::size_t operator()(const mesh_job& job) const
+	{
+		return std::hash<shared_ptr<Chunk>>()(job.chunk) ^ job.lod_level;
+	}
+};
+
+struct finished_chunk
+{
+	shared_ptr<Chunk> chunk;
+	bool generated;
+	// squared distance to the nearest player
+	int64_t distance;
+};
 
 struct world::impl
 {
@@ -67,29 +124,121 @@ struct world::impl
 		file(dir_path),
 		seed(0),
 		ticks(0),
+		chunk_writer(file, thread_pool, MAX_PENDING_CHUNK_SAVES),
+		journal(dir_path / "journal", JOURNAL_COMMIT_INTERVAL),
+		compacting_queued(0),
+		compaction_sequence(0),
+		compaction_start_ticket(0),
+		compaction_end_ticket(0),
+		last_compaction(std::chrono::steady_clock::now()),
 		gen_thread([this, &world](const chunk_in_world& pos)
 		{
 			shared_ptr<Chunk> chunk = std::make_shared<Chunk>(pos, world);
-			gen_chunk(chunk);
+			if(!gen_chunk(chunk))
+			{
+				// an air chunk would be saved over the terrain the generator makes, so it is requested again later
+				gen_thread.drop(pos);
+				std::lock_guard<std::mutex> g(chunk_stages_mutex);
+				if(const auto i = chunk_stages.find(pos);
+					i != chunk_stages.cend() && i->second == chunk_stage::generate)
+				{
+					chunk_stages.erase(i);
+				}
+				return;
+			}
+			if(gen_thread.is_cancelled(pos))
+			{
+				gen_thread.drop(pos);
+				return;
+			}
+			// changed before a crash, before the changed chunk was saved (generated chunks are saved once they change)
+			journal.replay(*chunk);
+			advance_stage(pos, chunk_stage::generate, chunk_stage::light);
+			light_new_chunk(*chunk);
+			advance_stage(pos, chunk_stage::light, chunk_stage::integrate);
 			generated_chunks.enqueue(chunk);
-		}, 2, position::hasher<chunk_in_world>),
+		}, thread_pool, position::hasher<chunk_in_world>),
+		chunk_generator(std::make_shared<terrain_generator>()),
+		generator_name(terrain_generator::NAME),
 		load_thread([this](const chunk_in_world& pos)
 		{
-			shared_ptr<Chunk> chunk(file.load_chunk(this_world, pos));
-			assert(chunk != nullptr);
+			bool has_light;
+			shared_ptr<Chunk> chunk(file.load_chunk(this_world, pos, has_light));
+			if(chunk == nullptr)
+			{
+				// world_file logged why; gen_thread makes it again and replays its changes from the journal
+				LOG(ERROR) << "generating chunk " << pos << " instead of loading it\n";
+				load_thread.drop(pos);
+				std::lock_guard<std::mutex> g(chunk_stages_mutex);
+				// not if it was cancelled while it was loading
+				if(const auto i = chunk_stages.find(pos);
+					i != chunk_stages.cend() && i->second == chunk_stage::load)
+				{
+					i->second = chunk_stage::generate;
+					// while chunk_stages_mutex is locked, so that cancel_unwanted_jobs sees it queued
+					gen_thread.enqueue(pos);
+				}
+				return;
+			}
+			const bool changed = journal.replay(*chunk);
+			const uint32_t stamp = light_stamp(this_world.block_manager.info, skylight_color);
+			// saved before stamps, when light was always trusted
+			if(has_light && chunk->get_light_stamp() == 0)
+			{
+				chunk->set_light_stamp(stamp);
+			}
+			// the light was saved with it, unless it has changes from the journal, the world omits light, or the
+			// light was made by other rules (the light at its sides is reconciled with its neighbors by set_chunk)
+			if(changed || !has_light || chunk->get_light_stamp() != stamp)
+			{
+				if(has_light)
+				{
+					chunk->clear_light();
+				}
+				light_new_chunk(*chunk);
+			}
+			advance_stage(pos, chunk_stage::load, chunk_stage::integrate);
 			loaded_chunks.enqueue(chunk);
-			mesh_thread.enqueue(chunk);
-		}, 2, position::hasher<chunk_in_world>),
-		mesh_thread([this](shared_ptr<Chunk>& chunk)
+		}, thread_pool, position::hasher<chunk_in_world>),
+		mesh_thread([this](mesh_job& job)
 		{
-			if(chunk == nullptr)
+			if(job.chunk == nullptr)
 			{
 				// should not happen
 				return;
 			}
-			chunk->update();
-			mesh_thread.dequeue(chunk);
-		}, 2),
+			if(job.lod_level == 0)
+			{
+				// only the sections marked dirty (or all of them if the chunk has not been meshed yet)
+				job.chunk->update_sections(0);
+				const chunk_in_world pos = job.chunk->get_position();
+				advance_stage(pos, chunk_stage::mesh, chunk_stage::upload);
+				std::lock_guard<std::mutex> g(chunks_mutex);
+				const auto i = chunks.find(pos);
+				// not if it was removed while it was meshed
+				if(i != chunks.cend() && i->second == job.chunk)
+				{
+					render_changes.insert_or_assign(pos, job.chunk);
+				}
+			}
+			else
+			{
+				job.chunk->update_lod(job.lod_level);
+			}
+			mesh_thread.dequeue(job);
+			if(job.lod_level == 0 && job.chunk->has_dirty_sections())
+			{
+				// marked dirty while meshing, when enqueueing would have been a no-op
+				mesh_thread.enqueue(job);
+			}
+		}, thread_pool),
+		batching_neighbor_meshes(false),
+		integrated_count(0),
+		integrated_per_second(0),
+		integrated_rate_start(std::chrono::steady_clock::now()),
+		integrated_rate_start_count(0),
+		view(0),
+		load_start(std::chrono::steady_clock::now()),
 		skylight_color(8, 8, 8)
 	{
 	}
@@ -103,6 +252,8 @@ struct world::impl
 
 	position::unordered_map_t<chunk_in_world, shared_ptr<Chunk>> chunks;
 	mutable std::mutex chunks_mutex;
+	// for take_render_changes; locked with chunks_mutex, so that a chunk is not added after it was removed
+	position::unordered_map_t<chunk_in_world, shared_ptr<Chunk>> render_changes;
 
 	std::unordered_set<shared_ptr<const Chunk>> chunks_to_save;
 
@@ -128,19 +279,153 @@ struct world::impl
 	(
 		const chunk_in_world&,
 		const chunk_in_world&,
+		mesher::section_mask_t,
+		bool thread = true
+	);
+	void queue_mesh
+	(
+		const shared_ptr<Chunk>&,
+		mesher::section_mask_t,
 		bool thread = true
 	);
 
+	/*
+	 * Where each chunk that is wanted (or in the world) is in the pipeline
+	 * Workers change this, so it has its own mutex
+	 */
+	position::unordered_map_t<chunk_in_world, chunk_stage> chunk_stages;
+	mutable std::mutex chunk_stages_mutex;
+	std::optional<chunk_stage> get_stage(const chunk_in_world&) const;
+	void set_stage(const chunk_in_world&, chunk_stage);
+	/*
+	 * Set the stage only if the chunk is in the stage `from`
+	 * (for example, remeshing a drawn chunk does not move it back to the mesh stage)
+	 */
+	void advance_stage(const chunk_in_world&, chunk_stage from, chunk_stage to);
+
+	/*
+	 * Cancel loading and generating the chunks that are no longer wanted
+	 */
+	void cancel_unwanted_jobs();
+
+	/*
+	 * Queue loading or generating a chunk that is not in the world
+	 * @return false if it was already queued, or it is not saved and the world's generator is not set yet
+	 */
+	bool request_chunk(const chunk_in_world&, util::thread_pool::priority);
+
+	// chunks in the world that are not meshed until each neighbor is in the world or is not wanted
+	std::unordered_set<chunk_in_world, position::hasher_struct<chunk_in_world>> waiting_for_neighbors;
+	void mesh_chunks_with_neighbors();
+
+	/*
+	 * Queue the blocks at the sides of a new chunk where light can flow between it and its neighbors
+	 */
+	void seed_light_at_sides(const chunk_in_world&, const Chunk&);
+
+	/*
+	 * light_chunk, and stamp the chunk and note whether it was costly
+	 */
+	void light_new_chunk(Chunk&);
+
+	// shared by gen_thread, load_thread, mesh_thread, and chunk_writer
+	util::thread_pool thread_pool;
+
+	storage::chunk_writer chunk_writer;
+
+	/*
+	 * Block changes are journaled instead of saving their chunk each time. The changed chunks (and chunks whose light
+	 * changed) are saved together every chunk_compaction_interval_s, and then their changes are dropped from the journal.
+	 * Only the chunks whose images were saved without an error are compacted; the others are kept for the next one
+	 */
+	storage::edit_journal journal;
+	position::unordered_map_t<chunk_in_world, shared_ptr<const Chunk>> chunks_to_compact;
+	// taken from chunks_to_compact; the first compacting_queued of them have been given to chunk_writer
+	std::vector<std::pair<chunk_in_world, shared_ptr<const Chunk>>> compacting;
+	std::size_t compacting_queued;
+	uint64_t compaction_sequence;
+	// chunk_writer's tickets from before the first image and of the last one (0 until they are all queued)
+	uint64_t compaction_start_ticket;
+	uint64_t compaction_end_ticket;
+	std::chrono::steady_clock::time_point last_compaction;
+	void step_compaction();
+	// call once the images in compacting are written
+	void finish_compaction();
+
 	util::ThreadThingy<chunk_in_world, position::hasher_t<chunk_in_world>> gen_thread;
 	moodycamel::ConcurrentQueue<shared_ptr<Chunk>> generated_chunks;
-	void gen_chunk(shared_ptr<Chunk>&) const;
+	/*
+	 * @return false if the world's generator is not set yet (the chunk is left as air)
+	 */
+	bool gen_chunk(shared_ptr<Chunk>&) const;
+	// read by gen_thread's workers with std::atomic_load, since world::set_generator can replace it
+	shared_ptr<const generator> chunk_generator;
+	// saved with the world; after loading, it may name a generator that is not set yet (chunk_generator is nullptr until it is)
+	string generator_name;
+	mutable generator_timings gen_timings;
 
 	util::ThreadThingy<chunk_in_world, position::hasher_t<chunk_in_world>> load_thread;
 	moodycamel::ConcurrentQueue<shared_ptr<Chunk>> loaded_chunks;
 
 	std::unordered_set<chunk_in_world, position::hasher_struct<chunk_in_world>> active_chunks;
 
-	util::ThreadThingy<shared_ptr<Chunk>> mesh_thread;
+	/*
+	 * Chunks past the render distance that a moving player will want soon, which are loaded and generated with low
+	 * priority (see chunk_prefetcher)
+	 * prefetch_order has them nearest first, and may have duplicates; prefetch_chunks has the ones that are not active,
+	 * including the ones planned within PREFETCH_GRACE_TICKS (prefetch_planned has the tick each was last planned in)
+	 */
+	std::vector<chunk_in_world> prefetch_order;
+	position::unordered_set_t<chunk_in_world> prefetch_chunks;
+	position::unordered_map_t<chunk_in_world, uint64_t> prefetch_planned;
+	chunk_prefetcher prefetcher;
+	void plan_prefetch(const Player&);
+	void request_prefetch();
+
+	/*
+	 * Active or prefetched
+	 */
+	bool is_wanted(const chunk_in_world&) const;
+
+	util::ThreadThingy<mesh_job, mesh_job_hasher> mesh_thread;
+
+	/*
+	 * Add finished chunks to the world, nearest to a player first, until chunk_integration_budget_ms is spent
+	 * The rest wait for the next tick
+	 */
+	void integrate_finished_chunks();
+	std::vector<finished_chunk> finished_chunks;
+
+	/*
+	 * While integrating, the neighbors are remeshed once after the batch instead of once for each new chunk beside them
+	 */
+	bool batching_neighbor_meshes;
+	position::unordered_map_t<chunk_in_world, mesher::section_mask_t> batched_neighbor_meshes;
+	void flush_neighbor_meshes();
+
+	uint64_t integrated_count;
+	double integrated_per_second;
+	std::chrono::steady_clock::time_point integrated_rate_start;
+	uint64_t integrated_rate_start_count;
+
+	// the chunks each player wants, remade when render_distance changes
+	view_sphere view;
+	/*
+	 * Request the chunks in the view sphere of each player that are not in the world: the chunks around each player
+	 * first, then the rest nearest first, weighted toward where they look by chunk_order_look_weight
+	 */
+	void request_active_chunks();
+	// whether it is past the chunks around the player, the weighted distance, and the chunk
+	std::vector<std::tuple<bool, double, chunk_in_world>> active_requests;
+
+	/*
+	 * For get_load_times, measured each tick until every chunk in each player's view sphere has been meshed
+	 */
+	std::chrono::steady_clock::time_point load_start;
+	std::optional<double> playable_seconds;
+	std::optional<double> loaded_seconds;
+	void measure_load_times();
+	bool is_meshed(const chunk_in_world&) const;
 
 	std::deque<std::tuple<block_in_world, graphics::color>> light_sub1[LIGHT_LAYER_COUNT];
 	std::deque<std::tuple<block_in_world, graphics::color>> light_sub2[LIGHT_LAYER_COUNT];
@@ -148,6 +433,13 @@ struct world::impl
 	std::deque<block_in_world> light_add1[LIGHT_LAYER_COUNT];
 	std::deque<block_in_world> light_add2[LIGHT_LAYER_COUNT];
 
+	/*
+	 * Light changes at blocks in chunks that are not in the world, continued when the chunk is added
+	 * They used to be queued again every tick until then
+	 */
+	position::unordered_map_t<chunk_in_world, pending_light> pending_light_by_chunk;
+	void replay_pending_light(const chunk_in_world&);
+
 	graphics::color skylight_color; // perhaps should be in world instance
 
 	graphics::color get_light(std::size_t layer, const block_in_world&) const;
@@ -229,7 +521,12 @@ void world::set_block
 
 	const block_in_chunk pos(block_pos);
 	chunk->set_block(pos, block);
-	pImpl->chunks_to_save.emplace(chunk);
+	if(block_manager.info.is_opaque(block) != block_manager.info.is_opaque(old_block))
+	{
+		chunk->mark_connectivity_dirty();
+	}
+	pImpl->journal.append(block_pos, block);
+	pImpl->chunks_to_compact.insert_or_assign(chunk_pos, chunk);
 
 	const bool old_affects_light = does_affect_light(block_manager, old_block);
 	const bool affects_light = does_affect_light(block_manager, block);
@@ -254,14 +551,8 @@ void world::set_block
 	}
 
 	pImpl->update_chunk_neighbors(chunk_pos, pos, thread);
-	if(thread)
-	{
-		pImpl->mesh_thread.enqueue(chunk);
-	}
-	else
-	{
-		chunk->update();
-	}
+	// the faces of the changed block and of the blocks beside it
+	pImpl->queue_mesh(chunk, mesher::sections_for_slices(pos.x - 1, pos.x + 1), thread);
 }
 
 block_t world::get_block(const block_in_world& block_pos) const
@@ -410,7 +701,12 @@ void world::impl::set_light
 		}
 	}
 
-	chunks_to_save.emplace(chunk);
+	// light follows from the blocks, so it is not journaled; it is saved with the next compaction, unless the chunk
+	// is not saved at all (it is lit again when it is generated again)
+	if(!chunk->is_pristine())
+	{
+		chunks_to_compact.insert_or_assign(chunk_pos, chunk);
+	}
 }
 
 void world::impl::sub_light
@@ -467,10 +763,10 @@ void world::impl::process_blocklight_add()
 		const block_in_world pos = light_add1.front();
 		light_add1.pop_front();
 
-		// bad solution, but works for now
-		if(this_world.get_chunk(chunk_in_world(pos)) == nullptr)
+		if(const chunk_in_world chunk_pos(pos);
+			this_world.get_chunk(chunk_pos) == nullptr)
 		{
-			light_add2.emplace_back(pos);
+			pending_light_by_chunk[chunk_pos].add(LIGHT_LAYER_BLOCK, block_in_chunk(pos));
 			continue;
 		}
 
@@ -544,10 +840,10 @@ void world::impl::process_skylight_add()
 		const block_in_world pos = light_add1.front();
 		light_add1.pop_front();
 
-		// bad solution, but works for now
-		if(this_world.get_chunk(chunk_in_world(pos)) == nullptr)
+		if(const chunk_in_world chunk_pos(pos);
+			this_world.get_chunk(chunk_pos) == nullptr)
 		{
-			light_add2.emplace_back(pos);
+			pending_light_by_chunk[chunk_pos].add(LIGHT_LAYER_SKY, block_in_chunk(pos));
 			continue;
 		}
 
@@ -664,10 +960,10 @@ void world::impl::process_blocklight_sub()
 			continue;
 		}
 
-		// bad solution, but works for now
-		if(this_world.get_chunk(chunk_in_world(pos)) == nullptr)
+		if(const chunk_in_world chunk_pos(pos);
+			this_world.get_chunk(chunk_pos) == nullptr)
 		{
-			light_sub2.emplace_back(front);
+			pending_light_by_chunk[chunk_pos].sub(LIGHT_LAYER_BLOCK, block_in_chunk(pos), color);
 			continue;
 		}
 
@@ -746,10 +1042,10 @@ void world::impl::process_skylight_sub()
 			continue;
 		}
 
-		// bad solution, but works for now
-		if(this_world.get_chunk(chunk_in_world(pos)) == nullptr)
+		if(const chunk_in_world chunk_pos(pos);
+			this_world.get_chunk(chunk_pos) == nullptr)
 		{
-			light_sub2.emplace_back(front);
+			pending_light_by_chunk[chunk_pos].sub(LIGHT_LAYER_SKY, block_in_chunk(pos), color);
 			continue;
 		}
 
@@ -861,83 +1157,24 @@ void world::set_chunk
 	{
 		std::lock_guard<std::mutex> g(pImpl->chunks_mutex);
 		pImpl->chunks.insert_or_assign(chunk_pos, chunk);
+		// the new chunk is added when it is meshed
+		pImpl->render_changes.insert_or_assign(chunk_pos, nullptr);
 	}
 	if(chunk == nullptr)
 	{
+		pImpl->waiting_for_neighbors.erase(chunk_pos);
+		std::lock_guard<std::mutex> g(pImpl->chunk_stages_mutex);
+		pImpl->chunk_stages.erase(chunk_pos);
 		return;
 	}
 
-	// set skylight
-	// TODO: handle skylight being blocked by above chunks
-	// currently, every chunk has skylight emitted at the top
-	if(set_light)
-	{
-		auto& skylight_add = pImpl->light_add1[LIGHT_LAYER_SKY];
-		block_in_chunk pos(0, CHUNK_SIZE - 1, 0);
-		for(pos.x = 0; pos.x < CHUNK_SIZE; ++pos.x)
-		for(pos.z = 0; pos.z < CHUNK_SIZE; ++pos.z)
-		{
-			graphics::color light = pImpl->skylight_color;
-			const block_t block = chunk->get_block(pos);
-			if(block_manager.info.is_opaque(block))
-			{
-				light = 0;
-			}
-			else if(block_manager.info.is_translucent(block))
-			{
-				const graphics::color f = block_manager.info.light_filter(block);
-				light.r = std::min(light.r, f.r);
-				light.g = std::min(light.g, f.g);
-				light.b = std::min(light.b, f.b);
-			}
-			chunk->set_skylight(pos, light);
-			const block_in_world block_pos(chunk->get_position(), pos);
-			skylight_add.emplace_back(block_pos);
-		}
-	}
-
-	// update light at chunk sides to make it flow into the new chunk
-	/*
+	// chunks made by the generator are lit on a worker before they get here
 	if(set_light)
 	{
-		auto& blocklight_add = pImpl->light_add1[LIGHT_LAYER_BLOCK];
-		block_in_world pos1(chunk_pos, {0, 0, 0});
-		block_in_world pos;
-		for(uint_fast8_t i1 = 0; i1 < 3; ++i1)
-		{
-			uint_fast8_t i2 = (i1 + 1) % 3;
-			uint_fast8_t i3 = (i1 + 2) % 3;
-			for(pos[i1] = pos1[i1]; pos[i1] < pos1[i1] + CHUNK_SIZE; ++pos[i1])
-			for(pos[i2] = pos1[i2]; pos[i2] < pos1[i2] + CHUNK_SIZE; ++pos[i2])
-			{
-				block_in_world pos2(pos);
-
-				pos2[i3] = pos1[i3] - 1;
-				blocklight_add.emplace_back(pos2);
-
-				pos2[i3] = pos1[i3] + CHUNK_SIZE;
-				blocklight_add.emplace_back(pos2);
-			}
-		}
-	}
-	*/
-
-	// update blocklight
-	if(set_light)
-	{
-		block_in_chunk pos;
-		for(pos.x = 0; pos.x < CHUNK_SIZE; ++pos.x)
-		for(pos.y = 0; pos.y < CHUNK_SIZE; ++pos.y)
-		for(pos.z = 0; pos.z < CHUNK_SIZE; ++pos.z)
-		{
-			const block_t block = chunk->get_block(pos);
-			const graphics::color light = block_manager.info.light(block);
-			if(light != 0)
-			{
-				pImpl->add_light(LIGHT_LAYER_BLOCK, {chunk_pos, pos}, light);
-			}
-		}
+		pImpl->light_new_chunk(*chunk);
 	}
+	pImpl->seed_light_at_sides(chunk_pos, *chunk);
+	pImpl->replay_pending_light(chunk_pos);
 
 	{
 		glm::ivec3 pos2;
@@ -985,7 +1222,9 @@ void world::set_chunk
 		}
 	}
 
-	pImpl->mesh_thread.enqueue(chunk);
+	// meshing now would mesh it again when each neighbor arrives
+	pImpl->set_stage(chunk_pos, chunk_stage::neighbors);
+	pImpl->waiting_for_neighbors.emplace(chunk_pos);
 	pImpl->update_chunk_neighbors(chunk_pos);
 }
 
@@ -1019,18 +1258,15 @@ shared_ptr<Chunk> world::get_or_make_chunk(const chunk_in_world& chunk_pos)
 		return chunk;
 	}
 
-	if(pImpl->file.has_chunk(chunk_pos))
-	{
-		pImpl->load_thread.enqueue(chunk_pos);
-	}
-	else
-	{
-		pImpl->gen_thread.enqueue(chunk_pos);
-	}
-
+	pImpl->request_chunk(chunk_pos, util::thread_pool::priority::normal);
 	return nullptr;
 }
 
+void world::gen_chunk(shared_ptr<Chunk>& chunk) const
+{
+	pImpl->gen_chunk(chunk);
+}
+
 void world::mark_chunk_active(const chunk_in_world& chunk_pos)
 {
 	pImpl->active_chunks.emplace(chunk_pos);
@@ -1038,36 +1274,27 @@ void world::mark_chunk_active(const chunk_in_world& chunk_pos)
 
 void world::step()
 {
-	shared_ptr<Chunk> chunk;
-	if(pImpl->loaded_chunks.try_dequeue(chunk))
-	{
-		chunk_in_world pos = chunk->get_position();
-		set_chunk(pos, chunk, false);
-		pImpl->load_thread.dequeue(pos);
-	}
-	if(pImpl->generated_chunks.try_dequeue(chunk))
-	{
-		chunk_in_world pos = chunk->get_position();
-		set_chunk(pos, chunk, true);
-		pImpl->gen_thread.dequeue(pos);
-		pImpl->chunks_to_save.emplace(chunk);
-	}
-	if(!pImpl->chunks_to_save.empty())
+	pImpl->integrate_finished_chunks();
+	for(auto i = pImpl->chunks_to_save.cbegin(); i != pImpl->chunks_to_save.cend();)
 	{
-		const auto i = pImpl->chunks_to_save.cbegin();
-		const shared_ptr<const Chunk> chunk = *i;
-		pImpl->chunks_to_save.erase(i);
-		if(chunk != nullptr)
+		const shared_ptr<const Chunk>& chunk = *i;
+		if(chunk == nullptr)
 		{
-			pImpl->file.save_chunk(*chunk);
+			// should not happen
+			i = pImpl->chunks_to_save.erase(i);
+			continue;
 		}
-		else
+		// when the writer is behind, the rest wait for a later tick instead of the frame waiting for the writer
+		if(!pImpl->chunk_writer.try_save(chunk->snapshot()))
 		{
-			// should not happen
+			break;
 		}
+		i = pImpl->chunks_to_save.erase(i);
 	}
+	pImpl->step_compaction();
 
 	pImpl->active_chunks.clear();
+	pImpl->prefetch_order.clear();
 
 	pImpl->process_light_sub(LIGHT_LAYER_BLOCK);
 	pImpl->process_light_sub(LIGHT_LAYER_SKY);
@@ -1075,32 +1302,56 @@ void world::step()
 	pImpl->process_light_add(LIGHT_LAYER_BLOCK);
 	pImpl->process_light_add(LIGHT_LAYER_SKY);
 
-	const auto render_distance = static_cast<uint64_t>(settings::get<int64_t>("render_distance"));
+	const auto render_distance = static_cast<chunk_in_world::value_type>(settings::get<int64_t>("render_distance"));
+	if(pImpl->view.get_render_distance() != render_distance)
+	{
+		pImpl->view = view_sphere(render_distance);
+	}
+	const bool prefetch = settings::get<bool>("chunk_prefetch");
 	for(auto& [name, player] : pImpl->players)
 	{
 		player->step(*this);
 
 		const chunk_in_world chunk_pos = player->view_position_chunk();
-		const chunk_in_world::value_type render_distance_ = static_cast<chunk_in_world::value_type>(render_distance);
-		const chunk_in_world min = chunk_pos - render_distance_;
-		const chunk_in_world max = chunk_pos + render_distance_;
+		for(const chunk_in_world& offset : pImpl->view.get_offsets())
+		{
+			mark_chunk_active(chunk_pos + offset);
+		}
 
-		chunk_in_world pos;
-		for(pos.x = min.x; pos.x <= max.x; ++pos.x)
-		for(pos.y = min.y; pos.y <= max.y; ++pos.y)
-		for(pos.z = min.z; pos.z <= max.z; ++pos.z)
+		if(prefetch)
+		{
+			pImpl->plan_prefetch(*player);
+		}
+	}
+	for(const chunk_in_world& chunk_pos : pImpl->prefetch_order)
+	{
+		pImpl->prefetch_planned.insert_or_assign(chunk_pos, pImpl->ticks);
+	}
+	pImpl->prefetch_chunks.clear();
+	for(auto i = pImpl->prefetch_planned.begin(); i != pImpl->prefetch_planned.end();)
+	{
+		const auto& [chunk_pos, planned_tick] = *i;
+		// another player may be near it
+		if(pImpl->active_chunks.count(chunk_pos) != 0
+		|| pImpl->ticks - planned_tick > PREFETCH_GRACE_TICKS)
 		{
-			mark_chunk_active(pos);
+			i = pImpl->prefetch_planned.erase(i);
+			continue;
 		}
+		pImpl->prefetch_chunks.emplace(chunk_pos);
+		++i;
 	}
+	pImpl->prefetcher.update(pImpl->active_chunks, pImpl->prefetch_chunks, [this](const chunk_in_world& chunk_pos)
+	{
+		return get_chunk(chunk_pos) != nullptr;
+	});
 
 	{
 		std::lock_guard<std::mutex> g(pImpl->chunks_mutex);
 		auto prev_chunks = std::move(pImpl->chunks);
 		for(const auto& [chunk_pos, chunk] : prev_chunks)
 		{
-			if(const auto i = pImpl->active_chunks.find(chunk_pos);
-				i != pImpl->active_chunks.cend())
+			if(pImpl->is_wanted(chunk_pos))
 			{
 				pImpl->chunks.emplace(chunk_pos, std::move(chunk));
 				continue;
@@ -1108,14 +1359,199 @@ void world::step()
 
 			// no need to add the chunk to pImpl->chunks_to_save
 			// if the chunk needs to be saved, it will already be there
+
+			pImpl->render_changes.insert_or_assign(chunk_pos, nullptr);
+			pImpl->waiting_for_neighbors.erase(chunk_pos);
+			std::lock_guard<std::mutex> g2(pImpl->chunk_stages_mutex);
+			pImpl->chunk_stages.erase(chunk_pos);
 		}
 	}
-	for(const auto& chunk_pos : pImpl->active_chunks)
+	pImpl->cancel_unwanted_jobs();
+	pImpl->request_active_chunks();
+	pImpl->request_prefetch();
+	pImpl->mesh_chunks_with_neighbors();
+	pImpl->measure_load_times();
+
+	pImpl->ticks += 1;
+}
+
+void world::impl::step_compaction()
+{
+	const auto now = std::chrono::steady_clock::now();
+	if(compacting.empty())
 	{
-		get_or_make_chunk(chunk_pos);
+		// the next compaction only asks about the snapshots queued after it starts
+		chunk_writer.forget_saved_through(chunk_writer.last_ticket());
+		const std::chrono::duration<double> interval(settings::get<double>("chunk_compaction_interval_s"));
+		if(chunks_to_compact.empty() || now - last_compaction < interval)
+		{
+			return;
+		}
+		// every change up to here is in the chunks, so the snapshots taken from now on have them
+		compaction_sequence = journal.last_sequence();
+		compaction_start_ticket = chunk_writer.last_ticket();
+		compaction_end_ticket = 0;
+		compacting_queued = 0;
+		compacting.assign(std::make_move_iterator(chunks_to_compact.begin()), std::make_move_iterator(chunks_to_compact.end()));
+		chunks_to_compact.clear();
 	}
 
-	pImpl->ticks += 1;
+	// like chunks_to_save, the rest wait for a later tick when the writer is behind
+	for(; compacting_queued < compacting.size(); ++compacting_queued)
+	{
+		if(!chunk_writer.try_save(compacting[compacting_queued].second->snapshot()))
+		{
+			return;
+		}
+	}
+	if(compaction_end_ticket == 0)
+	{
+		compaction_end_ticket = chunk_writer.last_ticket();
+	}
+
+	// checked each tick instead of waited for, so that neither this thread nor the journal's waits on the writer
+	if(!chunk_writer.written_through(compaction_end_ticket))
+	{
+		return;
+	}
+	finish_compaction();
+	last_compaction = now;
+}
+
+void world::impl::finish_compaction()
+{
+	std::vector<chunk_in_world> saved;
+	for(auto& [pos, chunk] : compacting)
+	{
+		if(chunk_writer.saved_since(pos, compaction_start_ticket))
+		{
+			saved.emplace_back(pos);
+		}
+		else
+		{
+			// a newer copy that is waiting for the next compaction has these changes too
+			chunks_to_compact.emplace(pos, std::move(chunk));
+		}
+	}
+	if(saved.size() != compacting.size())
+	{
+		LOG(WARN) << (compacting.size() - saved.size()) << " chunks were not saved; their changes stay in the journal\n";
+	}
+	compacting.clear();
+	compacting_queued = 0;
+
+	if(!saved.empty())
+	{
+		// the sync is quick next to the rewrite it comes before, so it is done on the journal's thread
+		journal.compact(compaction_sequence, saved, [this, saved]()
+		{
+			file.sync_chunks(saved);
+		});
+	}
+}
+
+void world::impl::integrate_finished_chunks()
+{
+	shared_ptr<Chunk> chunk;
+	while(generated_chunks.try_dequeue(chunk))
+	{
+		finished_chunks.push_back({std::move(chunk), true, 0});
+	}
+	while(loaded_chunks.try_dequeue(chunk))
+	{
+		finished_chunks.push_back({std::move(chunk), false, 0});
+	}
+
+	if(!finished_chunks.empty())
+	{
+		std::vector<chunk_in_world> player_positions;
+		player_positions.reserve(players.size());
+		for(const auto& [name, player] : players)
+		{
+			player_positions.emplace_back(player->view_position_chunk());
+		}
+		for(finished_chunk& finished : finished_chunks)
+		{
+			const chunk_in_world pos = finished.chunk->get_position();
+			finished.distance = std::numeric_limits<int64_t>::max();
+			for(const chunk_in_world& player_pos : player_positions)
+			{
+				const chunk_in_world d = pos - player_pos;
+				finished.distance = std::min(finished.distance, d.x * d.x + d.y * d.y + d.z * d.z);
+			}
+		}
+		// nearest last, so they can be popped off the back
+		std::sort(finished_chunks.begin(), finished_chunks.end(), [](const finished_chunk& a, const finished_chunk& b)
+		{
+			return a.distance > b.distance;
+		});
+	}
+
+	const auto budget = std::chrono::duration<double, std::milli>(settings::get<double>("chunk_integration_budget_ms"));
+	const auto start = std::chrono::steady_clock::now();
+	batching_neighbor_meshes = true;
+	// at least one chunk is integrated each tick, even if the budget is 0
+	bool integrated_any = false;
+	while(!finished_chunks.empty())
+	{
+		if(integrated_any && std::chrono::steady_clock::now() - start >= budget)
+		{
+			break;
+		}
+
+		const finished_chunk finished = std::move(finished_chunks.back());
+		finished_chunks.pop_back();
+		const chunk_in_world pos = finished.chunk->get_position();
+		auto& thread = finished.generated ? gen_thread : load_thread;
+		if(thread.is_cancelled(pos))
+		{
+			// dropping is cheap, so it does not count against the budget
+			thread.drop(pos);
+			continue;
+		}
+
+		// the light was saved with it or gen_thread lit it
+		this_world.set_chunk(pos, finished.chunk, false);
+		thread.dequeue(pos);
+		if(journal.has_changes(pos))
+		{
+			// replaces an older copy of the chunk that was unloaded before it was compacted
+			// (compacting saves it, so it is not saved twice)
+			chunks_to_compact.insert_or_assign(pos, finished.chunk);
+		}
+		// pristine chunks are generated again when they are wanted again, instead of being saved
+		else if(finished.generated && !finished.chunk->is_pristine())
+		{
+			chunks_to_save.emplace(finished.chunk);
+		}
+		integrated_any = true;
+		++integrated_count;
+	}
+	batching_neighbor_meshes = false;
+	flush_neighbor_meshes();
+
+	const auto now = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(now - integrated_rate_start).count();
+	if(seconds >= 1)
+	{
+		integrated_per_second = (integrated_count - integrated_rate_start_count) / seconds;
+		integrated_rate_start = now;
+		integrated_rate_start_count = integrated_count;
+	}
+}
+
+void world::impl::flush_neighbor_meshes()
+{
+	for(const auto& [chunk_pos, sections] : batched_neighbor_meshes)
+	{
+		const shared_ptr<Chunk> chunk = this_world.get_chunk(chunk_pos);
+		// it might have been integrated after it was added here
+		if(chunk != nullptr && get_stage(chunk_pos) != chunk_stage::neighbors)
+		{
+			queue_mesh(chunk, sections);
+		}
+	}
+	batched_neighbor_meshes.clear();
 }
 
 shared_ptr<Player> world::add_player(const string& name)
@@ -1150,18 +1586,83 @@ void world::save_all()
 		pImpl->file.save_player(*player);
 	}
 
-	while(!pImpl->chunks_to_save.empty())
+	pImpl->journal.commit();
+
+	for(const shared_ptr<const Chunk>& chunk : pImpl->chunks_to_save)
 	{
-		const auto i = pImpl->chunks_to_save.cbegin();
-		const shared_ptr<const Chunk> chunk = *i;
-		pImpl->chunks_to_save.erase(i);
 		if(chunk == nullptr)
 		{
 			// should not happen
 			continue;
 		}
-		pImpl->file.save_chunk(*chunk);
+		pImpl->chunk_writer.save(chunk->snapshot());
+	}
+	pImpl->chunks_to_save.clear();
+
+	// everything is compacted now, including a compaction that was in progress
+	for(auto& [pos, chunk] : pImpl->compacting)
+	{
+		// a chunk in both is newer in chunks_to_compact
+		pImpl->chunks_to_compact.emplace(pos, std::move(chunk));
 	}
+	pImpl->compacting.assign
+	(
+		std::make_move_iterator(pImpl->chunks_to_compact.begin()),
+		std::make_move_iterator(pImpl->chunks_to_compact.end())
+	);
+	pImpl->chunks_to_compact.clear();
+	pImpl->compaction_sequence = pImpl->journal.last_sequence();
+	pImpl->compaction_start_ticket = pImpl->chunk_writer.last_ticket();
+	for(const auto& [pos, chunk] : pImpl->compacting)
+	{
+		pImpl->chunk_writer.save(chunk->snapshot());
+	}
+
+	// the chunks are written in parallel on the thread pool
+	pImpl->chunk_writer.flush([](const std::size_t written, const std::size_t total)
+	{
+		if(total != 0)
+		{
+			LOG(INFO) << "saving chunks: " << written << '/' << total << '\n';
+		}
+	});
+	// the writer's saves are synced in batches, by compactions and here
+	pImpl->file.sync_all();
+	pImpl->finish_compaction();
+	pImpl->last_compaction = std::chrono::steady_clock::now();
+}
+
+storage::codec world::get_chunk_codec() const
+{
+	return pImpl->file.get_chunk_codec();
+}
+
+void world::set_chunk_codec(const storage::codec codec)
+{
+	// chunks already saved keep their codec until they are saved again
+	pImpl->file.set_chunk_codec(codec);
+}
+
+bool world::get_save_light() const
+{
+	return pImpl->file.get_save_light();
+}
+
+void world::set_save_light(const bool save)
+{
+	// like the codec, chunks already saved keep or omit their light until they are saved again
+	pImpl->file.set_save_light(save);
+}
+
+storage::chunk_load_stats world::get_chunk_load_stats() const
+{
+	return pImpl->file.get_load_stats();
+}
+
+std::size_t world::migrate_chunk_files()
+{
+	// the writer does not need to be flushed first, since a chunk file is not moved over a copy that the writer saved
+	return pImpl->file.migrate_chunk_files();
 }
 
 string world::get_name() const
@@ -1182,6 +1683,28 @@ void world::set_seed(const double seed)
 	pImpl->seed = seed;
 }
 
+void world::set_generator(shared_ptr<const generator> gen)
+{
+	assert(gen != nullptr);
+	pImpl->generator_name = gen->get_name();
+	std::atomic_store(&pImpl->chunk_generator, std::move(gen));
+}
+
+bool world::has_generator() const
+{
+	return std::atomic_load(&pImpl->chunk_generator) != nullptr;
+}
+
+string world::get_generator_name() const
+{
+	return pImpl->generator_name;
+}
+
+generator_stats world::get_generator_stats() const
+{
+	return pImpl->gen_timings.get();
+}
+
 uint_fast64_t world::get_ticks() const
 {
 	return pImpl->ticks;
@@ -1208,7 +1731,7 @@ bool world::is_meshing_queued(const shared_ptr<const Chunk>& chunk) const
 	{
 		return false;
 	}
-	return pImpl->mesh_thread.has(chunk);
+	return pImpl->mesh_thread.has({std::const_pointer_cast<Chunk>(chunk), 0});
 }
 
 bool world::is_meshing_queued(const chunk_in_world& chunk_pos) const
@@ -1216,17 +1739,129 @@ bool world::is_meshing_queued(const chunk_in_world& chunk_pos) const
 	return is_meshing_queued(get_chunk(chunk_pos));
 }
 
+std::tuple<uint64_t, uint64_t> world::get_chunk_job_counts() const
+{
+	return
+	{
+		pImpl->gen_thread.completed_count() + pImpl->load_thread.completed_count(),
+		pImpl->gen_thread.cancelled_count() + pImpl->load_thread.cancelled_count(),
+	};
+}
+
+double world::get_chunks_integrated_per_second() const
+{
+	return pImpl->integrated_per_second;
+}
+
+prefetch_stats world::get_prefetch_stats() const
+{
+	return pImpl->prefetcher.get_stats();
+}
+
+std::tuple<std::optional<double>, std::optional<double>> world::get_load_times() const
+{
+	return {pImpl->playable_seconds, pImpl->loaded_seconds};
+}
+
+chunk_stage_counts_t world::get_chunk_stage_counts()
+{
+	std::vector<std::tuple<chunk_in_world, chunk_stage>> stages;
+	{
+		std::lock_guard<std::mutex> g(pImpl->chunk_stages_mutex);
+		stages.reserve(pImpl->chunk_stages.size());
+		for(const auto& [pos, stage] : pImpl->chunk_stages)
+		{
+			stages.emplace_back(pos, stage);
+		}
+	}
+
+	chunk_stage_counts_t counts{};
+	for(const auto& [pos, stage] : stages)
+	{
+		if(stage == chunk_stage::upload)
+		{
+			// the chunk uploads its mesh when it is drawn, which it does not report back
+			const shared_ptr<const Chunk> chunk = get_chunk(pos);
+			if(chunk == nullptr || !chunk->is_upload_pending())
+			{
+				pImpl->advance_stage(pos, chunk_stage::upload, chunk_stage::ready);
+				++counts[static_cast<std::size_t>(chunk_stage::ready)];
+				continue;
+			}
+		}
+		++counts[static_cast<std::size_t>(stage)];
+	}
+	return counts;
+}
+
+void world::request_lod_mesh(const shared_ptr<Chunk>& chunk, const uint8_t lod_level)
+{
+	assert(chunk != nullptr);
+	assert(lod_level > 0);
+	if(chunk->has_lod(lod_level))
+	{
+		return;
+	}
+	pImpl->mesh_thread.enqueue({chunk, lod_level});
+}
+
+void world::take_render_changes(position::unordered_map_t<chunk_in_world, shared_ptr<Chunk>>& changes)
+{
+	changes.clear();
+	std::lock_guard<std::mutex> g(pImpl->chunks_mutex);
+	std::swap(changes, pImpl->render_changes);
+}
+
 void world::save(msgpack::packer<std::ofstream>& o) const
 {
-	o.pack_array(8);
+	// the light that is still queued is kept with the changes waiting for their chunk
+	position::unordered_map_t<chunk_in_world, pending_light> pending = pImpl->pending_light_by_chunk;
+	for(std::size_t layer = 0; layer < LIGHT_LAYER_COUNT; ++layer)
+	{
+		for(const auto* queue : {&pImpl->light_sub1[layer], &pImpl->light_sub2[layer]})
+		{
+			for(const auto& [pos, color] : *queue)
+			{
+				pending[chunk_in_world(pos)].sub(layer, block_in_chunk(pos), color);
+			}
+		}
+		for(const auto* queue : {&pImpl->light_add1[layer], &pImpl->light_add2[layer]})
+		{
+			for(const block_in_world& pos : *queue)
+			{
+				pending[chunk_in_world(pos)].add(layer, block_in_chunk(pos));
+			}
+		}
+	}
+
+	o.pack_array(12);
 	o.pack(pImpl->name);
 	o.pack(pImpl->seed);
 	o.pack(pImpl->ticks);
 	o.pack(block_manager);
-	o.pack(pImpl->light_sub1);
-	o.pack(pImpl->light_sub2);
-	o.pack(pImpl->light_add1);
-	o.pack(pImpl->light_add2);
+	// where the light queues were before element 10, empty for each layer
+	for(uint_fast8_t i = 0; i < 4; ++i)
+	{
+		o.pack_array(LIGHT_LAYER_COUNT);
+		for(std::size_t layer = 0; layer < LIGHT_LAYER_COUNT; ++layer)
+		{
+			o.pack_array(0);
+		}
+	}
+	std::ostringstream codec;
+	codec << pImpl->file.get_chunk_codec();
+	o.pack(codec.str());
+	o.pack(pImpl->file.get_save_light());
+	o.pack_array(static_cast<uint32_t>(pending.size()));
+	for(auto& [chunk_pos, light] : pending)
+	{
+		const string bytes = light.write();
+		o.pack_array(2);
+		o.pack(chunk_pos);
+		o.pack_bin(static_cast<uint32_t>(bytes.size()));
+		o.pack_bin_body(bytes.data(), static_cast<uint32_t>(bytes.size()));
+	}
+	o.pack(pImpl->generator_name);
 }
 
 template<typename T, std::size_t N>
@@ -1242,7 +1877,9 @@ void load_deques(std::deque<T>(&d)[N], const msgpack::object& o)
 void world::load(const msgpack::object& o)
 {
 	if(o.type != msgpack::type::ARRAY) throw msgpack::type_error();
-	if(o.via.array.size != 8) throw msgpack::type_error();
+	// worlds saved before chunk codecs have 8, before the light option 9, before pending light by chunk 10, and
+	// before generators 11
+	if(o.via.array.size < 8 || o.via.array.size > 12) throw msgpack::type_error();
 	const auto& a = o.via.array.ptr;
 
 	pImpl->name = a[0].as<string>();
@@ -1250,10 +1887,83 @@ void world::load(const msgpack::object& o)
 	pImpl->ticks = a[2].as<uint64_t>();
 	block_manager.load(a[3]);
 
-	load_deques(pImpl->light_sub1, a[4]);
-	load_deques(pImpl->light_sub2, a[5]);
-	load_deques(pImpl->light_add1, a[6]);
-	load_deques(pImpl->light_add2, a[7]);
+	// no chunk is loaded yet, so everything that was queued waits for its chunk
+	pImpl->pending_light_by_chunk.clear();
+	{
+		std::deque<std::tuple<block_in_world, graphics::color>> subs[2][LIGHT_LAYER_COUNT];
+		std::deque<block_in_world> adds[2][LIGHT_LAYER_COUNT];
+		load_deques(subs[0], a[4]);
+		load_deques(subs[1], a[5]);
+		load_deques(adds[0], a[6]);
+		load_deques(adds[1], a[7]);
+		for(std::size_t i = 0; i < 2; ++i)
+		for(std::size_t layer = 0; layer < LIGHT_LAYER_COUNT; ++layer)
+		{
+			for(const auto& [pos, color] : subs[i][layer])
+			{
+				pImpl->pending_light_by_chunk[chunk_in_world(pos)].sub(layer, block_in_chunk(pos), color);
+			}
+			for(const block_in_world& pos : adds[i][layer])
+			{
+				pImpl->pending_light_by_chunk[chunk_in_world(pos)].add(layer, block_in_chunk(pos));
+			}
+		}
+	}
+	for(std::size_t layer = 0; layer < LIGHT_LAYER_COUNT; ++layer)
+	{
+		pImpl->light_sub1[layer].clear();
+		pImpl->light_sub2[layer].clear();
+		pImpl->light_add1[layer].clear();
+		pImpl->light_add2[layer].clear();
+	}
+
+	if(o.via.array.size > 8)
+	{
+		const string name = a[8].as<string>();
+		const auto codec = storage::codec_from_name(name);
+		if(codec == nullopt)
+		{
+			LOG(ERROR) << "unknown chunk codec " << name << "; using " << pImpl->file.get_chunk_codec() << '\n';
+		}
+		else
+		{
+			pImpl->file.set_chunk_codec(*codec);
+		}
+	}
+	if(o.via.array.size > 9)
+	{
+		pImpl->file.set_save_light(a[9].as<bool>());
+	}
+	if(o.via.array.size > 10)
+	{
+		const msgpack::object& pending = a[10];
+		if(pending.type != msgpack::type::ARRAY) throw msgpack::type_error();
+		for(uint32_t i = 0; i < pending.via.array.size; ++i)
+		{
+			const msgpack::object& item = pending.via.array.ptr[i];
+			if(item.type != msgpack::type::ARRAY || item.via.array.size != 2) throw msgpack::type_error();
+			const auto chunk_pos = item.via.array.ptr[0].as<chunk_in_world>();
+			const msgpack::object& bytes = item.via.array.ptr[1];
+			if(bytes.type != msgpack::type::BIN) throw msgpack::type_error();
+			try
+			{
+				pImpl->pending_light_by_chunk.insert_or_assign(chunk_pos, pending_light::read({bytes.via.bin.ptr, bytes.via.bin.size}));
+			}
+			catch(const std::runtime_error& e)
+			{
+				// the chunk's light may be wrong where it meets its neighbors, which is better than not loading
+				LOG(WARN) << "dropping the pending light of chunk " << chunk_pos << ": " << e.what() << '\n';
+			}
+		}
+	}
+	// worlds saved before generators were made by terrain_generator
+	pImpl->generator_name = o.via.array.size > 11 ? a[11].as<string>() : terrain_generator::NAME;
+	const shared_ptr<const generator> gen = std::atomic_load(&pImpl->chunk_generator);
+	if(gen == nullptr || gen->get_name() != pImpl->generator_name)
+	{
+		// until set_generator is given the right one
+		std::atomic_store(&pImpl->chunk_generator, shared_ptr<const generator>());
+	}
 }
 
 void world::impl::update_chunk_neighbors
@@ -1262,12 +1972,13 @@ void world::impl::update_chunk_neighbors
 	const bool thread
 )
 {
-	update_chunk_neighbor(chunk_pos, {-1,  0,  0}, thread);
-	update_chunk_neighbor(chunk_pos, {+1,  0,  0}, thread);
-	update_chunk_neighbor(chunk_pos, { 0, -1,  0}, thread);
-	update_chunk_neighbor(chunk_pos, { 0, +1,  0}, thread);
-	update_chunk_neighbor(chunk_pos, { 0,  0, -1}, thread);
-	update_chunk_neighbor(chunk_pos, { 0,  0, +1}, thread);
+	// every section, so that the neighbors are meshed whole (only block edits remesh part of a chunk)
+	update_chunk_neighbor(chunk_pos, {-1,  0,  0}, mesher::ALL_SECTIONS, thread);
+	update_chunk_neighbor(chunk_pos, {+1,  0,  0}, mesher::ALL_SECTIONS, thread);
+	update_chunk_neighbor(chunk_pos, { 0, -1,  0}, mesher::ALL_SECTIONS, thread);
+	update_chunk_neighbor(chunk_pos, { 0, +1,  0}, mesher::ALL_SECTIONS, thread);
+	update_chunk_neighbor(chunk_pos, { 0,  0, -1}, mesher::ALL_SECTIONS, thread);
+	update_chunk_neighbor(chunk_pos, { 0,  0, +1}, mesher::ALL_SECTIONS, thread);
 }
 
 void world::impl::update_chunk_neighbors
@@ -1281,32 +1992,35 @@ void world::impl::update_chunk_neighbors
 	const auto y = pos.y;
 	const auto z = pos.z;
 
+	// the neighbor's blocks beside this one are in the same slice (y and z) or in its first/last slice (x)
+	const mesher::section_mask_t same = mesher::sections_for_slices(x, x);
+
 	// TODO: check if the neighbor chunk has a block beside this one (to avoid updating when the appearance won't change)
 	if(x == 0)
 	{
-		update_chunk_neighbor(chunk_pos, {-1, 0, 0}, thread);
+		update_chunk_neighbor(chunk_pos, {-1, 0, 0}, mesher::sections_for_slices(CHUNK_SIZE - 1, CHUNK_SIZE - 1), thread);
 	}
 	else if(x == CHUNK_SIZE - 1)
 	{
-		update_chunk_neighbor(chunk_pos, {+1, 0, 0}, thread);
+		update_chunk_neighbor(chunk_pos, {+1, 0, 0}, mesher::sections_for_slices(0, 0), thread);
 	}
 
 	if(y == 0)
 	{
-		update_chunk_neighbor(chunk_pos, {0, -1, 0}, thread);
+		update_chunk_neighbor(chunk_pos, {0, -1, 0}, same, thread);
 	}
 	else if(y == CHUNK_SIZE - 1)
 	{
-		update_chunk_neighbor(chunk_pos, {0, +1, 0}, thread);
+		update_chunk_neighbor(chunk_pos, {0, +1, 0}, same, thread);
 	}
 
 	if(z == 0)
 	{
-		update_chunk_neighbor(chunk_pos, {0, 0, -1}, thread);
+		update_chunk_neighbor(chunk_pos, {0, 0, -1}, same, thread);
 	}
 	else if(z == CHUNK_SIZE - 1)
 	{
-		update_chunk_neighbor(chunk_pos, {0, 0, +1}, thread);
+		update_chunk_neighbor(chunk_pos, {0, 0, +1}, same, thread);
 	}
 }
 
@@ -1314,96 +2028,396 @@ void world::impl::update_chunk_neighbor
 (
 	const chunk_in_world& chunk_pos,
 	const chunk_in_world& offset,
+	const mesher::section_mask_t sections,
 	const bool thread
 )
 {
-	const shared_ptr<Chunk> chunk = this_world.get_chunk(chunk_pos + offset);
-	if(chunk != nullptr)
+	const chunk_in_world neighbor_pos = chunk_pos + offset;
+	const shared_ptr<Chunk> chunk = this_world.get_chunk(neighbor_pos);
+	// a chunk waiting for its neighbors is meshed completely later
+	if(chunk == nullptr || get_stage(neighbor_pos) == chunk_stage::neighbors)
+	{
+		return;
+	}
+	if(batching_neighbor_meshes && thread)
 	{
-		if(thread)
+		batched_neighbor_meshes[neighbor_pos] |= sections;
+		return;
+	}
+	queue_mesh(chunk, sections, thread);
+}
+
+void world::impl::queue_mesh
+(
+	const shared_ptr<Chunk>& chunk,
+	const mesher::section_mask_t sections,
+	const bool thread
+)
+{
+	if(thread)
+	{
+		chunk->mark_sections_dirty(sections);
+		mesh_thread.enqueue({chunk, 0});
+	}
+	else
+	{
+		chunk->update_sections(sections);
+	}
+}
+
+std::optional<chunk_stage> world::impl::get_stage(const chunk_in_world& chunk_pos) const
+{
+	std::lock_guard<std::mutex> g(chunk_stages_mutex);
+	if(const auto i = chunk_stages.find(chunk_pos);
+		i != chunk_stages.cend())
+	{
+		return i->second;
+	}
+	return nullopt;
+}
+
+void world::impl::set_stage(const chunk_in_world& chunk_pos, const chunk_stage stage)
+{
+	std::lock_guard<std::mutex> g(chunk_stages_mutex);
+	chunk_stages.insert_or_assign(chunk_pos, stage);
+}
+
+void world::impl::advance_stage(const chunk_in_world& chunk_pos, const chunk_stage from, const chunk_stage to)
+{
+	std::lock_guard<std::mutex> g(chunk_stages_mutex);
+	if(const auto i = chunk_stages.find(chunk_pos);
+		i != chunk_stages.cend() && i->second == from)
+	{
+		i->second = to;
+	}
+}
+
+void world::impl::cancel_unwanted_jobs()
+{
+	std::vector<chunk_in_world> unwanted;
+	{
+		std::lock_guard<std::mutex> g(chunk_stages_mutex);
+		for(auto i = chunk_stages.begin(); i != chunk_stages.end();)
 		{
-			mesh_thread.enqueue(chunk);
+			const auto& [chunk_pos, stage] = *i;
+			const bool in_worker =
+				   stage == chunk_stage::load
+				|| stage == chunk_stage::generate
+				|| stage == chunk_stage::light
+				|| stage == chunk_stage::integrate;
+			if(!in_worker || is_wanted(chunk_pos))
+			{
+				++i;
+				continue;
+			}
+			unwanted.emplace_back(chunk_pos);
+			// the workers only advance stages that exist, so this also stops them from tracking it
+			i = chunk_stages.erase(i);
 		}
-		else
+	}
+	for(const chunk_in_world& chunk_pos : unwanted)
+	{
+		// only one of these has it
+		gen_thread.cancel(chunk_pos);
+		load_thread.cancel(chunk_pos);
+	}
+}
+
+bool world::impl::request_chunk(const chunk_in_world& chunk_pos, const util::thread_pool::priority priority)
+{
+	// the stage is set before enqueueing, so that it does not overwrite a later stage set by the worker
+	const bool has_stage = get_stage(chunk_pos) != nullopt;
+	if(file.has_chunk(chunk_pos))
+	{
+		if(!has_stage)
 		{
-			chunk->update();
+			set_stage(chunk_pos, chunk_stage::load);
 		}
+		load_thread.enqueue(chunk_pos, priority);
 	}
+	else
+	{
+		if(std::atomic_load(&chunk_generator) == nullptr)
+		{
+			// requested again while it is wanted, once set_generator is called
+			return false;
+		}
+		if(!has_stage)
+		{
+			set_stage(chunk_pos, chunk_stage::generate);
+		}
+		gen_thread.enqueue(chunk_pos, priority);
+	}
+	return !has_stage;
 }
 
-static double sum_noise
-(
-	const double seed,
-	const glm::dvec2& P_,
-	const double base_freq,
-	const double freq_mul,
-	const std::size_t iterations
-)
+void world::impl::plan_prefetch(const Player& player)
+{
+	prefetcher.plan
+	(
+		player.view_position(),
+		player.world_velocity() * TICKS_PER_SECOND,
+		player.look_direction(),
+		view,
+		prefetch_order
+	);
+}
+
+void world::impl::request_active_chunks()
 {
-	const glm::dvec3 P(P_, seed);
-	double val = 0;
-	double freq = base_freq;
-	for(std::size_t i = 0; i < iterations; i++)
+	const double look_weight = std::clamp(settings::get<double>("chunk_order_look_weight"), 0.0, 1.0);
+	active_requests.clear();
+	for(const auto& [name, player] : players)
+	{
+		const chunk_in_world chunk_pos = player->view_position_chunk();
+		const glm::dvec3 view_position = player->view_position();
+		const glm::dvec3 look = player->look_direction();
+		const auto& offsets = view.get_offsets();
+		for(std::size_t i = 0; i < offsets.size(); ++i)
+		{
+			const chunk_in_world pos = chunk_pos + offsets[i];
+			if(this_world.get_chunk(pos) != nullptr)
+			{
+				continue;
+			}
+			const glm::dvec3 center = (glm::dvec3(chunk_in_world::vec_type(pos)) + 0.5) * static_cast<double>(CHUNK_SIZE);
+			// the chunks around the player are needed to play (and to mesh their own chunk), wherever they look
+			const bool far = i >= view.get_near_count();
+			active_requests.emplace_back(far, view_weighted_distance(center - view_position, look, look_weight), pos);
+		}
+	}
+	// the offsets are nearest first, so this only moves chunks past others of about the same distance
+	std::stable_sort(active_requests.begin(), active_requests.end(), [](const auto& a, const auto& b)
 	{
-		val += std::abs(glm::simplex(P * freq) / freq);
-		freq *= freq_mul;
+		return std::tie(std::get<0>(a), std::get<1>(a)) < std::tie(std::get<0>(b), std::get<1>(b));
+	});
+	for(const auto& [far, key, pos] : active_requests)
+	{
+		// queued chunks are queued again too, to move up the ones that were prefetched
+		request_chunk(pos, util::thread_pool::priority::normal);
 	}
-	return val;
 }
 
-void world::impl::gen_chunk(shared_ptr<Chunk>& chunk) const
+void world::impl::measure_load_times()
 {
-	assert(chunk != nullptr);
+	if(loaded_seconds != nullopt || players.empty())
+	{
+		return;
+	}
+
+	const auto& offsets = view.get_offsets();
+	const std::size_t near_count = view.get_near_count();
+	bool near_meshed = true;
+	bool all_meshed = true;
+	for(const auto& [name, player] : players)
+	{
+		const chunk_in_world chunk_pos = player->view_position_chunk();
+		std::size_t meshed_count = 0;
+		while(meshed_count < offsets.size() && is_meshed(chunk_pos + offsets[meshed_count]))
+		{
+			++meshed_count;
+		}
+		near_meshed = near_meshed && meshed_count >= near_count;
+		all_meshed = all_meshed && meshed_count == offsets.size();
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+	if(near_meshed && playable_seconds == nullopt)
+	{
+		playable_seconds = seconds;
+		LOG(INFO) << "first playable frame after " << seconds << "s (the chunks around each player are meshed)\n";
+	}
+	if(all_meshed)
+	{
+		loaded_seconds = seconds;
+		LOG(INFO) << "every chunk within render distance is meshed after " << seconds << "s\n";
+	}
+}
 
-	const chunk_in_world chunk_pos = chunk->get_position();
-	const block_in_world min(chunk_pos, {0, 0, 0});
-	const block_in_world max(chunk_pos, {CHUNK_SIZE - 1, CHUNK_SIZE - 1, CHUNK_SIZE - 1});
+bool world::impl::is_meshed(const chunk_in_world& chunk_pos) const
+{
+	const std::optional<chunk_stage> stage = get_stage(chunk_pos);
+	return stage == chunk_stage::upload
+		|| stage == chunk_stage::ready;
+}
+
+void world::impl::request_prefetch()
+{
+	std::size_t requests = 0;
+	for(const chunk_in_world& chunk_pos : prefetch_order)
+	{
+		if(requests == MAX_PREFETCH_REQUESTS_PER_TICK)
+		{
+			break;
+		}
+		// an active chunk that is queued is moved up to normal priority by get_or_make_chunk, so it is not queued here
+		if(prefetch_chunks.count(chunk_pos) != 0
+		&& this_world.get_chunk(chunk_pos) == nullptr
+		&& request_chunk(chunk_pos, util::thread_pool::priority::low))
+		{
+			prefetcher.requested(chunk_pos);
+			++requests;
+		}
+	}
+}
+
+bool world::impl::is_wanted(const chunk_in_world& chunk_pos) const
+{
+	return active_chunks.count(chunk_pos) != 0
+		|| prefetch_chunks.count(chunk_pos) != 0;
+}
 
-	block_in_world block_pos(0, 0, 0);
-	for(auto x = min.x; x <= max.x; ++x)
-	for(auto z = min.z; z <= max.z; ++z)
+void world::impl::mesh_chunks_with_neighbors()
+{
+	static const chunk_in_world offsets[]
+	{
+		{-1,  0,  0},
+		{+1,  0,  0},
+		{ 0, -1,  0},
+		{ 0, +1,  0},
+		{ 0,  0, -1},
+		{ 0,  0, +1},
+	};
+	for(auto i = waiting_for_neighbors.begin(); i != waiting_for_neighbors.end();)
 	{
-		const double m = 20;
-		if(min.y > 0)
+		const chunk_in_world chunk_pos = *i;
+		bool neighbors_ready = true;
+		for(const chunk_in_world& offset : offsets)
 		{
+			const chunk_in_world neighbor_pos = chunk_pos + offset;
+			// a neighbor that is not wanted will not arrive, so it is not waited for
+			// (nor is a prefetched one, which may not be queued yet; the chunk is meshed again when it arrives)
+			if(active_chunks.count(neighbor_pos) != 0
+			&& this_world.get_chunk(neighbor_pos) == nullptr)
+			{
+				neighbors_ready = false;
+				break;
+			}
+		}
+		if(!neighbors_ready)
+		{
+			++i;
 			continue;
 		}
 
-		// https://www.shadertoy.com/view/Xl3GWS
-		auto get_max_y = [seed=this->seed](const block_in_world::value_type x, const block_in_world::value_type z) -> double
+		i = waiting_for_neighbors.erase(i);
+		const shared_ptr<Chunk> chunk = this_world.get_chunk(chunk_pos);
+		if(chunk != nullptr)
 		{
-			// coords must not be (0, 0) (it makes this function always return 0)
-			const glm::dvec2 coords = (x == 0 && z == 0) ? glm::dvec2(0.0001) : glm::dvec2(x, z) / 1024.0;
-			const glm::dvec2 n(-sum_noise(seed, coords, 1, 2.07, 8));
+			set_stage(chunk_pos, chunk_stage::mesh);
+			queue_mesh(chunk, mesher::ALL_SECTIONS);
+		}
+	}
+}
 
-			const double a = n.x * n.y;
-			const double b = glm::mod(a, 1.0);
-			const auto d = static_cast<uint_fast8_t>(glm::mod(ceil(a), 2.0));
-			return (d == 0 ? b : 1 - b) - 1;
-		};
+void world::impl::light_new_chunk(Chunk& chunk)
+{
+	const auto start = std::chrono::steady_clock::now();
+	light_chunk(chunk, this_world.block_manager.info, skylight_color);
+	chunk.set_light_costly(std::chrono::steady_clock::now() - start > RELIGHT_BUDGET);
+	chunk.set_light_stamp(light_stamp(this_world.block_manager.info, skylight_color));
+}
 
-		const auto real_max_y = static_cast<block_in_world::value_type>(std::round(get_max_y(x, z) * m));
-		const auto max_y = max.y <= -m ? max.y : std::min(max.y, real_max_y);
+void world::impl::seed_light_at_sides(const chunk_in_world& chunk_pos, const Chunk& chunk)
+{
+	// light goes from `from` to `to` if it is brighter there after dimming
+	// this ignores light filters, which only means that some of the queued blocks do nothing
+	auto flows = [this](const graphics::color& from, const graphics::color& to, const bool down_in_sky)
+	{
+		const graphics::color dimmed = (down_in_sky && from == skylight_color) ? from : from - 1;
+		return dimmed.r > to.r || dimmed.g > to.g || dimmed.b > to.b;
+	};
+
+	for(uint_fast8_t axis = 0; axis < 3; ++axis)
+	for(const int direction : {-1, +1})
+	{
+		chunk_in_world neighbor_pos = chunk_pos;
+		neighbor_pos[axis] += direction;
+		const shared_ptr<const Chunk> neighbor = this_world.get_chunk(neighbor_pos);
+		if(neighbor == nullptr)
+		{
+			continue;
+		}
 
-		block_pos.x = x;
-		block_pos.z = z;
-		for(auto y = min.y; y <= max_y; ++y)
+		const uint_fast8_t a1 = (axis + 1) % 3;
+		const uint_fast8_t a2 = (axis + 2) % 3;
+		block_in_chunk pos;
+		block_in_chunk neighbor_block_pos;
+		pos[axis] = static_cast<block_in_chunk::value_type>((direction < 0) ? 0 : CHUNK_SIZE - 1);
+		neighbor_block_pos[axis] = static_cast<block_in_chunk::value_type>((direction < 0) ? CHUNK_SIZE - 1 : 0);
+		for(pos[a1] = 0; pos[a1] < CHUNK_SIZE; ++pos[a1])
+		for(pos[a2] = 0; pos[a2] < CHUNK_SIZE; ++pos[a2])
 		{
-			block_pos.y = y;
+			neighbor_block_pos[a1] = pos[a1];
+			neighbor_block_pos[a2] = pos[a2];
 
-			// TODO: investigate performance of using strings here vs caching the IDs
-			const string t = y > -m / 2 ? "test_white" : "test_black";
-			const auto block = this_world.block_manager.get_block(t);
-			if(block != nullopt)
+			const bool down = (axis == 1 && direction < 0);
+			const bool up = (axis == 1 && direction > 0);
+
+			const graphics::color block1 = chunk.get_blocklight(pos);
+			const graphics::color block2 = neighbor->get_blocklight(neighbor_block_pos);
+			if(flows(block1, block2, false))
 			{
-				chunk->set_block(block_in_chunk(block_pos), *block);
+				light_add1[LIGHT_LAYER_BLOCK].emplace_back(block_in_world(chunk_pos, pos));
 			}
-			else
+			else if(flows(block2, block1, false))
+			{
+				light_add1[LIGHT_LAYER_BLOCK].emplace_back(block_in_world(neighbor_pos, neighbor_block_pos));
+			}
+
+			const graphics::color sky1 = chunk.get_skylight(pos);
+			const graphics::color sky2 = neighbor->get_skylight(neighbor_block_pos);
+			if(flows(sky1, sky2, down))
+			{
+				light_add1[LIGHT_LAYER_SKY].emplace_back(block_in_world(chunk_pos, pos));
+			}
+			else if(flows(sky2, sky1, up))
 			{
-				// TODO?
+				light_add1[LIGHT_LAYER_SKY].emplace_back(block_in_world(neighbor_pos, neighbor_block_pos));
 			}
 		}
 	}
 }
 
+void world::impl::replay_pending_light(const chunk_in_world& chunk_pos)
+{
+	const auto i = pending_light_by_chunk.find(chunk_pos);
+	if(i == pending_light_by_chunk.cend())
+	{
+		return;
+	}
+	i->second.for_each(
+		[this, &chunk_pos](const std::size_t layer, const block_in_chunk& pos)
+		{
+			light_add1[layer].emplace_back(chunk_pos, pos);
+		},
+		[this, &chunk_pos](const std::size_t layer, const block_in_chunk& pos, const graphics::color& color)
+		{
+			light_sub1[layer].emplace_back(block_in_world(chunk_pos, pos), color);
+		}
+	);
+	pending_light_by_chunk.erase(i);
+}
+
+bool world::impl::gen_chunk(shared_ptr<Chunk>& chunk) const
+{
+	assert(chunk != nullptr);
+
+	const shared_ptr<const generator> gen = std::atomic_load(&chunk_generator);
+	if(gen == nullptr)
+	{
+		return false;
+	}
+	gen_buffer buffer(chunk->get_position(), seed, this_world.block_manager);
+	gen_timings.generate(*gen, buffer);
+	// nullptr if no stage placed a block (like above the surface)
+	if(auto blocks = buffer.take_blocks();
+		blocks != nullptr)
+	{
+		chunk->set_blocks(std::move(blocks));
+	}
+	chunk->set_pristine(true);
+	return true;
+}
+
 }
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstddef>
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <stdint.h>
 #include <string>
+#include <tuple>
 #include <unordered_set>
 
 #include <msgpack/object_fwd_decl.hpp>
@@ -19,8 +22,14 @@
 #include "fwd/graphics/color.hpp"
 #include "fwd/position/block_in_world.hpp"
 #include "fwd/position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "fwd/world/chunk_prefetcher.hpp"
+#include "fwd/world/generator.hpp"
 #include "shim/propagate_const.hpp"
+#include "storage/chunk_load_stats.hpp"
+#include "storage/codec.hpp"
 #include "util/filesystem.hpp"
+#include "world/chunk_stage.hpp"
 
 namespace block_thingy::world {
 
@@ -61,6 +70,12 @@ public:
 	std::shared_ptr<Chunk> get_or_make_chunk(const position::chunk_in_world&);
 	void set_chunk(const position::chunk_in_world&, std::shared_ptr<Chunk> chunk, bool set_light);
 
+	/*
+	 * Fill a chunk with generated terrain
+	 * This does not add the chunk to the world
+	 */
+	void gen_chunk(std::shared_ptr<Chunk>&) const;
+
 	/*
 	 * Call this every tick to keep a chunk loaded
 	 */
@@ -74,12 +89,49 @@ public:
 
 	void save_all();
 
+	/*
+	 * Move the chunks saved in the old format (one file for each chunk) into region files
+	 * @return The amount of chunks moved
+	 */
+	std::size_t migrate_chunk_files();
+
+	/*
+	 * How chunks are compressed when they are saved (saved with the world)
+	 */
+	storage::codec get_chunk_codec() const;
+	void set_chunk_codec(storage::codec);
+
+	/*
+	 * If false, chunks are saved without their light and lit again when they are loaded, except for chunks that
+	 * took too long to light (saved with the world)
+	 */
+	bool get_save_light() const;
+	void set_save_light(bool);
+
+	storage::chunk_load_stats get_chunk_load_stats() const;
+
 	std::string get_name() const;
 	void set_name(const std::string&);
 
 	double get_seed() const;
 	void set_seed(double);
 
+	/*
+	 * The generator that makes new chunks (terrain_generator unless another is set)
+	 * Set it before any chunk is generated; chunks from different generators do not match where they meet
+	 */
+	void set_generator(std::shared_ptr<const generator>);
+	/*
+	 * false after loading a world whose generator (named by get_generator_name) is not set yet
+	 * New chunks are left empty until it is
+	 */
+	bool has_generator() const;
+	std::string get_generator_name() const;
+	/*
+	 * The time spent in each stage of the generator, since the world was made
+	 */
+	generator_stats get_generator_stats() const;
+
 	uint64_t get_ticks() const;
 	double get_time() const;
 
@@ -90,6 +142,44 @@ public:
 	bool is_meshing_queued(const std::shared_ptr<const Chunk>&) const;
 	bool is_meshing_queued(const position::chunk_in_world&) const;
 
+	/*
+	 * Queue making a LOD mesh for the chunk, unless it already has an up-to-date one
+	 */
+	void request_lod_mesh(const std::shared_ptr<Chunk>&, uint8_t lod_level);
+
+	/*
+	 * Replace changes with the chunks meshed since the last call, and nullptr where a chunk was removed (see
+	 * graphics::chunk_cull_list)
+	 */
+	void take_render_changes(position::unordered_map_t<position::chunk_in_world, std::shared_ptr<Chunk>>& changes);
+
+	/*
+	 * How many chunks are in each stage of loading (see chunk_stage)
+	 */
+	chunk_stage_counts_t get_chunk_stage_counts();
+
+	/*
+	 * @return The amount of load and generate jobs that finished and that were cancelled because the chunk went out of range
+	 */
+	std::tuple<uint64_t, uint64_t> get_chunk_job_counts() const;
+
+	/*
+	 * Measured over the last second or so
+	 */
+	double get_chunks_integrated_per_second() const;
+
+	/*
+	 * How many chunks were prefetched ahead of moving players, and how many of them were used
+	 */
+	prefetch_stats get_prefetch_stats() const;
+
+	/*
+	 * Seconds from when the world was made until the chunks around each player were meshed (so the next frame is the
+	 * first they can play in), and until every chunk within render distance of them was
+	 * nullopt until then
+	 */
+	std::tuple<std::optional<double>, std::optional<double>> get_load_times() const;
+
 	// for msgpack
 	void save(msgpack::packer<std::ofstream>&) const;
 	void load(const msgpack::object&);
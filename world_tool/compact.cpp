@@ -0,0 +1,92 @@
+#include "tool.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/region_file.hpp"
+#include "storage/world_file.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+/*
+ * Rewrite each region file with its chunks packed in index order, so the sectors freed by chunks that moved are gone
+ */
+int compact_command(const options& opts, const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+
+	std::vector<fs::path> paths;
+	const fs::path region_dir = opts.world_dir / "regions";
+	if(fs::is_directory(region_dir))
+	{
+		for(const auto& entry : fs::directory_iterator(region_dir))
+		{
+			if(storage::world_file::parse_position(entry.path(), ".region") != std::nullopt)
+			{
+				paths.emplace_back(entry.path());
+			}
+		}
+	}
+
+	std::atomic<uint64_t> bytes_before(0);
+	std::atomic<uint64_t> bytes_after(0);
+	std::atomic<uint64_t> failed(0);
+	parallel_for(opts.thread_count, paths.size(), [&](const std::size_t i)
+	{
+		const fs::path& path = paths[i];
+		const fs::path temp = path.u8string() + ".new";
+		try
+		{
+			std::vector<std::pair<std::size_t, string>> chunks;
+			{
+				const storage::region_file region(path);
+				for(const std::size_t index : region.saved())
+				{
+					chunks.emplace_back(index, *region.read(index));
+				}
+			}
+			fs::remove(temp);
+			{
+				storage::region_file compacted(temp);
+				for(const auto& [index, stored] : chunks)
+				{
+					compacted.write(index, stored);
+				}
+				compacted.sync();
+			}
+			bytes_before += fs::file_size(path);
+			bytes_after += fs::file_size(temp);
+			// the old file is only replaced once the new one is complete
+			fs::rename(temp, path);
+		}
+		catch(const std::exception& e)
+		{
+			std::ostringstream ss;
+			ss << "error compacting " << path.u8string() << ": " << e.what() << '\n';
+			std::cerr << ss.str();
+			std::error_code ec;
+			fs::remove(temp, ec);
+			++failed;
+		}
+	});
+
+	std::cout << paths.size() << " region files compacted, " << failed << " failed\n"
+			  << "bytes: " << bytes_before << " -> " << bytes_after << '\n';
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,180 @@
+#include "tool.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "saved_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "storage/region_file.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+using position::chunk_in_world;
+
+namespace {
+
+struct position_less
+{
+	bool operator()(const chunk_in_world& a, const chunk_in_world& b) const
+	{
+		return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+	}
+};
+
+/*
+ * Move the chunk files into region files (like the migrate_chunks command, but on every thread)
+ * The chunks of one region are moved by one job, since a region's writes are serialized anyway
+ */
+int to_regions(const options& opts, const saved_world& world)
+{
+	std::map<chunk_in_world, std::vector<const saved_world::chunk*>, position_less> by_region;
+	for(const saved_world::chunk& chunk : world.chunks())
+	{
+		if(chunk.region == nullptr)
+		{
+			chunk_in_world region_pos;
+			std::size_t index;
+			storage::world_file::region_of(chunk.position, region_pos, index);
+			by_region[region_pos].emplace_back(&chunk);
+		}
+	}
+	std::vector<std::pair<chunk_in_world, std::vector<const saved_world::chunk*>>> jobs(by_region.cbegin(), by_region.cend());
+
+	fs::create_directories(opts.world_dir / "regions");
+	std::atomic<uint64_t> moved(0);
+	std::atomic<uint64_t> failed(0);
+	parallel_for(opts.thread_count, jobs.size(), [&](const std::size_t i)
+	{
+		const auto& [region_pos, chunks] = jobs[i];
+		try
+		{
+			// opened again, since saved_world only has the regions that existed (its copy is not used after this)
+			storage::region_file region(world.file().region_path(region_pos));
+			for(const saved_world::chunk* chunk : chunks)
+			{
+				chunk_in_world unused;
+				std::size_t index;
+				storage::world_file::region_of(chunk->position, unused, index);
+				// saved_world leaves out files for chunks that a region has, since the region's copy is newer
+				region.write(index, world.read(*chunk));
+			}
+			// the files are only removed once the region's table points to their copies on disk
+			region.sync();
+			for(const saved_world::chunk* chunk : chunks)
+			{
+				fs::remove(world.file().chunk_path(chunk->position));
+				++moved;
+			}
+		}
+		catch(const std::exception& e)
+		{
+			std::ostringstream ss;
+			ss << "error moving chunks into region " << region_pos << ": " << e.what() << '\n';
+			std::cerr << ss.str();
+			++failed;
+		}
+	});
+
+	const fs::path chunk_dir = opts.world_dir / "chunks";
+	if(fs::is_directory(chunk_dir) && fs::is_empty(chunk_dir))
+	{
+		fs::remove(chunk_dir);
+	}
+	std::cout << "moved " << moved << " chunks into region files\n";
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Move the chunks in region files into one file each, which is what the game saved before region files (and still
+ * loads), for tools that expect it
+ * A region file is removed once all of its chunks are written
+ */
+int to_files(const options& opts, const saved_world& world)
+{
+	const auto& regions = world.regions();
+	std::map<const storage::region_file*, std::vector<const saved_world::chunk*>> by_region;
+	for(const saved_world::chunk& chunk : world.chunks())
+	{
+		if(chunk.region != nullptr)
+		{
+			by_region[chunk.region].emplace_back(&chunk);
+		}
+	}
+
+	fs::create_directories(opts.world_dir / "chunks");
+	std::atomic<uint64_t> moved(0);
+	std::atomic<uint64_t> failed(0);
+	// not vector<bool>, since the jobs set them at the same time
+	std::vector<uint8_t> done(regions.size(), 0);
+	parallel_for(opts.thread_count, regions.size(), [&](const std::size_t i)
+	{
+		const storage::region_file& region = *regions[i];
+		try
+		{
+			if(const auto chunks = by_region.find(&region);
+				chunks != by_region.cend())
+			{
+				for(const saved_world::chunk* chunk : chunks->second)
+				{
+					const string stored = world.read(*chunk);
+					std::ofstream stream(world.file().chunk_path(chunk->position), std::ofstream::binary);
+					stream.write(stored.data(), static_cast<std::streamsize>(stored.size()));
+					if(!stream)
+					{
+						std::ostringstream ss;
+						ss << "error writing the file of chunk " << chunk->position;
+						throw std::runtime_error(ss.str());
+					}
+					++moved;
+				}
+			}
+			done[i] = 1;
+		}
+		catch(const std::exception& e)
+		{
+			std::ostringstream ss;
+			ss << "error moving the chunks in " << region.path().u8string() << ": " << e.what() << '\n';
+			std::cerr << ss.str();
+			++failed;
+		}
+	});
+
+	// removed after the jobs, since the regions are open until then
+	for(std::size_t i = 0; i < regions.size(); ++i)
+	{
+		if(done[i])
+		{
+			fs::remove(regions[i]->path());
+		}
+	}
+	std::cout << "moved " << moved << " chunks into their own files\n";
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
+
+int layout_command(const options& opts, const std::vector<string>& args)
+{
+	if(args.size() != 1 || (args[0] != "regions" && args[0] != "files"))
+	{
+		std::cerr << "usage: layout <regions|files>\n";
+		return 2;
+	}
+
+	const saved_world world(opts.world_dir);
+	return args[0] == "regions" ? to_regions(opts, world) : to_files(opts, world);
+}
+
+}
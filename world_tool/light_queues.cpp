@@ -0,0 +1,121 @@
+#include "tool.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "saved_world.hpp"
+#include "position/block_in_world.hpp"
+#include "position/chunk_in_world.hpp"
+#include "position/hash.hpp"
+#include "storage/msgpack/position.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+/*
+ * Remove the pending light changes of chunks that are not saved from the world file; the world would otherwise keep
+ * them until the chunk is made
+ * Worlds saved before pending light was kept by chunk have them in the light_sub1/sub2/add1/add2 queues
+ */
+int drop_light_queues_command(const options& opts, const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+	if(!fs::is_regular_file(opts.world_dir / "world"))
+	{
+		std::cerr << "there is no world file in " << opts.world_dir.u8string() << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::unordered_set<position::chunk_in_world, position::hasher_struct<position::chunk_in_world>> saved;
+	{
+		const saved_world world(opts.world_dir);
+		for(const saved_world::chunk& chunk : world.chunks())
+		{
+			saved.emplace(chunk.position);
+		}
+	}
+
+	uint64_t kept = 0;
+	uint64_t dropped = 0;
+	uint64_t kept_chunks = 0;
+	uint64_t dropped_chunks = 0;
+	rewrite_world_file(opts.world_dir, [&saved, &kept, &dropped, &kept_chunks, &dropped_chunks](msgpack::packer<std::ofstream>& o, const std::size_t i, const msgpack::object& element)
+	{
+		// see world::save: element 10 is an array of (chunk_in_world, pending_light bytes)
+		if(i == 10)
+		{
+			if(element.type != msgpack::type::ARRAY) throw msgpack::type_error();
+			std::vector<const msgpack::object*> keep;
+			for(uint32_t j = 0; j < element.via.array.size; ++j)
+			{
+				const msgpack::object& item = element.via.array.ptr[j];
+				if(item.type != msgpack::type::ARRAY || item.via.array.size != 2) throw msgpack::type_error();
+				const auto pos = item.via.array.ptr[0].as<position::chunk_in_world>();
+				if(saved.count(pos) != 0)
+				{
+					keep.emplace_back(&item);
+				}
+			}
+			// counted by chunk, since the bytes are not decoded
+			kept_chunks += keep.size();
+			dropped_chunks += element.via.array.size - keep.size();
+			o.pack_array(static_cast<uint32_t>(keep.size()));
+			for(const msgpack::object* item : keep)
+			{
+				o.pack(*item);
+			}
+			return;
+		}
+		// elements 4 to 7 are the queues, each an array of deques (one for each light layer)
+		if(i < 4 || i > 7)
+		{
+			o.pack(element);
+			return;
+		}
+		if(element.type != msgpack::type::ARRAY) throw msgpack::type_error();
+		o.pack_array(element.via.array.size);
+		for(uint32_t layer = 0; layer < element.via.array.size; ++layer)
+		{
+			const msgpack::object& queue = element.via.array.ptr[layer];
+			if(queue.type != msgpack::type::ARRAY) throw msgpack::type_error();
+			std::vector<const msgpack::object*> keep;
+			for(uint32_t j = 0; j < queue.via.array.size; ++j)
+			{
+				// (block_in_world, color)
+				const msgpack::object& item = queue.via.array.ptr[j];
+				if(item.type != msgpack::type::ARRAY || item.via.array.size != 2) throw msgpack::type_error();
+				const auto pos = item.via.array.ptr[0].as<position::block_in_world>();
+				if(saved.count(position::chunk_in_world(pos)) != 0)
+				{
+					keep.emplace_back(&item);
+				}
+			}
+			kept += keep.size();
+			dropped += queue.via.array.size - keep.size();
+			o.pack_array(static_cast<uint32_t>(keep.size()));
+			for(const msgpack::object* item : keep)
+			{
+				o.pack(*item);
+			}
+		}
+	});
+
+	std::cout << "dropped the pending light of " << dropped_chunks << " chunks that are not saved, kept " << kept_chunks << '\n';
+	if(dropped != 0 || kept != 0)
+	{
+		std::cout << "dropped " << dropped << " queued light changes in chunks that are not saved, kept " << kept << '\n';
+	}
+	return EXIT_SUCCESS;
+}
+
+}
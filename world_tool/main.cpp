@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tool.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+struct entry
+{
+	const char* name;
+	int (*run)(const options&, const std::vector<string>&);
+	const char* description;
+};
+
+static const entry commands[]
+{
+	{"compact", &compact_command, "rewrite the region files without their free sectors"},
+	{"drop_light_queues", &drop_light_queues_command, "remove the pending light changes of chunks that are not saved from the world file"},
+	{"layout", &layout_command, "move the chunks into region files or into one file each <regions|files>"},
+	{"recompress", &recompress_command, "encode every chunk with a codec and make it the world's codec <none|deflate|lz>"},
+	{"scan", &scan_command, "decode every chunk and print sizes and decode times; fails if any chunk does not decode"},
+};
+
+static void print_usage(const char* argv0)
+{
+	std::cerr << "usage: " << argv0 << " [--threads n] <command> <world directory> [args...]\n";
+	for(const entry& e : commands)
+	{
+		std::cerr << "  " << e.name << ": " << e.description << '\n';
+	}
+}
+
+}
+
+using namespace block_thingy::world_tool;
+
+int main(const int argc, char** argv)
+{
+	std::vector<string> args(argv + 1, argv + argc);
+	options opts;
+	// hardware_concurrency may return 0 when it does not know
+	opts.thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	if(args.size() >= 2 && args[0] == "--threads")
+	{
+		try
+		{
+			opts.thread_count = std::max<std::size_t>(std::stoul(args[1]), 1);
+		}
+		catch(const std::exception&)
+		{
+			print_usage(argv[0]);
+			return 2;
+		}
+		args.erase(args.begin(), args.begin() + 2);
+	}
+	if(args.size() < 2)
+	{
+		print_usage(argv[0]);
+		return 2;
+	}
+
+	const string name = args[0];
+	opts.world_dir = args[1];
+	args.erase(args.begin(), args.begin() + 2);
+	for(const entry& e : commands)
+	{
+		if(name == e.name)
+		{
+			try
+			{
+				return e.run(opts, args);
+			}
+			catch(const std::exception& ex)
+			{
+				std::cerr << name << " failed: " << ex.what() << '\n';
+				return 1;
+			}
+		}
+	}
+
+	std::cerr << "unknown command: " << name << '\n';
+	print_usage(argv[0]);
+	return 2;
+}
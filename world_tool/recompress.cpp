@@ -0,0 +1,109 @@
+#include "tool.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "saved_world.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+/*
+ * Encode every chunk that is not already in the given codec with it, and make it the world's codec
+ */
+int recompress_command(const options& opts, const std::vector<string>& args)
+{
+	const auto codec = args.size() == 1 ? storage::codec_from_name(args[0]) : std::nullopt;
+	if(codec == std::nullopt)
+	{
+		std::cerr << "usage: recompress <none|deflate|lz>\n";
+		return 2;
+	}
+
+	const saved_world world(opts.world_dir);
+	const auto& chunks = world.chunks();
+	std::atomic<uint64_t> recompressed(0);
+	std::atomic<uint64_t> failed(0);
+	std::atomic<uint64_t> bytes_before(0);
+	std::atomic<uint64_t> bytes_after(0);
+	parallel_for(opts.thread_count, chunks.size(), [&](const std::size_t i)
+	{
+		const saved_world::chunk& chunk = chunks[i];
+		try
+		{
+			const string stored = world.read(chunk);
+			bytes_before += stored.size();
+			if(storage::stored_codec(stored) == codec)
+			{
+				bytes_after += stored.size();
+				return;
+			}
+			// the chunk is decoded first, so a corrupt chunk is not saved again as if it were fine
+			thread_local string buffer;
+			decode_chunk(stored, buffer);
+			const string encoded = storage::encode(*codec, string(storage::decode(stored, buffer)));
+			if(chunk.region != nullptr)
+			{
+				chunk.region->write(chunk.index, encoded);
+			}
+			else
+			{
+				std::ofstream stream(world.file().chunk_path(chunk.position), std::ofstream::binary);
+				stream.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+				if(!stream)
+				{
+					throw std::runtime_error("error writing the chunk file");
+				}
+			}
+			bytes_after += encoded.size();
+			++recompressed;
+		}
+		catch(const std::exception& e)
+		{
+			std::ostringstream ss;
+			ss << "chunk " << chunk.position << " was not recompressed: " << e.what() << '\n';
+			std::cerr << ss.str();
+			++failed;
+		}
+	});
+
+	// so chunks saved by the game use it too
+	bool set_world_codec = false;
+	if(fs::is_regular_file(opts.world_dir / "world"))
+	{
+		rewrite_world_file(opts.world_dir, [&codec, &set_world_codec](msgpack::packer<std::ofstream>& o, const std::size_t i, const msgpack::object& element)
+		{
+			// see world::save
+			if(i == 8)
+			{
+				std::ostringstream name;
+				name << *codec;
+				o.pack(name.str());
+				set_world_codec = true;
+			}
+			else
+			{
+				o.pack(element);
+			}
+		});
+	}
+	if(!set_world_codec)
+	{
+		std::cerr << "the world file does not have a codec (it is from before chunk codecs); use the chunk_codec command in the game to set it\n";
+	}
+
+	std::cout << recompressed << " of " << chunks.size() << " chunks recompressed with " << *codec << ", " << failed << " failed\n"
+			  << "stored bytes: " << bytes_before << " -> " << bytes_after << '\n'
+			  << "region files keep the sectors that were freed; run compact to remove them\n";
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
@@ -0,0 +1,127 @@
+#include "saved_world.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+#include "position/hash.hpp"
+#include "util/misc.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+using position::chunk_in_world;
+
+static bool position_less(const chunk_in_world& a, const chunk_in_world& b)
+{
+	return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+}
+
+saved_world::saved_world(const fs::path& world_dir)
+:
+	world_dir(world_dir),
+	file_(world_dir)
+{
+	if(!fs::is_directory(world_dir))
+	{
+		throw std::runtime_error(world_dir.u8string() + " is not a directory");
+	}
+
+	std::vector<std::pair<chunk_in_world, fs::path>> region_paths;
+	const fs::path region_dir = world_dir / "regions";
+	if(fs::is_directory(region_dir))
+	{
+		for(const auto& entry : fs::directory_iterator(region_dir))
+		{
+			if(const auto region_pos = storage::world_file::parse_position(entry.path(), ".region"))
+			{
+				region_paths.emplace_back(*region_pos, entry.path());
+			}
+		}
+	}
+	std::sort(region_paths.begin(), region_paths.end(), [](const auto& a, const auto& b)
+	{
+		return position_less(a.first, b.first);
+	});
+
+	std::unordered_set<chunk_in_world, position::hasher_struct<chunk_in_world>> in_regions;
+	for(const auto& [region_pos, path] : region_paths)
+	{
+		try
+		{
+			regions_.emplace_back(std::make_unique<storage::region_file>(path));
+		}
+		catch(const std::exception& e)
+		{
+			std::cerr << "skipping " << path.u8string() << ": " << e.what() << '\n';
+			continue;
+		}
+		storage::region_file* region = regions_.back().get();
+		for(const std::size_t index : region->saved())
+		{
+			const chunk_in_world pos = storage::world_file::chunk_in_region(region_pos, index);
+			chunks_.push_back({pos, region, index});
+			in_regions.emplace(pos);
+		}
+	}
+
+	std::vector<chunk_in_world> files;
+	const fs::path chunk_dir = world_dir / "chunks";
+	if(fs::is_directory(chunk_dir))
+	{
+		for(const auto& entry : fs::directory_iterator(chunk_dir))
+		{
+			const auto pos = storage::world_file::parse_position(entry.path(), ".gz");
+			if(pos != std::nullopt && in_regions.count(*pos) == 0)
+			{
+				files.emplace_back(*pos);
+			}
+		}
+	}
+	std::sort(files.begin(), files.end(), position_less);
+	for(const chunk_in_world& pos : files)
+	{
+		chunks_.push_back({pos, nullptr, 0});
+	}
+}
+
+const std::vector<saved_world::chunk>& saved_world::chunks() const
+{
+	return chunks_;
+}
+
+string saved_world::read(const chunk& c) const
+{
+	if(c.region == nullptr)
+	{
+		return util::read_file(file_.chunk_path(c.position));
+	}
+	auto stored = c.region->read(c.index);
+	if(stored == std::nullopt)
+	{
+		throw std::runtime_error("the chunk is no longer in " + c.region->path().u8string());
+	}
+	return std::move(*stored);
+}
+
+const std::vector<std::unique_ptr<storage::region_file>>& saved_world::regions() const
+{
+	return regions_;
+}
+
+const storage::world_file& saved_world::file() const
+{
+	return file_;
+}
+
+const fs::path& saved_world::dir() const
+{
+	return world_dir;
+}
+
+}
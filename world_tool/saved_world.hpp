@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "position/chunk_in_world.hpp"
+#include "storage/region_file.hpp"
+#include "storage/world_file.hpp"
+#include "util/filesystem.hpp"
+
+namespace block_thingy::world_tool {
+
+/*
+ * The chunks saved in a world directory, found from the region headers and the file names without loading the world
+ * (so it does not need a window or the game's resources)
+ */
+class saved_world
+{
+public:
+	explicit saved_world(const fs::path& world_dir);
+
+	saved_world(saved_world&&) = delete;
+	saved_world(const saved_world&) = delete;
+	saved_world& operator=(saved_world&&) = delete;
+	saved_world& operator=(const saved_world&) = delete;
+
+	struct chunk
+	{
+		position::chunk_in_world position;
+		// nullptr if the chunk is saved in its own file (the old format)
+		storage::region_file* region;
+		std::size_t index;
+	};
+
+	/*
+	 * In region order and then index order, and then the chunk files
+	 * A chunk in both a region and a file is only listed once, for the region (like world_file loads it)
+	 */
+	const std::vector<chunk>& chunks() const;
+
+	/*
+	 * The stored (compressed) bytes
+	 * Can be called from any thread
+	 */
+	std::string read(const chunk&) const;
+
+	const std::vector<std::unique_ptr<storage::region_file>>& regions() const;
+
+	/*
+	 * For the file layout and its helpers (only the paths are used; the world is not loaded)
+	 */
+	const storage::world_file& file() const;
+
+	const fs::path& dir() const;
+
+private:
+	fs::path world_dir;
+	storage::world_file file_;
+	std::vector<std::unique_ptr<storage::region_file>> regions_;
+	std::vector<chunk> chunks_;
+};
+
+}
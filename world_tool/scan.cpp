@@ -0,0 +1,158 @@
+#include "tool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "saved_world.hpp"
+#include "storage/region_file.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+namespace {
+
+struct scan_result
+{
+	bool ok = false;
+	string error;
+	chunk_info info{};
+	double seconds = 0;
+};
+
+string codec_name(const std::optional<storage::codec> codec)
+{
+	if(codec == std::nullopt)
+	{
+		return "gzip";
+	}
+	std::ostringstream ss;
+	ss << *codec;
+	return ss.str();
+}
+
+}
+
+/*
+ * Decode every chunk like loading would, and print what the world is made of and how long decoding took
+ */
+int scan_command(const options& opts, const std::vector<string>& args)
+{
+	if(!args.empty())
+	{
+		std::cerr << "unknown argument: " << args[0] << '\n';
+		return 2;
+	}
+
+	const saved_world world(opts.world_dir);
+	const auto& chunks = world.chunks();
+	std::vector<scan_result> results(chunks.size());
+
+	using clock = std::chrono::steady_clock;
+	const auto start = clock::now();
+	parallel_for(opts.thread_count, chunks.size(), [&world, &chunks, &results](const std::size_t i)
+	{
+		thread_local string buffer;
+		scan_result& result = results[i];
+		try
+		{
+			const string stored = world.read(chunks[i]);
+			const auto decode_start = clock::now();
+			result.info = decode_chunk(stored, buffer);
+			result.seconds = std::chrono::duration<double>(clock::now() - decode_start).count();
+			result.ok = true;
+		}
+		catch(const std::exception& e)
+		{
+			result.error = e.what();
+		}
+	});
+	const double wall_seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	struct codec_stats
+	{
+		uint64_t count = 0;
+		uint64_t stored = 0;
+		uint64_t decoded = 0;
+	};
+	std::map<string, codec_stats> by_codec;
+	uint64_t failed = 0;
+	uint64_t in_files = 0;
+	uint64_t msgpack = 0;
+	uint64_t without_light = 0;
+	uint64_t stored = 0;
+	uint64_t decoded = 0;
+	double decode_seconds = 0;
+	double max_decode_seconds = 0;
+	for(std::size_t i = 0; i < chunks.size(); ++i)
+	{
+		const saved_world::chunk& chunk = chunks[i];
+		const scan_result& result = results[i];
+		if(chunk.region == nullptr)
+		{
+			++in_files;
+		}
+		if(!result.ok)
+		{
+			++failed;
+			std::cerr << "chunk " << chunk.position << " in "
+					  << (chunk.region != nullptr ? chunk.region->path() : world.file().chunk_path(chunk.position)).u8string()
+					  << " does not decode: " << result.error << '\n';
+			continue;
+		}
+		codec_stats& c = by_codec[codec_name(result.info.codec)];
+		++c.count;
+		c.stored += result.info.stored_size;
+		c.decoded += result.info.decoded_size;
+		if(!result.info.binary)
+		{
+			++msgpack;
+		}
+		if(!result.info.has_light)
+		{
+			++without_light;
+		}
+		stored += result.info.stored_size;
+		decoded += result.info.decoded_size;
+		decode_seconds += result.seconds;
+		max_decode_seconds = std::max(max_decode_seconds, result.seconds);
+	}
+
+	uint64_t region_bytes = 0;
+	uint64_t free_bytes = 0;
+	for(const auto& region : world.regions())
+	{
+		region_bytes += fs::file_size(region->path());
+		free_bytes += region->free_sector_count() * storage::region_file::SECTOR_SIZE;
+	}
+
+	const uint64_t decoded_count = chunks.size() - failed;
+	const double n = std::max<double>(static_cast<double>(decoded_count), 1);
+	std::cout << std::fixed << std::setprecision(1)
+			  << chunks.size() << " chunks (" << in_files << " in the old one-file-per-chunk layout), " << failed << " failed to decode\n"
+			  << msgpack << " in the msgpack format, " << without_light << " saved without light\n"
+			  << world.regions().size() << " region files: " << region_bytes << " bytes, " << free_bytes << " of them in free sectors\n"
+			  << "stored: " << stored << " bytes (" << static_cast<double>(stored) / n << " per chunk), decoded: " << decoded << " bytes\n";
+	for(const auto& [name, c] : by_codec)
+	{
+		std::cout << "  " << std::left << std::setw(8) << name << std::right
+				  << std::setw(10) << c.count << " chunks"
+				  << std::setw(14) << static_cast<double>(c.stored) / static_cast<double>(c.count) << " bytes/chunk"
+				  << std::setw(8) << std::setprecision(2) << static_cast<double>(c.decoded) / static_cast<double>(std::max<uint64_t>(c.stored, 1)) << "x"
+				  << std::setprecision(1) << '\n';
+	}
+	std::cout << "decode: " << decode_seconds * 1e6 / n << " us/chunk (max " << max_decode_seconds * 1e6 << " us), "
+			  << static_cast<double>(decoded_count) / std::max(wall_seconds, 1e-9) << " chunks/s on " << opts.thread_count << " threads\n";
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
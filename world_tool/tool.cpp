@@ -0,0 +1,101 @@
+#include "tool.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "block/block.hpp"
+#include "chunk/ChunkData.hpp"
+#include "graphics/color.hpp"
+#include "storage/chunk_format.hpp"
+#include "storage/chunk_image.hpp"
+#include "storage/msgpack/block.hpp"
+#include "storage/msgpack/color.hpp"
+#include "util/misc.hpp"
+#include "util/thread_pool.hpp"
+
+using std::string;
+
+namespace block_thingy::world_tool {
+
+void parallel_for(const std::size_t thread_count, const std::size_t count, const std::function<void(std::size_t)>& f)
+{
+	util::thread_pool pool(thread_count);
+	// one job per worker that takes the next index until there are none, instead of a job per index
+	std::atomic<std::size_t> next(0);
+	for(std::size_t t = 0; t < pool.thread_count(); ++t)
+	{
+		pool.submit([&next, count, &f]()
+		{
+			for(std::size_t i = next++; i < count; i = next++)
+			{
+				f(i);
+			}
+		});
+	}
+	pool.stop();
+}
+
+chunk_info decode_chunk(const std::string_view stored, string& buffer)
+{
+	chunk_info info;
+	info.codec = storage::stored_codec(stored);
+	info.stored_size = stored.size();
+	const std::string_view bytes = storage::decode(stored, buffer);
+	info.decoded_size = bytes.size();
+	info.binary = storage::chunk_format::is_binary(bytes);
+	if(info.binary)
+	{
+		storage::chunk_image image;
+		info.has_light = storage::chunk_format::read(bytes, image);
+	}
+	else
+	{
+		// like Chunk::load, without needing a world to make a Chunk in
+		const msgpack::object_handle handle = msgpack::unpack(bytes.data(), bytes.size());
+		const msgpack::object& o = handle.get();
+		if(o.type != msgpack::type::ARRAY) throw msgpack::type_error();
+		if(o.via.array.size != 3) throw msgpack::type_error();
+		// not on the stack, since the arrays are big
+		auto blocks = std::make_unique<chunk_blocks_t::array_t>();
+		auto light = std::make_unique<chunk_data<graphics::color>::array_t>();
+		o.via.array.ptr[0].convert(*blocks);
+		o.via.array.ptr[1].convert(*light);
+		o.via.array.ptr[2].convert(*light);
+		info.has_light = true;
+	}
+	return info;
+}
+
+void rewrite_world_file
+(
+	const fs::path& world_dir,
+	const std::function<void(msgpack::packer<std::ofstream>&, std::size_t i, const msgpack::object&)>& f
+)
+{
+	const fs::path path = world_dir / "world";
+	const string bytes = util::read_file(path);
+	const msgpack::object_handle handle = msgpack::unpack(bytes.data(), bytes.size());
+	const msgpack::object& o = handle.get();
+	if(o.type != msgpack::type::ARRAY) throw msgpack::type_error();
+
+	const fs::path temp = path.u8string() + ".new";
+	{
+		std::ofstream stream(temp, std::ofstream::binary);
+		msgpack::packer<std::ofstream> packer(stream);
+		packer.pack_array(o.via.array.size);
+		for(std::size_t i = 0; i < o.via.array.size; ++i)
+		{
+			f(packer, i, o.via.array.ptr[i]);
+		}
+		if(!stream)
+		{
+			throw std::runtime_error("error writing " + temp.u8string());
+		}
+	}
+	fs::rename(temp, path);
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <msgpack.hpp>
+
+#include "storage/codec.hpp"
+#include "util/filesystem.hpp"
+
+namespace block_thingy::world_tool {
+
+struct options
+{
+	fs::path world_dir;
+	// std::thread::hardware_concurrency() unless --threads is given
+	std::size_t thread_count;
+};
+
+/*
+ * Each command gets the options and the arguments after the world directory and returns the exit status
+ */
+int compact_command(const options&, const std::vector<std::string>& args);
+int drop_light_queues_command(const options&, const std::vector<std::string>& args);
+int layout_command(const options&, const std::vector<std::string>& args);
+int recompress_command(const options&, const std::vector<std::string>& args);
+int scan_command(const options&, const std::vector<std::string>& args);
+
+/*
+ * Call f(0) to f(count - 1) on a thread pool and return once they are done
+ */
+void parallel_for(std::size_t thread_count, std::size_t count, const std::function<void(std::size_t)>& f);
+
+/*
+ * What is in a saved chunk
+ */
+struct chunk_info
+{
+	// nullopt for the untagged gzip from before codecs
+	std::optional<storage::codec> codec;
+	// false for the msgpack format from before the binary format
+	bool binary;
+	bool has_light;
+	std::size_t stored_size;
+	std::size_t decoded_size;
+};
+
+/*
+ * Decode every part of a saved chunk, like loading it would
+ * Throws if it is corrupt
+ *
+ * @param buffer reused for the decompressed bytes
+ */
+chunk_info decode_chunk(std::string_view stored, std::string& buffer);
+
+/*
+ * Rewrite the world file (see world::save) through a temporary file
+ * f is called for each element of the world's array and packs its replacement
+ */
+void rewrite_world_file
+(
+	const fs::path& world_dir,
+	const std::function<void(msgpack::packer<std::ofstream>&, std::size_t i, const msgpack::object&)>& f
+);
+
+}